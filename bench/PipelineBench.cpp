@@ -0,0 +1,543 @@
+// Pipeline benchmark: each stage of main.cpp alone, on synthetic data of growing size.
+// Usage: Arbitrage_bench [--min-rows N] [--max-rows N] [--min-time s] [--filter name]
+//                        [--out file.json] [--dir tmpdir]
+// JSON on stdout (or --out), a readable table on stderr.
+// compact_check compares the 32-bit price pipeline with the double one, path_check
+// the per-bar OU path kernel with the fixed one (also across NaN gaps), against
+// fixed bounds; the exit code is 3 when a bound is exceeded.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/Loaders.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+
+// ------------------------- conteggio allocazioni -------------------------
+// operator new globale sostituito solo in questo eseguibile
+namespace {
+std::atomic<std::uint64_t> g_allocs{0};
+std::atomic<std::uint64_t> g_alloc_bytes{0};
+
+void* counted_alloc(std::size_t n){
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+} // anon
+
+void* operator new(std::size_t n)   { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void  operator delete(void* p) noexcept                { std::free(p); }
+void  operator delete[](void* p) noexcept              { std::free(p); }
+void  operator delete(void* p, std::size_t) noexcept   { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ------------------------- dati sintetici -------------------------
+// barre da 1 minuto, spread OU con qualche spike (per remove_outliers)
+util::PriceTable make_table(size_t n, std::uint64_t seed = 7){
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> N(0.0, 1.0);
+    std::uniform_real_distribution<double> U(0.0, 1.0);
+
+    const std::int64_t t0 = util::iso_to_epoch_seconds("2015-04-22 00:00:00");
+    const double dt = 1.0 / (365.0 * 24.0 * 60.0);
+    const double k = 50.0, eta = 0.02, sigma = 0.3;
+    const double a = std::exp(-k*dt), sd = sigma * std::sqrt((1.0 - a*a) / (2.0*k));
+
+    util::PriceTable T(n);
+    double x = eta, m2 = 75.0;
+    for (size_t i=0; i<n; ++i){
+        x = a*x + eta*(1.0 - a) + sd*N(rng);
+        m2 *= std::exp(1e-4 * N(rng));
+        double spike = (U(rng) < 1e-3) ? 0.05 * (U(rng) < 0.5 ? -1.0 : 1.0) : 0.0;
+        const double m1 = m2 * std::exp(x + spike);
+
+        auto& r = T[i];
+        r.Time = util::epoch_seconds_to_iso(t0 + static_cast<std::int64_t>(i) * 60);
+        r.Mid1 = m1; r.Bid1 = m1 - 0.005; r.Ask1 = m1 + 0.005;
+        r.Mid2 = m2; r.Bid2 = m2 - 0.125; r.Ask2 = m2 + 0.125;
+        r.Rt = std::log(r.Mid1 / r.Mid2);
+    }
+    return T;
+}
+
+// stesso layout del CSV reale: ';', virgola decimale, date "d/m/yy H:MM", due righe d'intestazione
+size_t write_csv(const std::string& path, const util::PriceTable& T){
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f << "Timestamp;HOc2;HOc2;LGOc6;LGOc6\n;Bid Close;Ask Close;Bid Close;Ask Close\n";
+    auto num = [](double v){
+        std::string s = std::to_string(v);
+        std::replace(s.begin(), s.end(), '.', ',');
+        return s;
+    };
+    for (const auto& r : T){
+        const std::string& t = r.Time;  // YYYY-MM-DD HH:MM:SS
+        f << std::stoi(t.substr(8,2)) << '/' << std::stoi(t.substr(5,2)) << '/' << t.substr(2,2)
+          << ' ' << std::stoi(t.substr(11,2)) << ':' << t.substr(14,2) << ';'
+          << num(r.Bid1) << ';' << num(r.Ask1) << ';' << num(r.Bid2) << ';' << num(r.Ask2) << '\n';
+    }
+    f.flush();
+    return static_cast<size_t>(f.tellp());
+}
+
+// ------------------------- misura -------------------------
+struct Sample {
+    double ns = 0.0;
+    std::uint64_t allocs = 0, bytes = 0;
+};
+
+template <class F>
+Sample measure(F& f){
+    const auto a0 = g_allocs.load(), b0 = g_alloc_bytes.load();
+    const auto t0 = Clock::now();
+    f();
+    const auto t1 = Clock::now();
+    Sample s;
+    s.ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    s.allocs = g_allocs.load() - a0;
+    s.bytes  = g_alloc_bytes.load() - b0;
+    return s;
+}
+
+struct Result {
+    std::string name;
+    size_t rows = 0;            // unità di lavoro per chiamata (righe, chiamate, ...)
+    std::string unit;
+    std::string params;
+    size_t reps = 0;
+    double ns_median = 0.0, ns_min = 0.0;
+    double allocs = 0.0, alloc_bytes = 0.0;   // per chiamata
+    size_t input_bytes = 0;     // solo loader
+};
+
+// scarto tra due varianti della pipeline (compatta/double, percorso OU/fissi), con il suo limite
+struct Check {
+    std::string name;
+    size_t rows = 0;
+    std::string storage;
+    double value = 0.0, bound = 0.0;
+    bool ok() const { return value <= bound; }
+};
+
+struct Options {
+    size_t min_rows = 1000;
+    size_t max_rows = 1000000;
+    double min_time = 0.5;      // secondi di misura per caso
+    size_t max_reps = 50;
+    std::string filter;
+    std::string out;
+    std::string dir = ".";
+};
+
+// warm-up, poi ripete finché min_time è passato (almeno 3 volte, 1 se la prima è già lunga)
+template <class F>
+Result run_case(const Options& o, std::string name, size_t rows, std::string unit,
+                std::string params, F&& f)
+{
+    Result R;
+    R.name = std::move(name); R.rows = rows; R.unit = std::move(unit); R.params = std::move(params);
+
+    const Sample warm = measure(f);
+    std::vector<Sample> S;
+    double spent = 0.0;
+    const size_t min_reps = warm.ns * 1e-9 > o.min_time ? 1 : 3;
+    while (S.size() < o.max_reps && (S.size() < min_reps || spent < o.min_time)){
+        S.push_back(measure(f));
+        spent += S.back().ns * 1e-9;
+    }
+
+    std::vector<double> ns;
+    for (const auto& s : S) ns.push_back(s.ns);
+    std::sort(ns.begin(), ns.end());
+    R.reps = S.size();
+    R.ns_min = ns.front();
+    R.ns_median = (ns.size() % 2) ? ns[ns.size()/2] : 0.5 * (ns[ns.size()/2 - 1] + ns[ns.size()/2]);
+    // allocazioni deterministiche: si prende l'ultima ripetizione
+    R.allocs = static_cast<double>(S.back().allocs);
+    R.alloc_bytes = static_cast<double>(S.back().bytes);
+    return R;
+}
+
+std::string json_escape(const std::string& s){
+    std::string o;
+    for (char c : s){
+        if (c == '"' || c == '\\') { o += '\\'; o += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) o += ' ';
+        else o += c;
+    }
+    return o;
+}
+
+void print_row(const Result& r){
+    const double per = r.ns_median / std::max<size_t>(r.rows, 1);
+    std::cerr << std::left << std::setw(24) << r.name
+              << std::right << std::setw(11) << r.rows
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << per << " ns/" << std::left << std::setw(5) << r.unit
+              << std::right << std::setprecision(2)
+              << std::setw(10) << r.allocs / std::max<size_t>(r.rows, 1) << " alloc/" << r.unit
+              << std::setw(6) << r.reps << " reps\n";
+}
+
+void write_json(std::ostream& os, const Options& o, const std::vector<Result>& res,
+                const std::vector<Check>& checks){
+    const std::time_t now = std::time(nullptr);
+    char ts[32];
+    std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    os << std::setprecision(10);
+    os << "{\n  \"bench\": \"Arbitrage_bench\",\n"
+       << "  \"timestamp\": \"" << ts << "\",\n"
+#if defined(__VERSION__)
+       << "  \"compiler\": \"" << json_escape(__VERSION__) << "\",\n"
+#endif
+#if defined(NDEBUG)
+       << "  \"assertions\": false,\n"
+#else
+       << "  \"assertions\": true,\n"
+#endif
+       << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+       << "  \"min_time_s\": " << o.min_time << ",\n"
+       << "  \"results\": [\n";
+    for (size_t i=0; i<res.size(); ++i){
+        const auto& r = res[i];
+        const double n = static_cast<double>(std::max<size_t>(r.rows, 1));
+        os << "    {\"name\": \"" << r.name << "\", \"rows\": " << r.rows
+           << ", \"unit\": \"" << r.unit << "\", \"params\": \"" << json_escape(r.params) << "\""
+           << ", \"reps\": " << r.reps
+           << ", \"ns_median\": " << r.ns_median << ", \"ns_min\": " << r.ns_min
+           << ", \"ns_per_row\": " << r.ns_median / n
+           << ", \"rows_per_s\": " << (r.ns_median > 0 ? 1e9 * n / r.ns_median : 0.0)
+           << ", \"allocs\": " << r.allocs << ", \"alloc_bytes\": " << r.alloc_bytes
+           << ", \"allocs_per_row\": " << r.allocs / n;
+        if (r.input_bytes)
+            os << ", \"input_bytes\": " << r.input_bytes
+               << ", \"mb_per_s\": " << (r.ns_median > 0 ? 1e3 * r.input_bytes / r.ns_median : 0.0);
+        os << "}" << (i + 1 < res.size() ? "," : "") << "\n";
+    }
+    os << "  ]";
+    if (!checks.empty()){
+        os << ",\n  \"checks\": [\n";
+        for (size_t i=0; i<checks.size(); ++i){
+            const auto& c = checks[i];
+            os << "    {\"name\": \"" << c.name << "\", \"rows\": " << c.rows
+               << ", \"storage\": \"" << c.storage << "\""
+               << ", \"value\": " << c.value << ", \"bound\": " << c.bound
+               << ", \"ok\": " << (c.ok() ? "true" : "false") << "}"
+               << (i + 1 < checks.size() ? "," : "") << "\n";
+        }
+        os << "  ]";
+    }
+    os << "\n}\n";
+}
+
+size_t parse_count(const std::string& s){
+    return static_cast<size_t>(std::llround(std::stod(s)));   // accetta anche 1e6
+}
+
+// bid/ask arrotondati alla griglia dei tick, mid e Rt ricalcolati come nel loader
+util::PriceTable snap_to_ticks(util::PriceTable T, std::array<double,2> tick){
+    for (auto& r : T){
+        r.Bid1 = std::round(r.Bid1 / tick[0]) * tick[0]; r.Ask1 = std::round(r.Ask1 / tick[0]) * tick[0];
+        r.Bid2 = std::round(r.Bid2 / tick[1]) * tick[1]; r.Ask2 = std::round(r.Ask2 / tick[1]) * tick[1];
+        r.Mid1 = 0.5 * (r.Bid1 + r.Ask1);
+        r.Mid2 = 0.5 * (r.Bid2 + r.Ask2);
+        r.Rt = std::log(r.Mid1 / r.Mid2);
+    }
+    return T;
+}
+
+void print_check(const Check& c){
+    std::cerr << std::left << std::setw(24) << ("check " + c.name)
+              << std::right << std::setw(11) << c.rows << "  " << std::setw(5) << c.storage
+              << std::scientific << std::setprecision(2)
+              << std::setw(12) << c.value << " <= " << std::setw(9) << c.bound
+              << std::defaultfloat << (c.ok() ? "  ok" : "  FAIL") << "\n";
+}
+
+// pipeline compatta contro pipeline double sulla stessa tabella, stadio per stadio
+std::vector<Check> compact_checks(const util::PriceTable& T, util::PriceStorage mode,
+                                  std::array<double,2> tick, double dt){
+    const util::CompactPriceTable C = util::CompactPriceTable::from(T, mode, tick);
+    std::vector<Check> out;
+    auto check = [&](std::string name, double value, double bound){
+        out.push_back({std::move(name), T.size(), util::price_storage_name(mode), value, bound});
+    };
+    auto rel = [](double a, double b){ return std::fabs(a - b) / std::max(std::fabs(b), 1e-300); };
+
+    // Rt: calcolato in double dai mid prima dell'arrotondamento => identico
+    double rt_err = 0.0;
+    for (size_t i=0; i<T.size(); ++i) rt_err = std::max(rt_err, std::fabs(C.rt(i) - T[i].Rt));
+    check("rt_max_abs", rt_err, 0.0);
+
+    // costo per riga: float arrotonda bid/ask entro 2^-24 relativo => 4 log(1+e) <= 2^-22;
+    // Ticks32 su quote in griglia: resta l'arrotondamento di n * tick/2 (qualche ulp)
+    const double cost_bound = mode == util::PriceStorage::Float32 ? std::ldexp(1.0, -22) * 1.001 : 1e-14;
+    double cost = 0.0;
+    for (const auto& r : T) cost += std::log(r.Ask1 / r.Bid1) + std::log(r.Ask2 / r.Bid2);
+    cost /= static_cast<double>(std::max<size_t>(T.size(), 1));
+    check("cost_abs", std::fabs(util::avg_log_cost(C) - cost), cost_bound);
+
+    // outlier e OU leggono solo Rt: stesse decisioni, stesse somme
+    const auto O  = util::remove_outliers(T);
+    const auto OC = util::remove_outliers(C);
+    size_t flips = 0;
+    for (size_t i=0; i<T.size(); ++i) flips += O.is_outlier[i] != OC.is_outlier[i];
+    check("outlier_flips", double(flips), 0.0);
+
+    const auto E  = stats::ou_bootstrap(O.clean, 0, 0.05, 42, dt);
+    const auto EC = stats::ou_bootstrap(OC.clean, 0, 0.05, 42, dt);
+    check("ou_k_rel",     rel(EC.k, E.k),         0.0);
+    check("ou_eta_rel",   rel(EC.eta, E.eta),     0.0);
+    check("ou_sigma_rel", rel(EC.sigma, E.sigma), 0.0);
+
+    // backtest: z da Rt => stessi trade; il PnL cambia solo per il costo (entrata + uscita, f=1)
+    util::BacktestConfig cfg{E.k, E.eta, E.sigma, -1.0, 0.5, -2.326, 1.0};
+    cfg.record = util::RecordMode::MetricsOnly;
+    const auto B  = util::backtest_os(O.clean, cfg).metrics;
+    const auto BC = util::backtest_os(OC.clean, cfg).metrics;
+    check("bt_trades_diff", std::fabs(double(BC.n_trades) - double(B.n_trades)), 0.0);
+    check("bt_sum_pnl_abs", std::fabs(BC.sum_pnl - B.sum_pnl), cost_bound * double(B.n_trades));
+    return out;
+}
+
+// kernel con percorso OU per barra contro kernel a parametri fissi: percorso costante
+// => stessi trade; NaN sulle barre (entrata, uscita] di ogni trade => stesse uscite,
+// perche' la posizione aperta usa gli ultimi parametri finiti
+std::vector<Check> path_checks(const util::PriceTable& T, double dt){
+    std::vector<Check> out;
+    auto check = [&](std::string name, double value){
+        out.push_back({std::move(name), T.size(), "path", value, 0.0});
+    };
+    auto compare = [&](const std::string& tag, const util::BacktestResult& A, const util::BacktestResult& B){
+        size_t flips = std::max(A.trades.size(), B.trades.size()) - std::min(A.trades.size(), B.trades.size());
+        for (size_t i=0; i<std::min(A.trades.size(), B.trades.size()); ++i)
+            flips += A.trades[i].entry_idx != B.trades[i].entry_idx || A.trades[i].exit_idx != B.trades[i].exit_idx;
+        check(tag + "_trade_flips", double(flips));
+        check(tag + "_sum_pnl_abs", std::fabs(A.metrics.sum_pnl - B.metrics.sum_pnl));
+    };
+
+    const auto O = util::remove_outliers(T);
+    const auto E = stats::ou_bootstrap(O.clean, 0, 0.05, 42, dt);
+    const util::BacktestConfig cfg{E.k, E.eta, E.sigma, -1.0, 0.5, -2.326, 1.0};
+    const auto B = util::backtest_os(O.clean, cfg);
+
+    util::OUParamPath path;
+    path.eta.assign(O.clean.size(), cfg.eta_hat);
+    path.sigma_stat.assign(O.clean.size(), cfg.sigma_hat / std::sqrt(2.0 * cfg.k_hat));
+    compare("path_const", util::backtest_os(O.clean, cfg, path), B);
+
+    for (const auto& t : B.trades)
+        for (size_t i = t.entry_idx + 1; i <= t.exit_idx; ++i){
+            path.eta[i] = NAN;
+            path.sigma_stat[i] = NAN;
+        }
+    compare("path_nan_gaps", util::backtest_os(O.clean, cfg, path), B);
+    return out;
+}
+
+} // anon
+
+int main(int argc, char** argv){
+    Options o;
+    for (int i=1; i<argc; ++i){
+        const std::string a = argv[i];
+        auto val = [&]()->std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        if      (a == "--min-rows") o.min_rows = parse_count(val());
+        else if (a == "--max-rows") o.max_rows = parse_count(val());
+        else if (a == "--min-time") o.min_time = std::stod(val());
+        else if (a == "--max-reps") o.max_reps = std::max<size_t>(1, parse_count(val()));
+        else if (a == "--filter")   o.filter = val();
+        else if (a == "--out")      o.out = val();
+        else if (a == "--dir")      o.dir = val();
+        else {
+            std::cerr << "Usage: Arbitrage_bench [--min-rows N] [--max-rows N] [--min-time s]"
+                         " [--max-reps N] [--filter name] [--out file.json] [--dir tmpdir]\n";
+            return a == "--help" ? 0 : 2;
+        }
+    }
+    auto enabled = [&](const std::string& name){
+        return o.filter.empty() || name.find(o.filter) != std::string::npos;
+    };
+
+    std::vector<Result> results;
+    auto add = [&](Result r){ print_row(r); results.push_back(std::move(r)); };
+    std::vector<Check> checks;
+
+    volatile double sink = 0.0;     // impedisce di eliminare il lavoro misurato
+    const double dt_min = 1.0 / (365.0 * 24.0 * 60.0);
+
+    // ---------- casi scalati sul numero di righe: 10^3 .. max_rows ----------
+    for (size_t n = o.min_rows; n <= o.max_rows; n *= 10){
+        const bool need_table = enabled("load_csv") || enabled("remove_outliers") ||
+                                enabled("trim_and_split") || enabled("ou_mle") ||
+                                enabled("ou_bootstrap") || enabled("backtest_os") ||
+                                enabled("compact_remove_outliers") || enabled("compact_ou_bootstrap") ||
+                                enabled("compact_backtest_os") || enabled("compact_check") ||
+                                enabled("path_check");
+        if (!need_table) break;
+        const util::PriceTable T = make_table(n);
+
+        if (enabled("load_csv")){
+            const std::string path = o.dir + "/bench_prices.csv";
+            const size_t bytes = write_csv(path, T);
+            // il loader scrive le intestazioni su stderr: silenziato durante la misura
+            std::streambuf* old = std::cerr.rdbuf(nullptr);
+            auto f = [&]{
+                auto t = util::load_and_process_price_data_csv(
+                    path, "*", {"HOc2_Bid Close", "HOc2_Ask Close", "LGOc6_Bid Close", "LGOc6_Ask Close"},
+                    std::nullopt, std::nullopt, {1.0, 1.0});
+                sink = sink + static_cast<double>(t.size());
+            };
+            auto r = run_case(o, "load_csv", n, "row", "';' CSV, 4 quote columns", f);
+            std::cerr.rdbuf(old);
+            r.input_bytes = bytes;
+            add(std::move(r));
+            std::remove(path.c_str());
+        }
+        if (enabled("remove_outliers")){
+            auto f = [&]{ sink = sink + static_cast<double>(util::remove_outliers(T).clean.size()); };
+            add(run_case(o, "remove_outliers", n, "row", "", f));
+        }
+        if (enabled("trim_and_split")){
+            auto f = [&]{
+                auto [is, os] = util::trim_and_split_price_table(T, 8, 16, 17, 20, 9);
+                sink = sink + static_cast<double>(is.size() + os.size());
+            };
+            add(run_case(o, "trim_and_split", n, "row", "IS 8-16, OS excl 17-20, split 9 months", f));
+        }
+        if (enabled("ou_mle")){
+            auto f = [&]{ sink = sink + stats::ou_bootstrap(T, 0, 0.05, 42, dt_min).k; };
+            add(run_case(o, "ou_mle", n, "row", "ou_bootstrap with M=0", f));
+        }
+        if (enabled("ou_bootstrap")){
+            const int M = 10;
+            auto f = [&]{ sink = sink + stats::ou_bootstrap(T, M, 0.05, 42, dt_min).CI_k[0]; };
+            auto r = run_case(o, "ou_bootstrap", n * M, "path", "M=10, rows = bars x M", f);
+            add(std::move(r));
+        }
+        if (enabled("backtest_os")){
+            const auto R = stats::ou_bootstrap(T, 0, 0.05, 42, dt_min);
+            util::BacktestConfig cfg{R.k, R.eta, R.sigma, -1.0, 0.5, -2.326, 1.0};
+            auto f_full = [&]{ sink = sink + util::backtest_os(T, cfg).metrics.sum_pnl; };
+            add(run_case(o, "backtest_os", n, "row", "Full record, symmetric, quoted costs", f_full));
+            cfg.record = util::RecordMode::MetricsOnly;
+            auto f_m = [&]{ sink = sink + util::backtest_os(T, cfg).metrics.sum_pnl; };
+            add(run_case(o, "backtest_os_metrics", n, "row", "MetricsOnly", f_m));
+        }
+        if (enabled("compact_remove_outliers") || enabled("compact_ou_bootstrap") || enabled("compact_backtest_os")){
+            // stessi stadi sulle colonne float32 (40 byte/riga contro 88), Rt in double dai mid pieni
+            const auto C = util::CompactPriceTable::from(T, util::PriceStorage::Float32);
+            if (enabled("compact_remove_outliers")){
+                auto f = [&]{ sink = sink + static_cast<double>(util::remove_outliers(C).clean.size()); };
+                add(run_case(o, "compact_remove_outliers", n, "row", "f32 prices", f));
+            }
+            if (enabled("compact_ou_bootstrap")){
+                const int M = 10;
+                auto f = [&]{ sink = sink + stats::ou_bootstrap(C, M, 0.05, 42, dt_min).CI_k[0]; };
+                add(run_case(o, "compact_ou_bootstrap", n * M, "path", "f32 prices, M=10", f));
+            }
+            if (enabled("compact_backtest_os")){
+                const auto R = stats::ou_bootstrap(C, 0, 0.05, 42, dt_min);
+                util::BacktestConfig cfg{R.k, R.eta, R.sigma, -1.0, 0.5, -2.326, 1.0};
+                cfg.record = util::RecordMode::MetricsOnly;
+                auto f = [&]{ sink = sink + util::backtest_os(C, cfg).metrics.sum_pnl; };
+                add(run_case(o, "compact_backtest_os", n, "row", "f32 prices, MetricsOnly", f));
+            }
+        }
+        if (enabled("compact_check")){
+            const size_t first = checks.size();
+            for (auto& c : compact_checks(T, util::PriceStorage::Float32, {0.0, 0.0}, dt_min))
+                checks.push_back(std::move(c));
+            // Ticks32 su quote sulla griglia, come i dati reali: tick HO e LGO in $/bbl
+            const std::array<double,2> tick{1e-4 * 42.0, 0.25 / 7.44};
+            for (auto& c : compact_checks(snap_to_ticks(T, tick), util::PriceStorage::Ticks32, tick, dt_min))
+                checks.push_back(std::move(c));
+            for (size_t i = first; i < checks.size(); ++i) print_check(checks[i]);
+        }
+        if (enabled("path_check")){
+            const size_t first = checks.size();
+            for (auto& c : path_checks(T, dt_min)) checks.push_back(std::move(c));
+            for (size_t i = first; i < checks.size(); ++i) print_check(checks[i]);
+        }
+        if (n > o.max_rows / 10) break;     // evita overflow di n *= 10
+    }
+
+    // ---------- funzioni scalari: n chiamate su una griglia di argomenti ----------
+    // (costo per chiamata indipendente da n; limite 10^6 per tenere brevi le ripetizioni)
+    const size_t max_calls = std::min<size_t>(o.max_rows, 1000000);
+    for (size_t n = o.min_rows; n <= max_calls; n *= 10){
+        if (enabled("erfid_matlab")){
+            auto f = [&]{
+                double s = 0.0;
+                for (size_t i=0; i<n; ++i){
+                    const double x = 0.5 + 2.5 * static_cast<double>(i) / n;
+                    s += util::erfid_matlab(x, -x);
+                }
+                sink = sink + s;
+            };
+            add(run_case(o, "erfid_matlab", n, "call", "x in [0.5,3], y=-x", f));
+        }
+        if (enabled("long_return")){
+            auto f = [&]{
+                double s = 0.0;
+                for (size_t i=0; i<n; ++i){
+                    const double d = -0.5 - 1.5 * static_cast<double>(i) / n;
+                    auto [mu, fs] = util::long_return(d, 0.5, 0.002, -2.326, 0.3, NAN);
+                    s += mu + fs;
+                }
+                sink = sink + s;
+            };
+            add(run_case(o, "long_return", n, "call", "d in [-2,-0.5], f = f*", f));
+        }
+        if (n > max_calls / 10) break;
+    }
+
+    // ---------- optimal_trading_bands: una chiamata, non dipende dalle righe ----------
+    if (enabled("optimal_trading_bands")){
+        for (double f_in : {1.0, static_cast<double>(NAN)}){
+            auto f = [&]{
+                auto B = util::optimal_trading_bands(1, -1.96, f_in, 50.0, 0.3, 0.002, 0.05, 100);
+                sink = sink + B.d_estimated;
+            };
+            add(run_case(o, std::isnan(f_in) ? "optimal_trading_bands_fopt" : "optimal_trading_bands",
+                         1, "call", std::isnan(f_in) ? "l=-1.96, f=NaN (f*)" : "l=-1.96, f=1", f));
+        }
+    }
+
+    if (o.out.empty()) write_json(std::cout, o, results, checks);
+    else {
+        std::ofstream f(o.out);
+        if (!f) { std::cerr << "Cannot write " << o.out << "\n"; return 1; }
+        write_json(f, o, results, checks);
+        std::cerr << "JSON written to " << o.out << "\n";
+    }
+    const bool checks_ok = std::all_of(checks.begin(), checks.end(), [](const Check& c){ return c.ok(); });
+    return checks_ok ? 0 : 3;
+}
@@ -0,0 +1,130 @@
+// Writer benchmark: iostream path used by main.cpp vs util::CsvWriter.
+// Usage: Arbitrage_writer_bench [rows=2000000] [dir=.]
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "utilities/ResultWriter.hpp"
+
+namespace {
+
+struct Row {
+    std::string t0, t1;
+    double z0, z1, x0, x1, f, costs, pnl;
+    size_t bars;
+};
+
+std::vector<Row> make_rows(size_t n){
+    std::mt19937_64 rng(7);
+    std::normal_distribution<double> N(0.0, 1.0);
+    std::vector<Row> v(n);
+    for (size_t i=0; i<n; ++i){
+        auto& r = v[i];
+        r.t0 = "2016-01-22 00:00:00"; r.t1 = "2016-02-03 11:30:00";
+        r.z0 = N(rng); r.z1 = N(rng);
+        r.x0 = 0.01*N(rng); r.x1 = 0.01*N(rng);
+        r.f = (i & 1) ? 1.0 : -1.0;
+        r.costs = 0.002 + 1e-4*N(rng);
+        r.pnl = 0.01*N(rng);
+        r.bars = i % 500;
+    }
+    return v;
+}
+
+template <class F>
+double time_s(F&& f){
+    const auto t0 = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+long file_size(const std::string& p){
+    std::ifstream f(p, std::ios::binary | std::ios::ate);
+    return f ? static_cast<long>(f.tellg()) : -1;
+}
+
+void report(const char* name, double s, size_t n, const std::string& path){
+    const double mb = file_size(path) / 1e6;
+    std::cout << std::left << std::setw(28) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << 1e9 * s / n << " ns/row"
+              << std::setw(9) << mb / s << " MB/s\n";
+}
+
+} // anon
+
+int main(int argc, char** argv){
+    const size_t n = argc > 1 ? std::stoull(argv[1]) : 2000000;
+    const std::string dir = argc > 2 ? argv[2] : ".";
+    const auto rows = make_rows(n);
+    const std::string p_os = dir + "/bench_ostream.csv";
+    const std::string p_ss = dir + "/bench_fmt6.csv";
+    const std::string p_w  = dir + "/bench_writer.csv";
+
+    std::cout << "rows: " << n << "\n";
+
+    // 1) ofstream << double (os_trades.csv / os_equity.csv)
+    report("ofstream <<", time_s([&]{
+        std::ofstream f(p_os);
+        f << "entry_time,exit_time,z_entry,z_exit,x_entry,x_exit,f,costs,pnl,bars\n";
+        for (const auto& r : rows)
+            f << r.t0 << "," << r.t1 << "," << r.z0 << "," << r.z1 << ","
+              << r.x0 << "," << r.x1 << "," << r.f << "," << r.costs << ","
+              << r.pnl << "," << r.bars << "\n";
+    }), n, p_os);
+
+    // 2) ostringstream per valore (fmt6 di optimal_bands_results.csv)
+    auto fmt6 = [](double x)->std::string{
+        std::ostringstream oss;
+        if (std::isfinite(x)) { oss << std::fixed << std::setprecision(6) << x; }
+        return oss.str();
+    };
+    report("ofstream + fmt6", time_s([&]{
+        std::ofstream f(p_ss);
+        for (const auto& r : rows)
+            f << fmt6(r.z0) << "," << fmt6(r.z1) << "," << fmt6(r.x0) << "," << fmt6(r.x1) << ","
+              << fmt6(r.f) << "," << fmt6(r.costs) << "," << fmt6(r.pnl) << "\n";
+    }), n, p_ss);
+
+    const util::CsvSchema schema{
+        {"entry_time", util::ColFmt::Text}, {"exit_time", util::ColFmt::Text},
+        {"z_entry"}, {"z_exit"}, {"x_entry"}, {"x_exit"},
+        {"f"}, {"costs"}, {"pnl"}, {"bars", util::ColFmt::Int}
+    };
+    auto run_writer = [&](bool bg, const util::CsvSchema& sc, bool fixed_only){
+        util::WriterOptions o; o.background = bg;
+        util::CsvWriter w(p_w, sc, o);
+        for (const auto& r : rows){
+            if (fixed_only) w.add(r.z0).add(r.z1).add(r.x0).add(r.x1).add(r.f).add(r.costs).add(r.pnl);
+            else            w.add(r.t0).add(r.t1).add(r.z0).add(r.z1).add(r.x0).add(r.x1)
+                             .add(r.f).add(r.costs).add(r.pnl).add(r.bars);
+            w.end_row();
+        }
+        w.close();
+    };
+
+    report("CsvWriter (sync)", time_s([&]{ run_writer(false, schema, false); }), n, p_w);
+    report("CsvWriter (background)", time_s([&]{ run_writer(true, schema, false); }), n, p_w);
+
+    // stesso contenuto dell'ofstream? (le 3 colonne iniziali coincidono byte per byte)
+    {
+        std::ifstream a(p_os, std::ios::binary), b(p_w, std::ios::binary);
+        std::stringstream sa, sb; sa << a.rdbuf(); sb << b.rdbuf();
+        std::cout << "identical to ofstream output: " << (sa.str() == sb.str() ? "yes" : "NO") << "\n";
+    }
+
+    util::CsvSchema fixed6;
+    for (const char* c : {"z_entry","z_exit","x_entry","x_exit","f","costs","pnl"})
+        fixed6.push_back({c, util::ColFmt::Fixed, 6});
+    report("CsvWriter fixed6 (bg)", time_s([&]{ run_writer(true, fixed6, true); }), n, p_w);
+
+    std::remove(p_os.c_str()); std::remove(p_ss.c_str()); std::remove(p_w.c_str());
+    return 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace util {
+
+/**
+ * Mark/rewind bump arena usable as a std::pmr::memory_resource.
+ * - allocate(): bumps a pointer in the current block; when it does not fit the
+ *   next kept block is used, or a new one (at least twice the last) is taken
+ *   from the upstream resource. deallocate() is a no-op.
+ * - rewind(mark): everything allocated after mark becomes reusable; blocks are
+ *   kept, so a loop that rewinds every iteration stops touching the heap after
+ *   the first one.
+ * - Rewinding to empty keeps at most retain_bytes of blocks (the rest goes back
+ *   upstream), so one huge run does not pin its peak for the thread's lifetime.
+ * Not thread-safe: one arena per thread (thread_arena()).
+ */
+class Arena : public std::pmr::memory_resource {
+public:
+    struct Mark { size_t block = 0, offset = 0; };
+
+    explicit Arena(size_t first_block = size_t(64) << 10,
+                   size_t retain_bytes = size_t(64) << 20,
+                   std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    Mark mark() const { return {cur_, off_}; }
+    void rewind(Mark m);
+    void release();                             // every block back upstream
+
+    size_t used_bytes() const;
+    size_t reserved_bytes() const { return reserved_; }
+    size_t high_water() const { return high_water_; }
+
+private:
+    void* do_allocate(size_t n, size_t align) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+
+    struct Block { std::byte* p; size_t size; };
+    std::vector<Block> blocks_;
+    size_t cur_ = 0, off_ = 0;                  // blocco corrente e offset al suo interno
+    size_t first_block_, retain_;
+    size_t reserved_ = 0, high_water_ = 0;
+    std::pmr::memory_resource* up_;
+};
+
+// arena of the calling thread (pool workers keep theirs across tasks)
+Arena& thread_arena();
+
+/**
+ * RAII scratch region on the thread arena: on exit everything allocated inside
+ * is reusable. pmr containers using resource() must be declared after the
+ * scope (destroyed before it). Scopes nest; the outermost one resets the arena
+ * between runs.
+ */
+class ScratchScope {
+public:
+    ScratchScope() : a_(thread_arena()), m_(a_.mark()) {}
+    ~ScratchScope() { a_.rewind(m_); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    std::pmr::memory_resource* resource() { return &a_; }
+
+private:
+    Arena& a_;
+    Arena::Mark m_;
+};
+
+} // namespace util
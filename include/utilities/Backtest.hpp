@@ -2,6 +2,9 @@
 #include <vector>
 #include <string>
 #include <optional>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
 
 namespace util {
 
@@ -10,9 +13,10 @@ struct Trade {
     size_t entry_idx = 0;
     size_t exit_idx  = 0;
 
-    // timestamps (as read from CSV)
-    std::string entry_time;
-    std::string exit_time;
+    // timestamps as epoch seconds (see iso_to_epoch_seconds); the original
+    // strings stay in the OS table at entry_idx/exit_idx
+    std::int64_t entry_ts = 0;
+    std::int64_t exit_ts  = 0;
 
     // standardized z at entry/exit (sigma-units)
     double z_entry = 0.0;
@@ -35,6 +39,18 @@ struct Trade {
     size_t bars = 0;
 };
 
+// what backtest_os stores besides the metrics
+enum class RecordMode {
+    Full,        // trades + sparse equity path: O(trades) memory
+    MetricsOnly  // metrics only: O(1) memory
+};
+
+// per-bar transaction cost model
+enum class CostModel {
+    Quoted,  // 0.5*c_t at entry and exit, c_t from bid/ask (see backtest_os)
+    Zero     // gross PnL, no costs
+};
+
 struct BacktestConfig {
     // OU params
     double k_hat;        // speed
@@ -48,6 +64,10 @@ struct BacktestConfig {
     double f;
     // allow symmetric mirror trades (short-spread when z >= -d)
     bool symmetric = true;
+    // cost model
+    CostModel cost = CostModel::Quoted;
+    // storage mode for trades / equity
+    RecordMode record = RecordMode::Full;
 };
 
 struct BacktestMetrics {
@@ -65,18 +85,82 @@ struct BacktestMetrics {
     double sharpe_bar = 0.0;
 };
 
+// Online metrics: updated once per closed trade, O(1) memory.
+// Bars with no closed trade leave equity unchanged, so they never move peak/max_dd,
+// and the per-bar Sharpe only sees non-zero equity diffs (= trade PnLs) -> Welford.
+struct MetricsAccumulator {
+    size_t n_trades = 0;
+    size_t winners  = 0;
+    double sum_pnl  = 0.0;
+    double equity   = 0.0;
+    double peak     = 0.0;
+    double max_dd   = 0.0;
+    // Welford on non-zero PnLs
+    size_t n_nz    = 0;
+    double mean_nz = 0.0;
+    double m2_nz   = 0.0;
+
+    void on_close(double pnl){
+        ++n_trades;
+        if (pnl > 0.0) ++winners;
+        sum_pnl += pnl;
+        equity  += pnl;
+        peak   = std::max(peak, equity);
+        max_dd = std::min(max_dd, equity - peak);
+        if (pnl != 0.0){
+            ++n_nz;
+            const double delta = pnl - mean_nz;
+            mean_nz += delta / static_cast<double>(n_nz);
+            m2_nz   += delta * (pnl - mean_nz);
+        }
+    }
+
+    BacktestMetrics finish() const {
+        BacktestMetrics m;
+        m.n_trades   = n_trades;
+        m.winners    = winners;
+        m.hit_ratio  = (n_trades ? (double)winners / n_trades : 0.0);
+        m.sum_pnl    = sum_pnl;
+        m.avg_pnl    = (n_trades ? sum_pnl / n_trades : 0.0);
+        m.equity_end = equity;
+        m.max_dd     = max_dd; // negative number (log drawdown)
+        if (n_nz > 1){
+            const double var = m2_nz / (n_nz - 1);
+            const double s   = std::sqrt(std::max(0.0, var));
+            m.sharpe_bar = (s > 0.0 ? mean_nz / s : 0.0);
+        }
+        return m;
+    }
+};
+
+// log-equity after bar idx; equity is flat between two points
+struct EquityPoint {
+    size_t idx = 0;
+    double log_equity = 0.0;
+};
+
 struct BacktestResult {
     BacktestMetrics metrics;
     std::vector<Trade> trades;
-    // equity path (log-equity, starts at 0)
-    std::vector<double> equity_path;
-    // time stamps matching equity
-    std::vector<std::string> equity_time;
+    // sparse equity path: one point per change (log-equity starts at 0 before the first point)
+    std::vector<EquityPoint> equity;
+};
+
+// Expand the sparse equity path to one value per bar (n_bars values).
+std::vector<double> dense_equity(const BacktestResult& R, size_t n_bars);
+
+// Per-bar OU parameters for a time-varying z-score (see stats::rolling_ou_path).
+// Bar i uses z_i = (X_i - eta[i]) / sigma_stat[i]. A non-finite z_i never opens a
+// trade; an open position checks TP/SL on such bars with the last finite (eta, sigma_stat).
+struct OUParamPath {
+    std::vector<double> eta;
+    std::vector<double> sigma_stat;
 };
 
 // Forward declare your table/row
 struct PriceRow;
 using PriceTable = std::vector<PriceRow>;
+class CompactPriceTable;
 
 /**
  * Run out-of-sample backtest on OS data.
@@ -87,10 +171,26 @@ using PriceTable = std::vector<PriceRow>;
  * - Costs: use tick-by-tick actual log costs:
  *      c_t = log(Ask1/Bid1) + log(Ask2/Bid2)
  *   We charge 0.5*c_t at entry and 0.5*c_t at exit per unit leverage |f|.
+ * - The loop is specialized at compile time on (symmetric, cost, record);
+ *   cfg is mapped to the matching instantiation once per call.
  */
 BacktestResult backtest_os(
     const PriceTable& os,
     const BacktestConfig& cfg
 );
 
+// Same kernel on 32-bit price columns: z from the double Rt column, costs from
+// the decoded bid/ask on entry/exit bars only.
+BacktestResult backtest_os(
+    const CompactPriceTable& os,
+    const BacktestConfig& cfg
+);
+
+// Same rules with time-varying OU parameters (cfg.k_hat/eta_hat/sigma_hat unused).
+BacktestResult backtest_os(
+    const PriceTable& os,
+    const BacktestConfig& cfg,
+    const OUParamPath& path
+);
+
 } // namespace util
\ No newline at end of file
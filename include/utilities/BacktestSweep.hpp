@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "utilities/Backtest.hpp"
+
+namespace util {
+
+struct SweepResult {
+    // one entry per input config (same order)
+    std::vector<BacktestMetrics> metrics;
+    // per-config trade lists (filled only when keep_trades = true)
+    std::vector<std::vector<Trade>> trades;
+};
+
+/**
+ * Run many backtest configs over the same OS table in a single pass.
+ * - x_t and the half-cost column 0.5*c_t are computed once for all configs
+ * - z_t is computed once when every config shares (k, eta, sigma),
+ *   otherwise per config with the same formula used by backtest_os
+ * - per-config state machines (Flat/Long/Short) are kept in SoA layout and
+ *   advanced together, bar by bar
+ * Entry/exit rules, costs and metrics (MetricsAccumulator) match backtest_os;
+ * no equity path is stored.
+ */
+SweepResult backtest_sweep(
+    const PriceTable& os,
+    const std::vector<BacktestConfig>& cfgs,
+    bool keep_trades = false
+);
+
+} // namespace util
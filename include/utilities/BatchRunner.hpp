@@ -0,0 +1,145 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+#include "utilities/TradeBootstrap.hpp"
+
+namespace util {
+
+class StageCache;
+
+// Everything main.cpp hard-codes for one study (defaults = main's literals)
+struct RunSpec {
+    std::string name;
+
+    // load
+    std::string csv_path = "HO-LGO.csv";
+    std::string time_col = "*";
+    std::array<std::string,4> bid_ask_cols{"HOc2_Bid Close", "HOc2_Ask Close",
+                                           "LGOc6_Bid Close", "LGOc6_Ask Close"};
+    std::optional<std::array<std::string,2>> mid_cols;
+    std::optional<std::array<double,2>> ticks;
+    std::array<double,2> convs{42.0, 1.0/7.44};
+    std::optional<std::string> start_date;
+    std::optional<std::string> end_date;
+
+    // tick -> bar resampling before trim/split (0 => rows are already bars, dt 30 min);
+    // with bars the OU dt is measured on the clean IS (measure_dt_years)
+    std::int64_t bar_seconds = 0;
+
+    // trim & split: IS window for calibration/bands, raw IS window for the cost C,
+    // OS window excluded
+    std::array<double,2> IS_hours{8.0, 16.0};
+    std::array<double,2> cost_hours{9.0, 16.0};
+    std::array<double,2> OS_exclude_hours{17.0, 20.0};
+    int split_months = 9;
+
+    // calibration
+    int M_boot = 1000;
+    double alpha_CI = 0.05;
+    std::uint64_t seed = 42;
+
+    // bands sweep (f NaN => f*)
+    std::vector<double> l_list{-1.282, -1.645, -1.96, -2.326};
+    std::vector<double> f_list{1.0, 2.0, 5.0, std::numeric_limits<double>::quiet_NaN()};
+    int M_opt = 100000;
+    double alpha = 0.05;
+    int grid = 100;
+
+    // backtest OS + trade bootstrap
+    double l_bt = -1.96;
+    double f_bt = 1.0;
+    bool symmetric = true;
+    size_t trade_resamples = 10000;
+
+    std::string output_dir;         // "" => outputs/batch/<name>
+};
+
+/**
+ * Job file: INI-like text, one [run <name>] section per run.
+ * - "key = value" lines; '#' or ';' start a comment; keys of [defaults] apply
+ *   to every run declared after it, the run's own keys override them.
+ * - Keys: csv, time_col, bid_ask_cols (4 names), mid_cols (2), ticks (2), convs (2),
+ *   start_date, end_date, bar (seconds), is_hours (2), cost_hours (2), os_exclude_hours (2),
+ *   split_months, m_boot, alpha_ci, seed, l_list, f_list ("opt" => f*), m_opt,
+ *   alpha, grid, l_bt, f_bt ("opt" => f*), symmetric, trade_resamples, output_dir.
+ *   Numbers must be finite; "opt" is accepted only by f_list and f_bt.
+ *   Lists are comma separated; "none" clears an optional key.
+ * - Sweeps: "key = a | b | c" expands a run into one run per alternative
+ *   (cartesian product over swept keys), named "<name>/key=a,...".
+ * Throws std::runtime_error with file:line on unknown keys or bad values.
+ */
+std::vector<RunSpec> parse_job_file(const std::string& path);
+
+struct RunOutcome {
+    std::string name;
+    bool ok = false;
+    std::string error;              // filled when ok == false
+
+    stats::OUBootstrapResult ou;    // boot_* vectors dropped
+    double C = 0.0;
+    std::vector<OptimalBandsResult> bands;   // l_list x f_list, row-major
+    OptimalBandsResult bands_bt;
+    BacktestMetrics metrics;
+    TradeBootstrapResult trade_ci;
+};
+
+struct BatchOptions {
+    unsigned n_threads = 0;         // shared pool, 0 => hardware_concurrency
+    size_t max_live_inputs = 0;     // input files in flight (raw tables + intermediates), 0 => n_threads
+    StageCache* cache = nullptr;    // optional on-disk cache (ARBITRAGE_CACHE)
+    bool write_outputs = true;      // per-run CSVs in RunSpec::output_dir
+};
+
+struct BatchReport {
+    std::vector<RunOutcome> runs;   // same order as the specs
+    size_t n_failed = 0;
+    size_t stages_requested = 0;    // stage instances the runs ask for
+    size_t stages_executed = 0;     // after deduplication
+    double wall_s = 0.0;
+    double runs_per_hour = 0.0;
+};
+
+/**
+ * Runs every spec as one TaskGraph on a shared ThreadPool.
+ * - Stages are keyed by their parameter chain (load params -> split hours ->
+ *   ... -> backtest params): runs sharing a prefix share the nodes, so an
+ *   identical load, split or OU calibration runs once for the whole batch.
+ * - Bounded memory: a stage output is dropped as soon as its last consumer has
+ *   finished, and runs are grouped by input file with at most max_live_inputs
+ *   groups in flight (the next load waits for an earlier group to finish).
+ * - A failing stage fails only the runs that depend on it (RunOutcome::error).
+ * - With a cache the keys are rooted at the CSV contents, so results persist
+ *   across invocations.
+ */
+BatchReport run_batch(const std::vector<RunSpec>& specs, const BatchOptions& opt = {});
+
+struct RunCalibration {
+    stats::OUBootstrapResult ou;
+    double C = 0.0;                 // avg log cost on the raw IS (cost_hours)
+    OptimalBandsResult bands;       // (l_bt, f_bt)
+    BacktestConfig cfg;             // OU estimates + bands + (l_bt, f_bt, symmetric)
+    PriceTable clean_OS;            // what backtest_os runs on
+};
+
+/**
+ * run_batch's stages for one spec up to the backtest, on the calling thread
+ * and without the cache: load (+ resample to bar_seconds), trim & split (IS and cost windows),
+ * remove_outliers, ou_bootstrap, cost C, bands at (l_bt, f_bt). No l/f sweep.
+ * Throws std::runtime_error when no rows are loaded.
+ */
+RunCalibration calibrate_run(const RunSpec& spec);
+
+// per-run CSVs (same schemas as main) + outputs/batch summary row per run
+bool write_run_outputs(const RunSpec& spec, const RunOutcome& out,
+                       const PriceTable& clean_OS, const BacktestResult& bt);
+bool write_batch_summary(const std::string& path, const BatchReport& R);
+
+} // namespace util
@@ -0,0 +1,161 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/BatchRunner.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+
+namespace util {
+
+// come sono tenuti i 6 prezzi di una riga (Rt resta una colonna double, calcolata dai mid pieni)
+enum class PriceStorage {
+    Float32,    // float: ~7 cifre significative, errore relativo <= 2^-24 per prezzo
+    Ticks32     // int32 = multipli di mezzo tick (i mid cadono a metà tick): esatto sulla griglia
+};
+
+// "f32" | "ticks"; std::invalid_argument altrimenti
+PriceStorage parse_price_storage(const std::string& s);
+const char* price_storage_name(PriceStorage m);
+
+/**
+ * PriceTable with 32-bit prices: ts (epoch s, int64) + Rt (double) + 6 price
+ * columns of 4 bytes, 40 bytes a row against 88 for a PriceRow (Time string +
+ * 7 doubles), one contiguous column per field.
+ * - Rt is computed in double from the full-precision mids before they are
+ *   rounded (= the loader's log(Mid1/Mid2), 0 when a mid is <= 0), so the
+ *   outlier, OU and z-score loops see the same spread as the double table.
+ * - Prices decode to double; costs and every statistic accumulate in double.
+ * - Ticks32: tick = tick size of each leg in table units (loader ticks x convs);
+ *   prices are stored as round(p / (tick/2)) and push_back throws
+ *   std::out_of_range outside int32.
+ * - Rows keep the order they are pushed in.
+ */
+class CompactPriceTable {
+public:
+    static constexpr size_t ROW_BYTES = sizeof(std::int64_t) + sizeof(double) + 6 * sizeof(std::uint32_t);
+
+    // Ticks32 senza tick > 0 su entrambe le gambe: std::invalid_argument
+    explicit CompactPriceTable(PriceStorage mode = PriceStorage::Float32,
+                               std::array<double,2> tick = {0.0, 0.0});
+
+    static CompactPriceTable from(const PriceTable& T, PriceStorage mode,
+                                  std::array<double,2> tick = {0.0, 0.0});
+
+    void reserve(size_t n);
+    void push_back(const PriceRow& r);                   // tiene r.Rt; Time non valido: std::invalid_argument
+    void push_back(std::int64_t ts, double bid1, double ask1, double mid1,
+                   double bid2, double ask2, double mid2);  // Rt dai mid double
+    void append(const CompactPriceTable& src, size_t i);  // riga i di src (stessa codifica): copia dei bit
+
+    size_t size()  const { return ts_.size(); }
+    bool   empty() const { return ts_.empty(); }
+    size_t bytes() const { return size() * ROW_BYTES; }
+    PriceStorage storage() const { return mode_; }
+    std::array<double,2> tick() const { return tick_; }
+
+    std::int64_t ts(size_t i) const { return ts_[i]; }
+    double bid1(size_t i) const { return dec(0, i); }
+    double ask1(size_t i) const { return dec(1, i); }
+    double mid1(size_t i) const { return dec(2, i); }
+    double bid2(size_t i) const { return dec(3, i); }
+    double ask2(size_t i) const { return dec(4, i); }
+    double mid2(size_t i) const { return dec(5, i); }
+    double rt(size_t i) const { return rt_[i]; }
+    std::span<const double> rt_column() const { return rt_; }
+
+    PriceRow row(size_t i) const;                        // Time ricostruito da ts
+    PriceTable to_table() const;
+
+    // righe con keep[i] (stessa modalità e tick)
+    CompactPriceTable select(const std::vector<bool>& keep) const;
+
+private:
+    double dec(int c, size_t i) const {
+        const std::uint32_t v = px_[c][i];
+        if (mode_ == PriceStorage::Float32) return double(std::bit_cast<float>(v));
+        return double(std::int32_t(v)) * q_[c < 3 ? 0 : 1];
+    }
+    std::uint32_t enc(int c, double p) const;
+
+    PriceStorage mode_;
+    std::array<double,2> tick_;
+    std::array<double,2> q_{};                           // mezzo tick per gamba (Ticks32)
+    std::vector<std::int64_t> ts_;
+    std::vector<double> rt_;
+    std::array<std::vector<std::uint32_t>, 6> px_;      // bid1 ask1 mid1 bid2 ask2 mid2
+};
+
+/**
+ * Streams spec's CSV (stream_price_data_csv: same parsing, convs and date
+ * filters) straight into a CompactPriceTable: no double table is built.
+ * Ticks32 takes the tick sizes from spec.ticks x spec.convs and throws
+ * std::runtime_error when spec.ticks is not set. Rows whose Time does not
+ * parse are dropped (bad_time, if given, counts them).
+ */
+CompactPriceTable load_compact_price_data(const RunSpec& spec, PriceStorage mode,
+                                          size_t* bad_time = nullptr);
+
+// trim_and_split_price_table sulle colonne compatte (ordinamento stabile per ts)
+std::pair<CompactPriceTable, CompactPriceTable> trim_and_split_price_table(
+    const CompactPriceTable& data,
+    std::array<double,2> IS_hours,
+    std::array<double,2> OS_exclude_hours,
+    int split_months);
+
+struct CompactOutlierResult {
+    CompactPriceTable clean;
+    std::vector<bool> is_outlier;
+};
+
+// remove_outliers (IQR del log-spread, poi antipersistenza) con Rt in double;
+// le righe si marcano per indice, non per (Time, Rt)
+CompactOutlierResult remove_outliers(const CompactPriceTable& data);
+
+// costo di transazione di una riga log(Ask1/Bid1) + log(Ask2/Bid2); NaN se un prezzo è <= 0
+inline double log_cost(double bid1, double ask1, double bid2, double ask2){
+    if (!(bid1 > 0.0 && ask1 > 0.0 && bid2 > 0.0 && ask2 > 0.0))
+        return std::numeric_limits<double>::quiet_NaN();
+    return std::log(ask1 / bid1) + std::log(ask2 / bid2);
+}
+
+// costo medio di transazione (log_cost) sulle righe con costo finito, 0 se nessuna;
+// n_used, se dato, riceve il numero di righe mediate
+double avg_log_cost(const PriceTable& data, size_t* n_used = nullptr);
+double avg_log_cost(const CompactPriceTable& data, size_t* n_used = nullptr);
+
+// backtest_os(const CompactPriceTable&, ...) e stats::ou_bootstrap(const CompactPriceTable&, ...)
+// sono overload in Backtest.hpp / StatisticalBootstrap.hpp
+
+struct CompactRunResult {
+    stats::OUBootstrapResult ou;    // boot_* vectors dropped
+    double C = 0.0;
+    OptimalBandsResult bands;       // (spec.l_bt, spec.f_bt)
+    BacktestMetrics metrics;
+
+    size_t rows = 0, bad_time = 0;
+    size_t IS_rows = 0, IS_clean = 0;
+    size_t OS_rows = 0, OS_clean = 0;
+    size_t table_bytes = 0;         // righe caricate x ROW_BYTES
+    double wall_ms = 0.0;
+};
+
+/**
+ * One RunSpec with compact price storage, the same stages as run_batch's
+ * (load, trim & split, cost C, remove_outliers, ou_bootstrap, bands at
+ * (l_bt, f_bt), backtest OS) on CompactPriceTable. No l/f sweep and no trade
+ * bootstrap. Throws std::runtime_error on a failing stage.
+ */
+CompactRunResult run_compact(const RunSpec& spec, PriceStorage mode);
+
+} // namespace util
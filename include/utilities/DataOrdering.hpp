@@ -3,6 +3,7 @@
 #include <string>
 #include <optional>
 #include <utility> // std::pair
+#include <cstdint>
 
 namespace util {
 
@@ -16,6 +17,15 @@ namespace util {
 
     using PriceTable = std::vector<PriceRow>;
 
+    // ---- tempi compatti ----
+    // "YYYY-MM-DD HH:MM:SS" <-> secondi dall'epoch (UTC, nessun fuso); INT64_MIN se non valido
+    // (in ingresso anche "YYYY-MM-DD" e "YYYY-MM-DD HH:MM"; altre lunghezze < 19 non valide)
+    std::int64_t iso_to_epoch_seconds(const std::string& iso_time);
+    std::string  epoch_seconds_to_iso(std::int64_t t);
+    // ora decimale di "YYYY-MM-DD HH:MM:SS" (NaN se non valido); iso + months (giorno clampato)
+    double extract_decimal_hour(const std::string& iso_time);
+    std::string add_months_iso(const std::string& iso_time, int months);
+
     // ---- dichiarazioni funzioni ----
     PriceTable build_price_table(
         const std::vector<std::string>& time,
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+
+#include "utilities/DataOrdering.hpp"
+
+namespace util {
+
+struct KalmanHedgeConfig {
+    double delta   = 1e-5;      // state drift: Q = delta/(1-delta) * I per bar
+    double obs_var = 1e-4;      // observation noise of log(Mid1) (R)
+    double alpha0  = 0.0;       // prior intercept
+    double beta0   = 1.0;       // prior hedge ratio (1:1 = the loader's Rt)
+    double p0      = 1.0;       // prior variance of alpha and beta
+};
+
+/**
+ * Online hedge ratio: log(Mid1)_t = alpha_t + beta_t * log(Mid2)_t + e_t,
+ * with (alpha, beta) a random walk. Closed-form 2x2 Kalman filter, ~20 flops
+ * per bar, O(1) memory.
+ * The spread uses the one-step-ahead beta (before seeing bar t), so it is
+ * causal: spread_t = log(Mid1_t) - beta_{t|t-1} * log(Mid2_t). The intercept
+ * is left in the spread level, where the OU eta picks it up.
+ */
+class KalmanHedge {
+public:
+    struct Step {
+        double alpha = 0.0, beta = 0.0;     // filtered state after bar t
+        double spread = 0.0;                // adaptive spread (see above)
+        double innovation = 0.0;            // y - (alpha + beta x) before update
+        double innovation_var = 0.0;
+    };
+
+    explicit KalmanHedge(const KalmanHedgeConfig& cfg = {});
+
+    // y = log(Mid1), x = log(Mid2)
+    Step update(double y, double x);
+
+    double alpha() const { return a_; }
+    double beta()  const { return b_; }
+
+private:
+    KalmanHedgeConfig cfg_;
+    double q_;
+    double a_, b_;
+    double p00_, p01_, p11_;    // covarianza simmetrica dello stato
+};
+
+struct HedgeSeries {
+    std::vector<double> alpha, beta;    // filtered, one per row
+};
+
+/**
+ * Replaces Rt with the Kalman spread in one O(n) pass, in place, so the
+ * table goes straight into remove_outliers, ou_bootstrap and backtest_os.
+ * Rows without valid mids keep Rt = 0 (as the loader) and skip the update.
+ * Note: with a moving beta the OS PnL on Rt is per unit of the hedged
+ * spread, i.e. the legs are rebalanced to beta_t every bar.
+ */
+HedgeSeries apply_kalman_hedge(PriceTable& data, const KalmanHedgeConfig& cfg = {});
+
+// Same, one independent filter per table (nightly runs over many pairs)
+std::vector<HedgeSeries> apply_kalman_hedge(std::vector<PriceTable>& tables,
+                                            const KalmanHedgeConfig& cfg = {},
+                                            unsigned n_threads = 0);
+
+} // namespace util
@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+
+namespace util {
+
+/**
+ * HDR-style latency histogram (nanoseconds), fixed memory, no allocation.
+ * - Values below 2^SUB_BITS are exact; above, every power of two is split into
+ *   2^SUB_BITS linear buckets, so the relative error is < 2^-SUB_BITS (~0.8%)
+ *   from 1 ns to the full int64 range.
+ * - record() is a couple of shifts and one increment: fine on the hot path.
+ * - percentile() returns the highest value equivalent to the bucket (as
+ *   HdrHistogram), clamped to the exact max.
+ * Not thread-safe: one histogram per thread, then merge().
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 7;
+    static constexpr std::int64_t SUB = std::int64_t(1) << SUB_BITS;
+    static constexpr size_t N_BUCKETS = size_t(64 - SUB_BITS) * SUB;
+
+    void record(std::int64_t ns){
+        if (ns < 0) ns = 0;
+        ++counts_[index_of(ns)];
+        ++n_;
+        sum_ += double(ns);
+        if (ns < min_) min_ = ns;
+        if (ns > max_) max_ = ns;
+    }
+
+    void merge(const LatencyHistogram& o);
+    void reset();
+
+    std::uint64_t count() const { return n_; }
+    std::int64_t min() const { return n_ ? min_ : 0; }
+    std::int64_t max() const { return max_; }
+    double mean() const { return n_ ? sum_ / double(n_) : 0.0; }
+
+    // p in [0, 100]; 0 if empty
+    std::int64_t percentile(double p) const;
+
+    // "n=... min p50 p90 p99 p99.9 p99.99 max" in microseconds
+    std::string summary() const;
+
+    // percentile ladder (value_us, percentile, total_count, 1/(1-p)) as HdrHistogram's
+    // percentile output, 5 steps per halving of the tail
+    bool write_percentiles_csv(const std::string& path) const;
+
+private:
+    static size_t index_of(std::int64_t v){
+        if (v < SUB) return size_t(v);
+        const int e = std::bit_width(std::uint64_t(v)) - 1;  // >= SUB_BITS
+        const int shift = e - SUB_BITS;
+        return size_t(SUB) + size_t(shift) * size_t(SUB) + size_t((v >> shift) - SUB);
+    }
+    static std::int64_t highest_of(size_t idx);
+
+    std::array<std::uint64_t, N_BUCKETS> counts_{};
+    std::uint64_t n_ = 0;
+    double sum_ = 0.0;
+    std::int64_t min_ = INT64_MAX, max_ = 0;
+};
+
+} // namespace util
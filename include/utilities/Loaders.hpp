@@ -3,6 +3,7 @@
 #include <vector>
 #include <array>
 #include <optional>
+#include <functional>
 #include "DataOrdering.hpp"
 
 namespace util {
@@ -12,6 +13,7 @@ namespace util {
      * combina "row1_row2", gestisce ','/';' e numeri con virgola.
      *
      * Se time_col == "*" tenta auto-detect: "Timestamp" oppure "*_Timestamp".
+     * Un nome vuoto in bid_ask_cols = colonna assente (bid/ask da mid ± tick/2).
      */
     PriceTable load_and_process_price_data_csv(
         const std::string& filepath,
@@ -24,4 +26,44 @@ namespace util {
         const std::optional<std::string>& end_date   = std::nullopt
     );
 
+    // riceve ogni riga dati (modificabile, può essere spostata); false => interrompe la lettura
+    using PriceRowSink = std::function<bool(PriceRow&)>;
+
+    /**
+     * Come load_and_process_price_data_csv, ma senza tabella: ogni riga valida
+     * (stesso parsing, stesse conversioni e filtri data) va a on_row nell'ordine
+     * del file, con memoria costante. Restituisce il numero di righe consegnate.
+     */
+    size_t stream_price_data_csv(
+        const std::string& filepath,
+        const std::string& time_col,
+        const std::array<std::string,4>& bid_ask_cols,
+        const std::optional<std::array<std::string,2>>& mid_cols,
+        const std::optional<std::array<double,2>>& ticks,
+        const std::array<double,2>& convs,
+        const std::optional<std::string>& start_date,
+        const std::optional<std::string>& end_date,
+        const PriceRowSink& on_row
+    );
+
+    /**
+     * Come load_and_process_price_data_csv, ma legge direttamente un .xlsx
+     * (XlsxSheetReader: zip + XML in streaming, niente export manuale in CSV).
+     * - stessa logica d'intestazione: due righe con ffill e "row1_row2";
+     *   se la seconda riga è numerica il foglio ha una sola riga di header
+     * - date come seriali Excel convertite in "YYYY-MM-DD HH:MM:SS"
+     * - sheet = numero della parte xl/worksheets/sheetN.xml
+     */
+    PriceTable load_and_process_price_data_xlsx(
+        const std::string& filepath,
+        const std::string& time_col,                       // oppure "*" per auto-detect
+        const std::array<std::string,4>& bid_ask_cols,     // {Bid1, Ask1, Bid2, Ask2}, "" = assente
+        const std::optional<std::array<std::string,2>>& mid_cols,
+        const std::optional<std::array<double,2>>& ticks,
+        const std::array<double,2>& convs,
+        const std::optional<std::string>& start_date = std::nullopt,
+        const std::optional<std::string>& end_date   = std::nullopt,
+        int sheet = 1
+    );
+
 }
\ No newline at end of file
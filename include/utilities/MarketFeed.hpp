@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/LatencyHistogram.hpp"
+#include "utilities/StreamingBacktest.hpp"
+
+namespace util {
+
+// ---- formato binario del feed ----
+// Messaggio fisso di 64 byte (una cache line), little-endian, campi allineati:
+//   0 u32 seq | 4 u16 type | 6 u16 reserved | 8 i64 ts (epoch s) | 16 i64 send_ns
+//   24 f64 rt | 32 f64 bid1 | 40 f64 ask1 | 48 f64 bid2 | 56 f64 ask2
+// TCP: messaggi contigui nello stream; UDP: un messaggio per datagramma.
+// send_ns = steady_clock (CLOCK_MONOTONIC) al momento del send: confrontabile
+// tra processi sulla stessa macchina.
+enum class FeedMsgType : std::uint16_t { Tick = 1, End = 2 };
+constexpr size_t FEED_MSG_BYTES = 64;
+
+void encode_feed_tick(std::byte* out, std::uint32_t seq, std::int64_t ts, const PriceRow& r);
+void encode_feed_end(std::byte* out, std::uint32_t seq);
+void stamp_feed_send(std::byte* msg, std::int64_t send_ns);
+
+// lettura in place di un messaggio ricevuto (nessuna copia del buffer)
+class FeedView {
+public:
+    explicit FeedView(const std::byte* p) : p_(p) {}
+
+    std::uint32_t seq()     const { return load<std::uint32_t>(0); }
+    FeedMsgType   type()    const { return FeedMsgType(load<std::uint16_t>(4)); }
+    std::int64_t  ts()      const { return load<std::int64_t>(8); }
+    std::int64_t  send_ns() const { return load<std::int64_t>(16); }
+    double rt()   const { return load<double>(24); }
+    double bid1() const { return load<double>(32); }
+    double ask1() const { return load<double>(40); }
+    double bid2() const { return load<double>(48); }
+    double ask2() const { return load<double>(56); }
+
+private:
+    template <class T> T load(size_t off) const {
+        T v;
+        std::memcpy(&v, p_ + off, sizeof v);   // una load: niente aliasing UB sui buffer di byte
+        return v;
+    }
+    const std::byte* p_;
+};
+
+enum class FeedTransport { Tcp, Udp };
+
+struct ReplayConfig {
+    FeedTransport transport = FeedTransport::Tcp;
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 0;         // TCP: porta di ascolto (0 => effimera); UDP: porta del consumer
+    double speed = 0.0;             // 0 => più veloce possibile; 1 => tempo reale; N => N volte
+    double max_gap_s = 3600.0;      // buchi più lunghi (notti, weekend) compressi a questo, in tempo feed
+};
+
+struct ReplayStats {
+    size_t messages = 0;            // tick inviati (End escluso)
+    double wall_s = 0.0;
+    double msgs_per_s = 0.0;
+};
+
+/**
+ * Replays a PriceTable as FEED_MSG_BYTES messages, paced on the rows' timestamps.
+ * - TCP: binds/listens in the constructor (port() is then valid), run() accepts
+ *   one consumer and streams to it (TCP_NODELAY, one send per tick).
+ * - UDP: run() sends one datagram per tick to host:port (a bound FeedConsumer).
+ * - Ends with a FeedMsgType::End message. Errors throw std::runtime_error.
+ */
+class ReplayServer {
+public:
+    explicit ReplayServer(const ReplayConfig& cfg);
+    ~ReplayServer();
+
+    ReplayServer(const ReplayServer&) = delete;
+    ReplayServer& operator=(const ReplayServer&) = delete;
+
+    std::uint16_t port() const { return port_; }
+    ReplayStats run(const PriceTable& data);
+
+private:
+    ReplayConfig cfg_;
+    int listen_fd_ = -1;
+    std::uint16_t port_ = 0;
+};
+
+struct FeedConsumerConfig {
+    FeedTransport transport = FeedTransport::Tcp;
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 0;         // TCP: porta del server; UDP: porta di ascolto (0 => effimera)
+    int idle_timeout_ms = 2000;     // nessun dato per tanto => fine (UDP senza End, server morto)
+    size_t recv_buffer = 1 << 16;   // byte letti per recv
+};
+
+struct FeedConsumerStats {
+    size_t messages = 0;
+    size_t lost = 0;                // buchi nei seq mai colmati (UDP)
+    size_t reordered = 0;           // arrivati dopo un seq maggiore: scartati, non passati a on_quote
+    size_t wakeups = 0;             // ritorni di epoll_wait con eventi
+    bool got_end = false;
+    LatencyHistogram latency;       // send_ns -> decisione del backtester presa
+    BacktestMetrics metrics;
+};
+
+/**
+ * Non-blocking socket + epoll (edge-triggered), single thread.
+ * - Every readable event drains the socket; complete messages are decoded in
+ *   place with FeedView and fed to StreamingBacktester::on_quote, so the run
+ *   is the backtest_os state machine tick by tick. A UDP datagram older than
+ *   one already fed is dropped (counted in reordered, not in lost).
+ * - Tick-to-decision latency = steady_clock after on_quote returns minus the
+ *   message's send_ns (same box), recorded in an HDR-style histogram.
+ * - UDP binds in the constructor (port() then valid); TCP connects in run(),
+ *   retrying until idle_timeout_ms while the server starts.
+ */
+class FeedConsumer {
+public:
+    explicit FeedConsumer(const FeedConsumerConfig& cfg);
+    ~FeedConsumer();
+
+    FeedConsumer(const FeedConsumer&) = delete;
+    FeedConsumer& operator=(const FeedConsumer&) = delete;
+
+    std::uint16_t port() const { return port_; }
+    FeedConsumerStats run(StreamingBacktester& bt, const TradeSink& on_trade = {});
+
+private:
+    FeedConsumerConfig cfg_;
+    int fd_ = -1;
+    std::uint16_t port_ = 0;
+};
+
+} // namespace util
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "utilities/Backtest.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+
+namespace util {
+
+struct MonteCarloConfig {
+    size_t n_paths = 1000;
+    size_t n_bars  = 10000;              // bars per simulated path
+    double dt = (0.5/24.0)/365.0;        // 30 min in years, as in ou_bootstrap
+    double x0 = NAN;                     // start of each path (NaN => eta)
+
+    // half-cost per bar (per unit leverage): if half_costs is not empty,
+    // each bar draws one value from it (iid), otherwise half_cost is used
+    std::vector<double> half_costs;
+    double half_cost = 0.0;
+
+    // draw (k, eta, sigma) per path from the bootstrap samples instead of
+    // using the point estimates
+    bool param_uncertainty = false;
+
+    std::vector<double> quantiles{0.05, 0.25, 0.5, 0.75, 0.95};
+    unsigned n_threads = 0;              // 0 => hardware_concurrency
+    std::uint64_t seed = 42;
+    bool keep_samples = false;           // also return per-path metrics
+};
+
+struct MonteCarloResult {
+    std::vector<double> q;               // quantile levels (copy of cfg.quantiles)
+    // one value per level in q
+    std::vector<double> sharpe_bar;
+    std::vector<double> max_dd;
+    std::vector<double> hit_ratio;
+    std::vector<double> sum_pnl;
+    std::vector<double> n_trades;
+    std::vector<BacktestMetrics> samples; // n_paths entries if keep_samples
+};
+
+// Half-cost series 0.5*(log(Ask1/Bid1)+log(Ask2/Bid2)) of a table (rows with valid quotes)
+std::vector<double> empirical_half_costs(const PriceTable& data);
+
+/**
+ * Distribution of backtest metrics under the calibrated OU model.
+ * - Each path is simulated with the exact OU step and fed bar by bar into a
+ *   StreamingBacktester (same rules as backtest_os); no PriceTable is built
+ *   and nothing is allocated inside the path loop.
+ * - Paths run in parallel; path p always uses RNG stream stream_seed(seed, p),
+ *   so results do not depend on the number of threads.
+ * - cfg.k_hat/eta_hat/sigma_hat are used for the z-score (what the trader
+ *   believes); the simulated dynamics come from `ou`.
+ */
+MonteCarloResult backtest_monte_carlo(
+    const stats::OUBootstrapResult& ou,
+    const BacktestConfig& cfg,
+    const MonteCarloConfig& mc
+);
+
+} // namespace util
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/BatchRunner.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/ResultStore.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+#include "utilities/StreamingBacktest.hpp"
+
+namespace util {
+
+struct OutOfCoreConfig {
+    size_t memory_limit = size_t(256) << 20;    // byte per buffer di sort e chunk mappati
+    std::uint64_t chunk_rows = 65536;           // righe per chunk su disco (multiplo di 512)
+    std::string work_dir;                       // "" => outputs/ooc/<run>
+    bool keep_sorted = false;                   // tiene <work_dir>/sorted.store a fine run
+    std::uint32_t sketch_k = 200;               // accuratezza KLL delle fence outlier
+    double dt = (0.5/24.0)/365.0;               // passo delle barre in anni, come ou_bootstrap
+};
+
+// PriceRow as columns: ts = epoch seconds (iso_to_epoch_seconds of Time), then the doubles
+StoreSchema price_rows_schema();
+
+/**
+ * Columnar price file (ResultStore, price_rows_schema) read chunk by chunk.
+ * for_each_chunk hands out column spans straight into the mapping and evicts
+ * every chunk once the callback returns, so a scan keeps one chunk resident.
+ */
+class PriceChunkReader {
+public:
+    struct Chunk {
+        std::span<const std::int64_t> ts;
+        std::span<const double> bid1, ask1, mid1, bid2, ask2, mid2, rt;
+        size_t size() const { return ts.size(); }
+        PriceRow row(size_t i) const;           // Time rebuilt from ts
+    };
+
+    explicit PriceChunkReader(const std::string& path);
+
+    size_t rows() const { return store_.size(); }
+    size_t n_chunks() const { return store_.n_chunks(); }
+    Chunk chunk(size_t i) const;
+    void evict(size_t i) const { store_.evict(i); }
+
+    template <class Fn>
+    void for_each_chunk(Fn&& fn) const {
+        for (size_t i=0; i<n_chunks(); ++i){
+            const Chunk c = chunk(i);
+            if (c.size()) fn(c);
+            evict(i);
+        }
+    }
+
+private:
+    ResultStoreReader store_;
+    int col_[8];
+};
+
+struct ColumnarImport {
+    size_t rows = 0;                // righe scritte (ordinate)
+    size_t bad_time = 0;            // Time non interpretabile: scartate
+    size_t runs = 0;                // run ordinate della prima fase
+    size_t merge_passes = 0;        // passate di merge (fan-in limitato dalla memoria)
+};
+
+/**
+ * CSV -> one time-sorted columnar file, within cfg.memory_limit.
+ * - Run generation: rows are buffered up to the limit, stable-sorted on ts and
+ *   written as a sorted run file; the buffer is then reused.
+ * - k-way merge (ties: earlier run first, so the result is a stable sort of
+ *   the file) with a fan-in of memory_limit / (2 x chunk bytes); more runs
+ *   than that are merged in several passes. Consumed chunks are evicted.
+ * Run files live in tmp_dir and are deleted.
+ */
+ColumnarImport import_sorted_columnar(const RunSpec& spec, const std::string& out_path,
+                                      const std::string& tmp_dir, const OutOfCoreConfig& cfg = {});
+
+struct OutOfCoreResult {
+    stats::OUEstimate ou;           // MLE dalle somme su IS pulito (niente CI bootstrap)
+    double C = 0.0;
+    OptimalBandsResult bands;       // (spec.l_bt, spec.f_bt)
+    BacktestMetrics metrics;
+
+    ColumnarImport import;
+    size_t IS_rows = 0, IS_clean = 0;
+    size_t OS_rows = 0, OS_clean = 0;
+    double wall_ms = 0.0;
+};
+
+/**
+ * One RunSpec over a history larger than RAM.
+ * 1. import_sorted_columnar (external merge sort of the CSV).
+ * 2. Pass over the chunks: split at first ts + split_months, IS / cost / OS
+ *    hour windows, cost sums, KLL sketches of the IS and OS Rt.
+ * 3. Pass over the chunks: StreamingOutlierFilter with the frozen full-sample
+ *    fences (remove_outliers' quantiles, to sketch accuracy), OU sums on clean
+ *    IS; at the first OS row the MLE, C and bands are computed and the
+ *    StreamingBacktester then carries its state across the OS chunks.
+ * Resident memory stays under memory_limit plus a few chunks, whatever the
+ * file size. Throws std::runtime_error as run_batch's stages do.
+ */
+OutOfCoreResult run_out_of_core(const RunSpec& spec, const OutOfCoreConfig& cfg = {},
+                                const TradeSink& on_trade = {});
+
+} // namespace util
@@ -0,0 +1,48 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace util {
+
+// Columnar table of N instruments on a common bar grid (prices in common units)
+struct InstrumentTable {
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> mid;   // [instrument][bar], > 0
+    // optional quotes for the cost estimate (both empty => cost 0)
+    std::vector<std::vector<double>> bid;
+    std::vector<std::vector<double>> ask;
+};
+
+struct ScreeningConfig {
+    double dt = (0.5/24.0)/365.0;   // bar length in years (30 min, as ou_bootstrap)
+    double max_half_life = INFINITY;// in years; slower pairs are dropped
+    double min_sigma_to_cost = 0.0; // keep pairs with sigma_stat >= this * mean_cost
+    size_t block_bars = 256;        // bars per cache block
+    unsigned n_threads = 0;         // 0 => hardware_concurrency
+};
+
+struct PairScore {
+    size_t i = 0, j = 0;            // spread = log(mid_i / mid_j), as Rt
+    double k = 0.0, eta = 0.0, sigma = 0.0;
+    double rho = 0.0;               // 1-step autocorrelation
+    double half_life = 0.0;         // ln2 / k (years)
+    double sigma_stat = 0.0;        // sigma / sqrt(2k)
+    double mean_cost = 0.0;         // avg log(Ask/Bid) of leg i + leg j
+};
+
+/**
+ * Screens every pair (i<j) of the table for mean reversion.
+ * - The log-spread OU sufficient statistics of all pairs are derived from
+ *   per-instrument sums and two shared Gram matrices over the centred
+ *   log-prices: Σa_i·a_j (lag 0) and Σa_i,t+1·a_j,t (lag 1), so the O(bars)
+ *   work is done once per pair of columns, in cache-sized bar blocks.
+ * - Estimates use stats::ou_mle_from_sums (same formulas as ou_bootstrap).
+ * - Pairs with rho outside (0,1) are not mean-reverting and are dropped.
+ * Returns the surviving pairs sorted by half-life (fastest first).
+ */
+std::vector<PairScore> screen_pairs(const InstrumentTable& tbl,
+                                    const ScreeningConfig& cfg = {});
+
+} // namespace util
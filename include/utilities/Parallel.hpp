@@ -0,0 +1,48 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// numero di thread effettivo (0 => hardware_concurrency, almeno 1)
+inline unsigned resolve_threads(unsigned n_threads){
+    if (n_threads == 0) n_threads = std::thread::hardware_concurrency();
+    return std::max(1u, n_threads);
+}
+
+/**
+ * Static-chunked parallel loop over [0, n).
+ * fn(begin, end, tid) is called once per thread on a contiguous range.
+ * With one thread (or n small) it runs inline on the caller's thread.
+ */
+template <class Fn>
+void parallel_for(size_t n, unsigned n_threads, Fn&& fn){
+    if (n == 0) return;
+    const unsigned T = static_cast<unsigned>(
+        std::min<size_t>(resolve_threads(n_threads), n));
+    if (T == 1) { fn(size_t{0}, n, 0u); return; }
+
+    std::vector<std::thread> pool;
+    pool.reserve(T);
+    const size_t chunk = (n + T - 1) / T;
+    for (unsigned t=0; t<T; ++t){
+        const size_t b = t * chunk;
+        const size_t e = std::min(n, b + chunk);
+        if (b >= e) break;
+        pool.emplace_back([&fn, b, e, t]{ fn(b, e, t); });
+    }
+    for (auto& th : pool) th.join();
+}
+
+// seed indipendente per il task idx (splitmix64): stessi risultati con qualsiasi numero di thread
+inline std::uint64_t stream_seed(std::uint64_t seed, std::uint64_t idx){
+    std::uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (idx + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace util
@@ -0,0 +1,89 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+
+namespace util {
+
+// Everything main.cpp hard-codes for one pair
+struct PairSpec {
+    std::string name;
+
+    // load
+    std::string csv_path;
+    std::string time_col = "*";
+    std::array<std::string,4> bid_ask_cols;                   // {Bid1, Ask1, Bid2, Ask2}
+    std::optional<std::array<std::string,2>> mid_cols;
+    std::optional<std::array<double,2>> ticks;
+    std::array<double,2> convs{1.0, 1.0};
+    std::optional<std::string> start_date;
+    std::optional<std::string> end_date;
+
+    // tick -> bar resampling before trim/split (0 => rows are already bars, dt 30 min)
+    std::int64_t bar_seconds = 0;
+
+    // trim & split (IS window kept, OS window excluded)
+    double IS_start_hour = 8.0,  IS_end_hour = 16.0;
+    double OS_start_hour = 17.0, OS_end_hour = 20.0;
+    int split_months = 9;
+    // raw-IS window for the avg cost C (same default as RunSpec::cost_hours)
+    double cost_start_hour = 9.0, cost_end_hour = 16.0;
+
+    // calibration, bands, backtest
+    int M_boot = 1000;
+    double alpha = 0.05;
+    std::uint64_t seed = 42;
+    int M_opt = 100000;
+    int grid  = 100;
+    double l = -1.96;
+    double f = 1.0;                 // NaN => f*
+    bool symmetric = true;
+
+    double weight = 1.0;            // weight of the pair's log-equity in the book
+};
+
+struct PairOutcome {
+    std::string name;
+    bool ok = false;
+    std::string error;              // filled when ok == false
+
+    stats::OUBootstrapResult ou;
+    double C = 0.0;                 // avg log-transaction cost (raw IS, cost window)
+    OptimalBandsResult bands;
+    BacktestResult bt;
+    // (time, log-equity) at each equity change, times in epoch seconds
+    std::vector<std::pair<std::int64_t,double>> equity_ts;
+};
+
+struct PortfolioResult {
+    std::vector<PairOutcome> pairs; // same order as the specs
+    // common grid = union of the pairs' equity-change times
+    std::vector<std::int64_t> time;
+    std::vector<double> log_equity; // sum of weight_i * log-equity_i
+    BacktestMetrics metrics;        // trades/hit ratio summed over pairs, DD/Sharpe on the merged path
+    size_t n_failed = 0;
+};
+
+/**
+ * Single-pair pipeline: load -> [resample] -> trim/split -> outliers -> ou_bootstrap (IS,
+ * dt measured from the bar timestamps when resampling)
+ * -> cost C (raw IS) -> optimal_trading_bands -> backtest_os (clean OS).
+ * Throws on failure.
+ */
+PairOutcome run_pair(const PairSpec& spec);
+
+/**
+ * Runs every pair as an independent task on a work-stealing ThreadPool and
+ * merges the per-pair equity on a common time grid. A failing pair is
+ * reported in its PairOutcome (ok=false) and excluded from the merge.
+ */
+PortfolioResult run_portfolio(const std::vector<PairSpec>& specs, unsigned n_threads = 0);
+
+} // namespace util
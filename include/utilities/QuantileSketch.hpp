@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+/**
+ * KLL quantile sketch (Karnin-Lang-Liberty).
+ * - Level h holds items of weight 2^h; a full level is sorted and every other
+ *   item (random offset) is promoted. Level capacities shrink geometrically
+ *   (factor 2/3) from the top, so memory is O(k log(n/k)) doubles.
+ * - Rank error ~ 1.7/k of n with high probability (k=200 => ~1%).
+ * - merge() combines sketches built on disjoint chunks (parallel loaders);
+ *   the coin flips come from the seed, so results are reproducible.
+ */
+class KllSketch {
+public:
+    explicit KllSketch(std::uint32_t k = 200, std::uint64_t seed = 42);
+
+    void update(double x);                  // NaN ignored
+    void merge(const KllSketch& other);
+    void clear();
+
+    // approximate p-quantile, p in [0,1]; NaN if empty
+    double quantile(double p) const;
+
+    std::uint64_t count() const { return n_; }
+    size_t retained() const;                // items held in memory
+
+private:
+    size_t capacity(size_t level) const;
+    void compress();
+    bool coin();
+
+    std::uint32_t k_;
+    std::uint64_t n_ = 0;
+    std::uint64_t rng_;
+    double min_, max_;
+    std::vector<std::vector<double>> levels_;
+};
+
+/**
+ * Approximate quantiles over the last `window` updates.
+ * The window is split into n_blocks KLL sketches; the oldest block is dropped
+ * as a whole, so the covered span is between window - window/n_blocks and window.
+ */
+class RollingQuantileSketch {
+public:
+    RollingQuantileSketch(size_t window, size_t n_blocks = 8,
+                          std::uint32_t k = 200, std::uint64_t seed = 42);
+
+    void update(double x);
+    KllSketch merged() const;               // sketch of the live blocks
+    std::uint64_t count() const;
+
+private:
+    size_t block_len_;
+    size_t cur_ = 0;
+    std::vector<KllSketch> blocks_;
+};
+
+} // namespace util
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "utilities/DataOrdering.hpp"
+
+namespace util {
+
+enum class MidAgg { Last, Mean };
+
+struct ResampleConfig {
+    std::int64_t bar_seconds = 1800;  // bar length (30 min = the loader's native grid)
+    std::int64_t origin = 0;          // bucket alignment, epoch seconds
+    MidAgg mid = MidAgg::Last;        // bar mid: last tick or mean of the ticks
+};
+
+// Fixed-length bars, one row per non-empty bucket priced on both legs
+struct BarTable {
+    // Time = bucket start; Mid per cfg.mid over the ticks with a valid (> 0)
+    // mid on that leg; Bid/Ask = tightest quote of the bucket (min Ask-Bid per
+    // leg); Rt = log(Mid1/Mid2)
+    PriceTable bars;
+    std::vector<std::uint32_t> tick_count;
+    size_t n_late = 0;                // ticks behind the current bucket, dropped
+    size_t n_unpriced = 0;            // buckets with no valid mid on a leg: no bar (no fake Rt=0)
+    double dt = 0.0;                  // measure_dt_years(bars)
+};
+
+/**
+ * Single-pass tick aggregator: O(1) state per open bucket.
+ * - Buckets are integer: floor((t - origin) / bar_seconds), no string compares.
+ * - Ticks must arrive in time order; a tick older than the open bucket is
+ *   counted in n_late and skipped (nothing is re-sorted).
+ */
+class BarResampler {
+public:
+    explicit BarResampler(const ResampleConfig& cfg);
+
+    void on_tick(std::int64_t t, const PriceRow& q);   // t in epoch seconds
+    BarTable finish();                                  // closes the open bar
+
+private:
+    void close_bar();
+
+    ResampleConfig cfg_;
+    BarTable out_;
+
+    bool open_ = false;
+    std::int64_t bucket_ = 0;
+    std::uint32_t n_ = 0;
+    double last_m1_ = 0.0, last_m2_ = 0.0;  // last valid mid per leg in the bucket
+    double sum_m1_ = 0.0, sum_m2_ = 0.0;
+    std::uint32_t cnt_m1_ = 0, cnt_m2_ = 0;
+    bool q1_ = false, q2_ = false;      // a valid quote seen in the bucket
+    double spr1_ = 0.0, spr2_ = 0.0;    // min spread so far
+    double b1_ = 0.0, a1_ = 0.0, b2_ = 0.0, a2_ = 0.0;
+};
+
+// One pass over a time-ordered tick table: timestamps are parsed once
+// and fed to one resampler per config (calibrate several bar sizes at once)
+std::vector<BarTable> resample_ticks(const PriceTable& ticks,
+                                     const std::vector<ResampleConfig>& cfgs);
+BarTable resample_ticks(const PriceTable& ticks, const ResampleConfig& cfg);
+
+// Median gap between consecutive timestamps, in years (365 d) as ou_bootstrap's dt.
+// The median ignores overnight/weekend gaps. 0 if fewer than two valid times.
+double measure_dt_years(const std::vector<std::int64_t>& t);
+double measure_dt_years(const PriceTable& data);
+
+} // namespace util
@@ -0,0 +1,172 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+
+namespace util {
+
+// Every field is an 8-byte slot; the type only tells readers how to view it
+enum class SlotType : std::uint32_t { F64 = 1, I64 = 2 };
+
+struct StoreColumn {
+    std::string name;               // at most 39 chars
+    SlotType type = SlotType::F64;
+};
+
+struct StoreSchema {
+    std::string record_type;        // at most 47 chars
+    std::vector<StoreColumn> columns;
+};
+
+// one field value, bit-copied into its slot
+struct Slot {
+    std::uint64_t bits = 0;
+    Slot(double x)        { std::memcpy(&bits, &x, 8); }
+    Slot(std::int64_t x)  { std::memcpy(&bits, &x, 8); }
+    Slot(size_t x) : Slot(static_cast<std::int64_t>(x)) {}
+    Slot(int x)    : Slot(static_cast<std::int64_t>(x)) {}
+};
+
+/**
+ * Append-only, memory-mapped columnar result file.
+ * Layout: 4 KiB header (schema + chunk counter), a table with the committed
+ * record count of each chunk, then fixed-size chunks. Inside a chunk every
+ * column is a contiguous array of chunk_records slots.
+ * - Writers never lock: each Writer claims whole chunks with one atomic
+ *   fetch_add on the header counter and fills them alone; the chunk's count
+ *   is published with a release store after every record.
+ * - The file is sized up front for max_records plus one partly filled chunk
+ *   per writer (sparse: unused chunks take no disk space), so the mapping
+ *   never moves while threads write.
+ * - A chunk a writer has filled is never touched again: its pages are dropped
+ *   from the process (madvise; the data stays in the page cache / on disk),
+ *   so writing a store larger than RAM keeps a flat resident set.
+ * Errors (open/map, full store, schema mismatch) throw std::runtime_error.
+ */
+class ResultStore {
+public:
+    class Writer {
+    public:
+        Writer() = default;
+        Writer(Writer&& o) noexcept { *this = std::move(o); }
+        Writer& operator=(Writer&& o) noexcept;
+
+        // one record, values in schema order
+        void append(std::initializer_list<Slot> values);
+        void append(const Slot* values, size_t n);
+
+        size_t written() const { return written_; }
+
+    private:
+        friend class ResultStore;
+        explicit Writer(ResultStore* s) : store_(s) {}
+        void claim_chunk();
+
+        ResultStore* store_ = nullptr;
+        std::uint64_t chunk_ = 0;
+        std::uint64_t used_ = 0;        // records in the current chunk
+        bool has_chunk_ = false;
+        size_t written_ = 0;
+    };
+
+    // creates (truncates) path; chunk_records is rounded up to a multiple of 512
+    ResultStore(const std::string& path, const StoreSchema& schema,
+                std::uint64_t max_records, std::uint64_t chunk_records = 65536,
+                unsigned max_writers = 64);
+    ~ResultStore();
+
+    ResultStore(const ResultStore&) = delete;
+    ResultStore& operator=(const ResultStore&) = delete;
+
+    // one per thread; safe to call concurrently
+    Writer writer() { return Writer(this); }
+
+    void sync();                        // msync: data on disk before returning
+    std::uint64_t capacity() const { return n_chunks_ * chunk_records_; }
+    const StoreSchema& schema() const { return schema_; }
+
+private:
+    friend class Writer;
+    unsigned char* chunk_base(std::uint64_t c) const;
+    void evict(std::uint64_t c) const;
+
+    StoreSchema schema_;
+    int fd_ = -1;
+    unsigned char* map_ = nullptr;
+    size_t map_len_ = 0;
+    std::uint64_t n_cols_ = 0, chunk_records_ = 0, n_chunks_ = 0;
+    std::uint64_t* next_chunk_ = nullptr;   // in the header
+    std::uint64_t* counts_ = nullptr;       // per-chunk committed records
+};
+
+/**
+ * Read-only, zero-copy view of a ResultStore file (also while writers run:
+ * only committed records are visible). Columns come back as spans straight
+ * into the mapping, one per chunk.
+ */
+class ResultStoreReader {
+public:
+    struct Chunk {
+        const unsigned char* base = nullptr;
+        std::uint64_t stride = 0;       // bytes per column inside the chunk
+        size_t n = 0;                   // committed records
+        template <class T>
+        std::span<const T> col(size_t c) const {
+            static_assert(sizeof(T) == 8, "slots are 8 bytes");
+            return { reinterpret_cast<const T*>(base + c * stride), n };
+        }
+    };
+
+    explicit ResultStoreReader(const std::string& path);
+    ~ResultStoreReader();
+
+    ResultStoreReader(const ResultStoreReader&) = delete;
+    ResultStoreReader& operator=(const ResultStoreReader&) = delete;
+
+    const StoreSchema& schema() const { return schema_; }
+    int column(std::string_view name) const;    // -1 if absent
+
+    size_t n_chunks() const;                    // chunks claimed so far
+    Chunk chunk(size_t i) const;
+    size_t size() const;                        // committed records, all chunks
+
+    // drops chunk i's pages from the resident set (sequential scans of files
+    // larger than RAM); spans into it stay valid and fault back in if read
+    void evict(size_t i) const;
+
+    template <class Fn>
+    void for_each_chunk(Fn&& fn) const {
+        const size_t n = n_chunks();
+        for (size_t i=0; i<n; ++i){ auto c = chunk(i); if (c.n) fn(c); }
+    }
+
+private:
+    StoreSchema schema_;
+    int fd_ = -1;
+    const unsigned char* map_ = nullptr;
+    size_t map_len_ = 0;
+    std::uint64_t n_cols_ = 0, chunk_records_ = 0, n_chunks_ = 0, data_offset_ = 0;
+    const std::uint64_t* next_chunk_ = nullptr;
+    const std::uint64_t* counts_ = nullptr;
+};
+
+// ---- schemas of the sweep outputs (first column = caller's config id) ----
+StoreSchema backtest_metrics_schema();
+void append_record(ResultStore::Writer& w, std::int64_t config_id, const BacktestMetrics& m);
+
+StoreSchema optimal_bands_schema();
+void append_record(ResultStore::Writer& w, std::int64_t config_id, const OptimalBandsResult& b);
+
+// one record per bootstrap replicate: (config_id, replicate, k, eta, sigma)
+StoreSchema ou_bootstrap_samples_schema();
+void append_samples(ResultStore::Writer& w, std::int64_t config_id, const stats::OUBootstrapResult& r);
+
+} // namespace util
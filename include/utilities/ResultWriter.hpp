@@ -0,0 +1,94 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// How a column is rendered (all via std::to_chars, no locale, no iostream state)
+enum class ColFmt {
+    Fixed,      // "%.{precision}f"; non-finite => empty field (as main's fmt6)
+    General,    // "%.{precision}g" = default ostream << double (precision 6)
+    Int,        // integer
+    Text        // string as given, no quoting
+};
+
+struct Column {
+    std::string name;
+    ColFmt fmt = ColFmt::General;
+    int precision = 6;
+};
+
+using CsvSchema = std::vector<Column>;
+
+struct WriterOptions {
+    size_t buffer_bytes = 1 << 20;  // one block handed to the OS at a time
+    size_t max_in_flight = 4;       // filled blocks queued before the producer waits
+    bool background = true;         // disk writes on a dedicated thread
+};
+
+/**
+ * Buffered CSV writer for large result files.
+ * - Schema defined once: header, column count and per-column format.
+ * - Values are formatted with std::to_chars straight into a large block;
+ *   full blocks go to a background thread, so formatting overlaps disk I/O.
+ * - Output of Fixed/General columns is byte-identical to the iostream path
+ *   (std::fixed << setprecision(p), resp. plain << double).
+ * Usage: w.add(x).add(y).add(name); w.end_row();  ... w.close();
+ */
+class CsvWriter {
+public:
+    CsvWriter(const std::string& path, CsvSchema schema, WriterOptions opt = {});
+    ~CsvWriter();
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    bool is_open() const { return open_; }
+
+    CsvWriter& add(double x);
+    CsvWriter& add(std::int64_t x);
+    CsvWriter& add(std::string_view s);
+    CsvWriter& add(const char* s) { return add(std::string_view(s)); }
+    CsvWriter& add(const std::string& s) { return add(std::string_view(s)); }
+    CsvWriter& add(size_t x) { return add(static_cast<std::int64_t>(x)); }
+    CsvWriter& add(int x) { return add(static_cast<std::int64_t>(x)); }
+    void end_row();                 // throws std::logic_error on a short row
+
+    // flushes and joins the writer thread; false if any write failed
+    bool close();
+
+    size_t rows() const { return rows_; }
+
+private:
+    void sep();
+    char* reserve(size_t n);        // room for n more bytes in the current block
+    void hand_off();                // current block -> writer (or disk)
+    void writer_loop();
+
+    CsvSchema schema_;
+    WriterOptions opt_;
+    std::ofstream out_;
+    bool open_ = false;
+    bool failed_ = false;
+
+    std::string cur_;               // block being filled
+    size_t col_ = 0;
+    size_t rows_ = 0;
+
+    // background I/O
+    std::thread io_;
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<std::string> full_;  // blocks to write
+    std::vector<std::string> free_; // recycled blocks
+    bool stop_ = false;
+};
+
+} // namespace util
@@ -0,0 +1,75 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+
+namespace stats {
+
+// Neumaier (improved Kahan) compensated sum; removal = add(-x)
+struct NeumaierSum {
+    double s = 0.0, c = 0.0;
+    void add(double x){
+        const double t = s + x;
+        if (std::fabs(s) >= std::fabs(x)) c += (s - t) + x;
+        else                              c += (x - t) + s;
+        s = t;
+    }
+    double value() const { return s + c; }
+};
+
+struct RollingOUEstimate {
+    bool ready = false;             // window full
+    double k = 0.0, eta = 0.0, sigma = 0.0;
+    double rho = 0.0;
+    double sigma_stat = 0.0;        // sigma / sqrt(2k)
+    double half_life = 0.0;         // ln2 / k (years)
+};
+
+/**
+ * OU MLE on a sliding window of the last `window` transitions (x_i, x_{i+1}).
+ * - add() pushes one bar and drops the oldest pair: O(1), no rescan.
+ * - The five sums of ou_mle are kept with Neumaier compensation, on values
+ *   centred at the first observation, so adding and removing for millions of
+ *   bars does not drift (and squares do not cancel against a large level).
+ * - estimate() uses ou_mle_from_sums: same formulas as ou_bootstrap's point
+ *   estimate on the window.
+ */
+class RollingOUEstimator {
+public:
+    RollingOUEstimator(size_t window, double dt = (0.5/24.0)/365.0);
+
+    void add(double x);
+    void reset();
+
+    size_t pairs() const { return n_pairs_; }
+    bool ready() const { return n_pairs_ == window_; }
+
+    RollingOUEstimate estimate() const;
+
+private:
+    size_t window_;
+    double dt_;
+
+    std::vector<double> ring_;      // last window+1 points (centred)
+    size_t head_ = 0;               // slot of the oldest point
+    size_t n_points_ = 0;
+    size_t n_pairs_ = 0;
+
+    bool has_ref_ = false;
+    double ref_ = 0.0;
+
+    NeumaierSum sum_m_, sum_p_, sum_mm_, sum_pp_, sum_pm_;
+};
+
+/**
+ * Causal per-bar OU parameters for backtest_os(os, cfg, path): bar i uses the
+ * window ending at bar i (its own close included). NaN until the window is full.
+ */
+util::OUParamPath rolling_ou_path(const util::PriceTable& data, size_t window,
+                                  double dt = (0.5/24.0)/365.0);
+
+} // namespace stats
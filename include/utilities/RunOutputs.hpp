@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/OptimalBands.hpp"
+
+namespace util {
+
+// fixed a 6 decimali, "" se non finito (tabelle a video e colonne f* dei CSV)
+std::string fmt6(double x);
+
+// una cella della griglia l x f di optimal_bands_results.csv
+struct BandsRow {
+    double l = 0.0;
+    std::string f_label;            // "1", "2", "5", ... o "opt" (f*)
+    OptimalBandsResult bands;       // f* e il suo CI scritti solo per "opt"
+};
+
+/**
+ * Result CSVs shared by main and --batch, so both write the same columns with
+ * the same formats:
+ * - optimal_bands_results.csv: Stop-loss, Leverage, d/u/mu with CIs, f* with CI;
+ * - os_trades.csv: one row per trade, entry/exit times from clean_OS;
+ * - os_equity.csv: log-equity on every OS bar (dense_equity).
+ * Each returns false when the file cannot be opened or written.
+ */
+bool write_bands_csv(const std::string& path, const std::vector<BandsRow>& rows);
+bool write_trades_csv(const std::string& path, const BacktestResult& bt, const PriceTable& clean_OS);
+bool write_equity_csv(const std::string& path, const BacktestResult& bt, const PriceTable& clean_OS);
+
+} // namespace util
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/**
+ * Bounded single-producer / single-consumer ring, lock-free.
+ * - Capacity rounded up to a power of two. Head and tail live on separate cache
+ *   lines; each side keeps a cached copy of the other's index and reloads it
+ *   only when the ring looks full (producer) or empty (consumer).
+ * - try_push / try_pop never block. push / pop spin briefly, then yield:
+ *   a full ring stalls the producer (backpressure), an empty one the consumer.
+ * - close(): the producer's end of stream; pop() returns false once drained.
+ * - cancel(): either side gives up (e.g. on error); blocked calls return false.
+ */
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity){
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        buf_.resize(n);
+        mask_ = n - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // producer: moves from v on success
+    bool try_push(T& v){
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ > mask_){
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ > mask_) return false;
+        }
+        buf_[t & mask_] = std::move(v);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer
+    bool try_pop(T& out){
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_){
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return false;
+        }
+        out = std::move(buf_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // blocks while full; false if cancelled
+    bool push(T& v){
+        for (unsigned spin = 0; !try_push(v); ++spin){
+            if (cancelled_.load(std::memory_order_relaxed)) return false;
+            if (spin == 0) ++stalls_;
+            backoff(spin);
+        }
+        return true;
+    }
+
+    // blocks while empty; false once closed and drained, or cancelled
+    bool pop(T& out){
+        for (unsigned spin = 0;; ++spin){
+            if (try_pop(out)) return true;
+            if (cancelled_.load(std::memory_order_relaxed)) return false;
+            if (closed_.load(std::memory_order_acquire)) return try_pop(out);
+            backoff(spin);
+        }
+    }
+
+    void close(){ closed_.store(true, std::memory_order_release); }
+    void cancel(){ cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return mask_ + 1; }
+    size_t stalls() const { return stalls_; }      // pushes that found the ring full (producer side)
+
+private:
+    static void backoff(unsigned spin){
+        if (spin < 64) return;                      // spin: l'altro lato è di solito a pochi ns
+        std::this_thread::yield();
+    }
+
+    static constexpr size_t CL = 64;
+
+    std::vector<T> buf_;
+    size_t mask_ = 0;
+
+    alignas(CL) std::atomic<size_t> head_{0};      // prossimo da leggere (consumer)
+    size_t tail_cache_ = 0;                         // copia del consumer
+    alignas(CL) std::atomic<size_t> tail_{0};      // prossimo da scrivere (producer)
+    size_t head_cache_ = 0;                         // copia del producer
+    size_t stalls_ = 0;
+    alignas(CL) std::atomic<bool> closed_{false};
+    std::atomic<bool> cancelled_{false};
+};
+
+} // namespace util
@@ -0,0 +1,200 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+#include "utilities/TradeBootstrap.hpp"
+
+namespace util {
+
+// 128-bit content key of a stage (inputs + parameters)
+struct CacheKey {
+    std::uint64_t lo = 0, hi = 0;
+    std::string hex() const;
+    bool operator==(const CacheKey& o) const { return lo == o.lo && hi == o.hi; }
+};
+
+/**
+ * Incremental 128-bit hash (two independent 64-bit multiply-xorshift lanes over
+ * 8-byte words). Not cryptographic: it only has to tell stage inputs apart.
+ * Doubles are hashed by bit pattern, strings and vectors with their length.
+ */
+class Hasher {
+public:
+    Hasher& add_bytes(const void* p, size_t n);
+
+    template <class T, class = std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>>>
+    Hasher& add(T v){ return add_bytes(&v, sizeof(v)); }
+    Hasher& add(std::string_view s){ add(static_cast<std::uint64_t>(s.size())); return add_bytes(s.data(), s.size()); }
+    Hasher& add(const char* s){ return add(std::string_view(s)); }
+    Hasher& add(const std::string& s){ return add(std::string_view(s)); }
+    Hasher& add(const CacheKey& k){ add(k.lo); return add(k.hi); }
+    Hasher& add(const PriceTable& t);
+
+    template <class T>
+    Hasher& add(const std::vector<T>& v){
+        add(static_cast<std::uint64_t>(v.size()));
+        if constexpr (std::is_trivially_copyable_v<T>) return add_bytes(v.data(), v.size() * sizeof(T));
+        else { for (const auto& x : v) add(x); return *this; }
+    }
+    template <class T, size_t N>
+    Hasher& add(const std::array<T,N>& a){ for (const auto& x : a) add(x); return *this; }
+    template <class T>
+    Hasher& add(const std::optional<T>& o){ add(o.has_value()); if (o) add(*o); return *this; }
+
+    // file contents (streamed), e.g. the raw CSV of the load stage
+    Hasher& add_file(const std::string& path);
+
+    CacheKey key() const;
+
+private:
+    void mix(std::uint64_t w);
+    std::uint64_t a_ = 0x243F6A8885A308D3ULL, b_ = 0x13198A2E03707344ULL;
+    std::uint64_t n_ = 0;               // byte totali
+    unsigned char tail_[8] = {};
+    unsigned tail_n_ = 0;
+};
+
+// ---- serializzazione binaria dei risultati di stadio ----
+class BinWriter {
+public:
+    void bytes(const void* p, size_t n){ buf_.append(static_cast<const char*>(p), n); }
+    template <class T> void pod(const T& v){
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes(&v, sizeof(T));
+    }
+    void str(const std::string& s){ pod<std::uint64_t>(s.size()); bytes(s.data(), s.size()); }
+    template <class T> void pod_vec(const std::vector<T>& v){
+        pod<std::uint64_t>(v.size());
+        bytes(v.data(), v.size() * sizeof(T));
+    }
+    const std::string& data() const { return buf_; }
+
+private:
+    std::string buf_;
+};
+
+// throws std::runtime_error on truncated input (=> cache miss)
+class BinReader {
+public:
+    BinReader(const char* p, size_t n) : p_(p), end_(p + n) {}
+    void bytes(void* out, size_t n){
+        if (static_cast<size_t>(end_ - p_) < n) throw std::runtime_error("StageCache: truncated entry");
+        std::memcpy(out, p_, n); p_ += n;
+    }
+    template <class T> void pod(T& v){
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes(&v, sizeof(T));
+    }
+    void str(std::string& s){ s.resize(count(1)); bytes(s.data(), s.size()); }
+    template <class T> void pod_vec(std::vector<T>& v){ v.resize(count(sizeof(T))); bytes(v.data(), v.size() * sizeof(T)); }
+    bool at_end() const { return p_ == end_; }
+
+private:
+    // numero di elementi, controllato contro i byte rimasti
+    size_t count(size_t elem){
+        std::uint64_t n = 0; pod(n);
+        if (elem && n > static_cast<std::uint64_t>(end_ - p_) / elem) throw std::runtime_error("StageCache: bad length");
+        return static_cast<size_t>(n);
+    }
+    const char* p_;
+    const char* end_;
+};
+
+void save(BinWriter& w, double v);
+void load(BinReader& r, double& v);
+void save(BinWriter& w, const PriceTable& t);
+void load(BinReader& r, PriceTable& t);
+void save(BinWriter& w, const OutlierResult& o);
+void load(BinReader& r, OutlierResult& o);
+void save(BinWriter& w, const stats::OUBootstrapResult& R);
+void load(BinReader& r, stats::OUBootstrapResult& R);
+void save(BinWriter& w, const OptimalBandsResult& b);
+void load(BinReader& r, OptimalBandsResult& b);
+void save(BinWriter& w, const BacktestResult& R);
+void load(BinReader& r, BacktestResult& R);
+void save(BinWriter& w, const TradeBootstrapResult& R);
+void load(BinReader& r, TradeBootstrapResult& R);
+
+template <class A, class B>
+void save(BinWriter& w, const std::pair<A,B>& p){ save(w, p.first); save(w, p.second); }
+template <class A, class B>
+void load(BinReader& r, std::pair<A,B>& p){ load(r, p.first); load(r, p.second); }
+
+/**
+ * On-disk cache of pipeline stage outputs, keyed by a hash of everything the
+ * stage reads: file dir/<stage>-<key>.bin.
+ * - get_or_compute(stage, key_fn, compute): key_fn(Hasher&) adds the stage inputs
+ *   (upstream outputs by content, parameters); on a hit the stored value is
+ *   returned, otherwise compute() runs and its result is stored. Keys are built
+ *   from upstream *contents*, so a change that leaves an upstream output equal
+ *   does not invalidate what follows.
+ * - Disabled (empty dir): compute() only, key_fn is not even called.
+ * - Entries carry a format version, the layout of the raw-copied structs and a
+ *   checksum; anything unreadable counts as a miss and is rewritten.
+ *   Writes go to a temp file and are renamed, so concurrent stages are safe.
+ * When a stage's algorithm changes, change its stage name (e.g. "..._v2").
+ */
+class StageCache {
+public:
+    explicit StageCache(std::string dir = {});
+
+    // ARBITRAGE_CACHE unset/""/"0" => disabled; "1" => outputs/cache; otherwise the directory
+    static StageCache from_env();
+
+    bool enabled() const { return !dir_.empty(); }
+    const std::string& dir() const { return dir_; }
+    size_t hits() const { return hits_.load(); }
+    size_t misses() const { return misses_.load(); }
+
+    template <class T, class KeyFn, class F>
+    T get_or_compute(const char* stage, KeyFn&& key_fn, F&& compute){
+        if (!enabled()) return compute();
+        Hasher h;
+        h.add(stage);
+        key_fn(h);
+        const CacheKey k = h.key();
+
+        std::string payload;
+        if (read_entry(stage, k, payload)){
+            try {
+                T v{};
+                BinReader r(payload.data(), payload.size());
+                load(r, v);
+                if (r.at_end()) { count_hit(); return v; }
+            } catch (const std::exception&) {}
+        }
+        count_miss();
+        T v = compute();
+        BinWriter w;
+        save(w, v);
+        write_entry(stage, k, w.data());
+        return v;
+    }
+
+    StageCache(StageCache&& o) noexcept : dir_(std::move(o.dir_)), hits_(o.hits_.load()), misses_(o.misses_.load()) {}
+
+private:
+    std::string path_of(const char* stage, const CacheKey& k) const;
+    bool read_entry(const char* stage, const CacheKey& k, std::string& payload) const;
+    void write_entry(const char* stage, const CacheKey& k, const std::string& payload) const;
+    void count_hit();
+    void count_miss();
+
+    std::string dir_;
+    std::atomic<size_t> hits_{0}, misses_{0};
+};
+
+} // namespace util
@@ -1,11 +1,14 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <cmath>
 #include <cstdint>
 #include <string>
 
 #include "utilities/DataOrdering.hpp"  // per util::PriceTable
 
+namespace util { class CompactPriceTable; }
+
 namespace stats {
 
     struct OUBootstrapResult {
@@ -13,6 +16,7 @@ namespace stats {
         double k   = 0.0;
         double eta = 0.0;
         double sigma = 0.0;
+        double dt = 0.0;        // passo usato per la stima (anni)
 
         // campioni bootstrap (M elementi)
         std::vector<double> boot_k;
@@ -25,11 +29,37 @@ namespace stats {
         std::array<double,2> CI_sigma{NAN, NAN};
     };
 
-    // Stima MLE + bootstrap parametrico OU sul campo Rt del PriceTable pulito
+    // Somme sufficienti del MLE OU sulle coppie (x_i, x_{i+1}), i = 0..N-1
+    struct OUSums {
+        size_t N = 0;
+        double sum_m = 0.0, sum_p = 0.0;                  // Σx_i, Σx_{i+1}
+        double sum_mm = 0.0, sum_pp = 0.0, sum_pm = 0.0;  // Σx_i², Σx_{i+1}², Σx_i·x_{i+1}
+        double x_first = 0.0, x_last = 0.0;               // x_0, x_N
+    };
+
+    struct OUEstimate {
+        double k = 0.0, eta = 0.0, sigma = 0.0;
+        double rho = 0.0;   // autocorrelazione a 1 passo prima del clamp in (0,1)
+    };
+
+    // MLE chiuso OU dalle somme sufficienti (dt in anni)
+    OUEstimate ou_mle_from_sums(const OUSums& S, double dt);
+
+    // Stima MLE + bootstrap parametrico OU sul campo Rt del PriceTable pulito.
+    // dt = passo tra le barre in anni (default 30 min; util::measure_dt_years
+    // lo ricava dai timestamp, es. dopo util::resample_ticks)
     OUBootstrapResult ou_bootstrap(const util::PriceTable& clean_data,
                                    int M = 1000,
                                    double alpha = 0.05,
-                                   std::uint64_t seed = 42);
+                                   std::uint64_t seed = 42,
+                                   double dt = (0.5/24.0)/365.0);
+
+    // stessa stima sulla colonna Rt (double) della tabella compatta
+    OUBootstrapResult ou_bootstrap(const util::CompactPriceTable& clean_data,
+                                   int M = 1000,
+                                   double alpha = 0.05,
+                                   std::uint64_t seed = 42,
+                                   double dt = (0.5/24.0)/365.0);
 
     // stampa formattata delle stime e CI
     void print_ou_estimates(const OUBootstrapResult& R);
@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include "utilities/Backtest.hpp"
+
+namespace util {
+
+// receives each trade as it closes (e.g. from StreamingBacktester's on_* results)
+using TradeSink = std::function<void(const Trade&)>;
+
+/**
+ * Event-driven version of backtest_os: one call per tick, O(1) work and memory.
+ * - Same Flat/Long/Short rules, costs and MetricsAccumulator as backtest_os,
+ *   so replaying an OS table through on_row() gives identical metrics.
+ * - No allocation at all: the last closed trade is kept in a reusable slot.
+ * - Times are epoch seconds (iso_to_epoch_seconds); on_row parses r.Time only
+ *   on entry/exit bars.
+ * - Each on_* call returns a pointer to the trade closed on that tick, or nullptr.
+ */
+class StreamingBacktester {
+public:
+    enum class State { Flat, Long, Short };
+
+    explicit StreamingBacktester(const BacktestConfig& cfg);
+
+    // raw quotes in source units, converted as the loader does (price x convs[leg]):
+    // Mid = (bid+ask)/2 per leg, X = log(Mid1/Mid2). Pass the run's convs to match on_row.
+    const Trade* on_tick(std::int64_t time,
+                         double bid1, double ask1,
+                         double bid2, double ask2,
+                         const std::array<double,2>& convs = {1.0, 1.0});
+
+    // one OS row (uses the loader's Rt, exactly as backtest_os)
+    const Trade* on_row(const PriceRow& r);
+
+    // quotes plus the source's own spread x (e.g. a feed carrying the loader's Rt):
+    // same result as on_row on the row they came from
+    const Trade* on_quote(std::int64_t time, double x,
+                          double bid1, double ask1,
+                          double bid2, double ask2);
+
+    // precomputed spread and half-cost (per unit leverage); trade times stay 0
+    const Trade* on_bar(double x, double half_cost);
+
+    BacktestMetrics metrics() const { return acc_.finish(); }
+    double equity() const { return acc_.equity; }
+    State  state()  const { return st_; }
+    size_t bars()   const { return i_; }
+
+    // live re-calibration (e.g. stats::RollingOUEstimator): z of later ticks
+    // uses the new eta / sigma_stat; an open position keeps its entry values
+    void set_ou(double eta, double sigma_stat){ cfg_.eta_hat = eta; sigma_stat_ = sigma_stat; }
+
+    // back to Flat with empty metrics (keeps cfg)
+    void reset();
+
+private:
+    template <class TimeFn>
+    const Trade* step(TimeFn&& time_of, double x, double half_cost);
+
+    BacktestConfig cfg_;
+    double sigma_stat_;
+    double f_abs_;
+
+    State  st_ = State::Flat;
+    size_t i_  = 0;        // index of the next tick
+
+    size_t i_entry_   = 0;
+    double x_entry_   = 0.0;
+    double z_entry_   = 0.0;
+    double f_used_    = 0.0;
+    double costs_acc_ = 0.0;
+    std::int64_t entry_ts_ = 0;
+
+    MetricsAccumulator acc_;
+    Trade last_;
+};
+
+} // namespace util
@@ -0,0 +1,97 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+#include "utilities/DataOrdering.hpp"
+#include "utilities/QuantileSketch.hpp"
+
+namespace util {
+
+// IQR fences of filter_log_spread_outliers / filter_antipersistent_outliers
+struct OutlierFences {
+    double q1 = NAN, q3 = NAN, iqr = NAN;
+    double lo = NAN, hi = NAN;          // q1 - 3 IQR, q3 + 3 IQR
+
+    static OutlierFences from(const KllSketch& s);
+    bool valid() const { return std::isfinite(iqr); }
+};
+
+enum class FenceMode {
+    Expanding,   // sketch of every Rt seen so far
+    Rolling,     // sketch of the last `window` bars
+    Frozen       // fences given up front (freeze), e.g. from merged chunk sketches
+};
+
+struct StreamingOutlierConfig {
+    FenceMode mode = FenceMode::Expanding;
+    size_t window = 4096;           // bars, Rolling only
+    size_t n_blocks = 8;            // sub-sketches per window, Rolling only
+    std::uint32_t k = 200;          // KLL accuracy
+    size_t warmup = 100;            // bars before fences are applied (not Frozen)
+    size_t refresh = 64;            // bars between fence recomputations
+    std::uint64_t seed = 42;
+};
+
+/**
+ * Online version of remove_outliers: one row in, at most one decision out.
+ * - Step 1 (log-spread): Rt outside the current fences is an outlier at once.
+ * - Step 2 (antipersistence): a step-1 survivor is flagged when
+ *   |x_t - x_prev| > IQR and |x_next - x_t| > 0.95 IQR, where prev/next are
+ *   the neighbouring step-1 survivors, so every survivor is held back by one
+ *   bar (lookahead) and released on the next survivor or on finish().
+ * - Fences come from a KLL sketch (expanding, rolling or frozen), refreshed
+ *   every cfg.refresh bars; memory is O(k log n), independent of the stream.
+ * Both steps use the same IQR (batch step 2 recomputes it on the step-1
+ * survivors; a 3-IQR cut barely moves the quartiles).
+ */
+class StreamingOutlierFilter {
+public:
+    struct Decision {
+        PriceRow row;
+        size_t index = 0;               // position in the input stream
+        bool outlier = false;
+        bool antipersistent = false;    // flagged by step 2 (else step 1)
+    };
+
+    explicit StreamingOutlierFilter(const StreamingOutlierConfig& cfg = {});
+    ~StreamingOutlierFilter();
+
+    void freeze(const OutlierFences& f);   // switches to FenceMode::Frozen
+
+    // decision released by this row (not necessarily about it), or nullptr
+    const Decision* push(const PriceRow& r);
+    // releases the last held survivor (nullptr if none)
+    const Decision* finish();
+
+    const OutlierFences& fences() const { return fences_; }
+    size_t rows() const { return n_; }
+
+private:
+    void observe(double x);
+
+    StreamingOutlierConfig cfg_;
+    OutlierFences fences_;
+    KllSketch sketch_;
+    std::unique_ptr<RollingQuantileSketch> rolling_;
+    size_t n_ = 0;
+    size_t since_refresh_ = 0;
+
+    bool has_prev_ = false;             // last released survivor (its Rt)
+    double prev_x_ = 0.0;
+    bool has_pending_ = false;          // survivor waiting for its lookahead
+    Decision pending_;
+    Decision out_;
+};
+
+/**
+ * remove_outliers on a table without sorting copies of Rt: O(n) with a KLL sketch.
+ * - Frozen (default for bounded tables): per-chunk sketches built in parallel,
+ *   merged in chunk order (deterministic for any n_threads), then one filter pass.
+ * - Expanding / Rolling: a single online pass, as a live feed would see it.
+ */
+OutlierResult remove_outliers_streaming(const PriceTable& data,
+                                        StreamingOutlierConfig cfg = {FenceMode::Frozen},
+                                        unsigned n_threads = 1);
+
+} // namespace util
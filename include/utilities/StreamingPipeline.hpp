@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+
+#include "utilities/Backtest.hpp"
+#include "utilities/BatchRunner.hpp"
+#include "utilities/OptimalBands.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+#include "utilities/StreamingBacktest.hpp"
+#include "utilities/StreamingOutliers.hpp"
+
+namespace util {
+
+struct StreamingPipelineOptions {
+    StreamingOutlierConfig outliers;    // Expanding: il flusso non ha il campione intero
+    double dt = (0.5/24.0)/365.0;       // passo delle barre in anni, come ou_bootstrap
+    size_t batch_rows = 4096;           // righe per batch tra gli stadi
+    size_t ring_batches = 8;            // batch in coda per ring (backpressure oltre)
+};
+
+struct StreamingPipelineResult {
+    stats::OUEstimate ou;               // MLE sull'IS pulito (niente CI bootstrap)
+    double C = 0.0;
+    OptimalBandsResult bands;           // (spec.l_bt, spec.f_bt)
+    BacktestMetrics metrics;
+
+    size_t rows_parsed = 0;
+    size_t IS_rows = 0, IS_clean = 0;   // dopo la finestra oraria / dopo gli outlier
+    size_t OS_rows = 0, OS_clean = 0;
+    size_t out_of_order = 0;            // righe con Time < riga precedente (vedi sotto)
+
+    double first_os_ms = 0.0;           // dall'avvio alla prima barra OS backtestata
+    double wall_ms = 0.0;
+    size_t parser_stalls = 0;           // push su ring pieno = stadio a valle più lento
+    size_t cleaner_stalls = 0;
+    size_t rows_in_flight = 0;          // tetto di righe in memoria: batch allocati x batch_rows
+};
+
+/**
+ * One RunSpec as three concurrent stages linked by bounded SPSC rings:
+ *   parser (stream_price_data_csv) -> cleaner (split, hour windows, cost C,
+ *   StreamingOutlierFilter IS/OS) -> calling thread (OU sums on IS, then bands
+ *   and StreamingBacktester on OS).
+ * - Batches of rows travel by pointer and go back to their producer through a
+ *   free ring, so memory is fixed (rows_in_flight) whatever the file size and
+ *   the steady state does not allocate; a full ring blocks the producer.
+ * - The OU MLE, C and the (l_bt, f_bt) bands are computed once, when the first
+ *   OS batch arrives; OS bars are backtested as they are cleaned and each
+ *   closed trade goes to on_trade.
+ * - Rows must come in time order (the batch path sorts, a stream cannot): the
+ *   IS/OS split is taken at the first row crossing first-row + split_months.
+ *   Rows out of order are only counted.
+ * - Differences from run_batch: online outlier fences, no bootstrap CIs and
+ *   no l/f sweep. Any stage failing cancels the rings and the exception is
+ *   rethrown here (OU calibration with k <= 0 throws too).
+ */
+StreamingPipelineResult run_streaming_pipeline(const RunSpec& spec,
+                                               const StreamingPipelineOptions& opt = {},
+                                               const TradeSink& on_trade = {});
+
+} // namespace util
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+#include "utilities/ThreadPool.hpp"
+
+namespace util {
+
+/**
+ * Static DAG of pipeline stages.
+ * - add(name, fn, deps): deps are ids returned by earlier add() calls, so the
+ *   graph is acyclic by construction and insertion order is a topological order.
+ * - run(pool): nodes with no pending deps go to the pool; a finishing node
+ *   releases its dependents (atomic counters), so independent branches overlap
+ *   and wall time tends to the critical path. Do not call from a task of the same pool.
+ * - run_serial(): every node on the calling thread in insertion order
+ *   (deterministic, for debugging). run(1) does the same.
+ * - A throwing node skips all its (transitive) dependents; independent branches
+ *   still finish, then the exception of the lowest failed node id is rethrown.
+ * Each node runs inside a trace::Scope named after it (category "task").
+ */
+class TaskGraph {
+public:
+    using NodeId = size_t;
+
+    // name must outlive the process (string literal): it is used by the tracer
+    NodeId add(const char* name, std::function<void()> fn, std::initializer_list<NodeId> deps = {});
+    NodeId add(const char* name, std::function<void()> fn, const std::vector<NodeId>& deps);
+
+    void run(ThreadPool& pool);
+    void run(unsigned n_threads);       // 1 => run_serial, 0 => hardware_concurrency
+    void run_serial();
+
+    size_t size() const { return nodes_.size(); }
+    const char* name(NodeId id) const { return nodes_[id].name; }
+
+    // after a run: wall time of a node and longest dependency chain (ms)
+    double node_ms(NodeId id) const { return nodes_[id].ms; }
+    double critical_path_ms() const;
+
+private:
+    struct Node {
+        const char* name = "";
+        std::function<void()> fn;
+        std::vector<NodeId> deps;
+        std::vector<NodeId> dependents;
+        double ms = 0.0;
+    };
+
+    // esegue il nodo i; false se saltato o fallito
+    bool execute(NodeId i, bool skip, std::exception_ptr& err);
+
+    std::vector<Node> nodes_;
+};
+
+} // namespace util
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace util {
+
+/**
+ * Work-stealing thread pool.
+ * - One deque per worker: the owner pops from the back (LIFO, cache-warm),
+ *   idle workers steal from the front of the others (FIFO, oldest work).
+ * - submit() from inside a task pushes onto the caller's own deque, so
+ *   nested fan-out stays local; external submits are spread round-robin.
+ * - Exceptions thrown by a task are stored in its future.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned n_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <class F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> fut = task->get_future();
+        push([task]{ (*task)(); });
+        return fut;
+    }
+
+    // blocks until every submitted task has finished (not from inside a task)
+    void wait_idle();
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> q;
+    };
+
+    void push(std::function<void()> job);
+    bool try_pop(unsigned self, std::function<void()>& job);
+    void worker_loop(unsigned self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex idle_m_;
+    std::condition_variable wake_cv_;
+    std::condition_variable idle_cv_;
+    std::atomic<size_t> pending_{0};     // queued + running
+    std::atomic<unsigned> next_{0};      // round-robin for external submits
+    bool stop_ = false;
+};
+
+} // namespace util
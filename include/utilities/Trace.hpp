@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// 1 = instrumentation compiled in (default); 0 = Scope/Counter are empty inline no-ops
+#ifndef ARBITRAGE_TRACE
+#define ARBITRAGE_TRACE 1
+#endif
+
+namespace util::trace {
+
+namespace detail {
+    inline std::atomic<bool> on{false};
+    void scope_end(const char* name, const char* cat, std::int64_t t0_ns,
+                   std::uint64_t allocs0, std::uint64_t bytes0);
+    std::int64_t now_ns();
+    std::uint64_t thread_allocs();
+    std::uint64_t thread_alloc_bytes();
+    void register_counter(const char* name, std::atomic<std::uint64_t>* v);
+}
+
+/**
+ * Runtime switch. While disabled every Scope/Counter costs one relaxed atomic load.
+ * count_allocs only has an effect if the build defines ARBITRAGE_TRACE_ALLOCS
+ * (replaced global operator new, see CMake option of the same name).
+ */
+void enable(bool on = true, bool count_allocs = false);
+inline bool enabled(){ return ARBITRAGE_TRACE && detail::on.load(std::memory_order_relaxed); }
+
+// ARBITRAGE_TRACE unset/""/"0" => off; "1" => on, trace in outputs/trace.json; otherwise
+// the value is the trace path. ARBITRAGE_TRACE_ALLOCS=1 turns on allocation counting.
+// Returns the trace path ("" if tracing stays off).
+std::string enable_from_env();
+
+/**
+ * RAII timer: one complete event (name, thread, start, duration, allocations made
+ * on this thread) per scope. name/cat must outlive the process (string literals).
+ */
+class Scope {
+public:
+    explicit Scope(const char* name, const char* cat = "stage"){
+#if ARBITRAGE_TRACE
+        if (enabled()){
+            name_ = name; cat_ = cat;
+            allocs0_ = detail::thread_allocs();
+            bytes0_  = detail::thread_alloc_bytes();
+            t0_ = detail::now_ns();
+        }
+#else
+        (void)name; (void)cat;
+#endif
+    }
+    ~Scope(){
+#if ARBITRAGE_TRACE
+        if (name_) detail::scope_end(name_, cat_, t0_, allocs0_, bytes0_);
+#endif
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+#if ARBITRAGE_TRACE
+    const char* name_ = nullptr;
+    const char* cat_ = nullptr;
+    std::int64_t t0_ = 0;
+    std::uint64_t allocs0_ = 0, bytes0_ = 0;
+#endif
+};
+
+/**
+ * Named process-wide counter (rows parsed, replicates, NLopt evaluations, trades, ...).
+ * Declare it static (namespace scope or function-local); add() is a relaxed
+ * fetch_add, skipped while tracing is off.
+ */
+class Counter {
+public:
+    explicit Counter(const char* name){
+#if ARBITRAGE_TRACE
+        detail::register_counter(name, &v_);
+#else
+        (void)name;
+#endif
+    }
+    void add(std::uint64_t n = 1){
+#if ARBITRAGE_TRACE
+        if (enabled()) v_.fetch_add(n, std::memory_order_relaxed);
+#else
+        (void)n;
+#endif
+    }
+    std::uint64_t value() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> v_{0};
+};
+
+struct StageStats {
+    std::string name;
+    std::uint64_t calls = 0;
+    double total_ms = 0.0, min_ms = 0.0, max_ms = 0.0;
+    std::uint64_t allocs = 0, alloc_bytes = 0;   // 0 unless allocation counting is on
+};
+
+// per-name aggregates over all threads, in order of first start
+std::vector<StageStats> stage_summary();
+std::vector<std::pair<std::string, std::uint64_t>> counter_values();
+
+// process-wide allocation totals (0 unless allocation counting is on) and peak RSS
+std::uint64_t total_allocs();
+std::uint64_t total_alloc_bytes();
+long peak_rss_kb();
+
+// Call once the traced work is finished (buffers are not locked against writers).
+void write_summary(std::ostream& os);
+bool write_chrome_trace(const std::string& path);   // trace-event JSON (chrome://tracing, Perfetto)
+
+// drops recorded events and zeroes the counters
+void reset();
+
+} // namespace util::trace
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "utilities/Backtest.hpp"
+
+namespace util {
+
+enum class ResampleScheme {
+    IID,    // trade PnLs drawn with replacement
+    Block   // circular blocks of block_len consecutive trades (keeps serial dependence)
+};
+
+struct TradeBootstrapConfig {
+    size_t n_resamples = 10000;
+    ResampleScheme scheme = ResampleScheme::IID;
+    size_t block_len = 5;
+    double alpha = 0.05;          // (1-alpha) percentile CI
+    unsigned n_threads = 0;       // 0 => hardware_concurrency
+    std::uint64_t seed = 42;
+    bool keep_samples = false;    // also return per-replicate metrics
+};
+
+struct MetricCI {
+    double point = NAN;           // on the original trade sequence
+    double lo    = NAN;
+    double hi    = NAN;
+};
+
+struct TradeBootstrapResult {
+    MetricCI sharpe_bar;
+    MetricCI hit_ratio;
+    MetricCI avg_pnl;
+    MetricCI sum_pnl;
+    MetricCI max_dd;
+    std::vector<BacktestMetrics> samples;  // n_resamples entries if keep_samples
+};
+
+/**
+ * Percentile CIs for BacktestMetrics by resampling trade PnLs.
+ * - Each replicate rebuilds the equity sequence from the drawn PnLs and
+ *   accumulates it with MetricsAccumulator (max drawdown included), so the
+ *   inner loop does not allocate.
+ * - Replicate r uses its own RNG stream stream_seed(seed, r): results do not
+ *   depend on the number of threads.
+ */
+TradeBootstrapResult bootstrap_trade_metrics(
+    const std::vector<double>& pnls,
+    const TradeBootstrapConfig& cfg
+);
+
+TradeBootstrapResult bootstrap_trade_metrics(
+    const BacktestResult& bt,
+    const TradeBootstrapConfig& cfg
+);
+
+// Many configurations at once (e.g. the trade lists of a backtest_sweep):
+// parallel over configurations, replicates of one config run sequentially.
+std::vector<TradeBootstrapResult> bootstrap_trade_metrics_batch(
+    const std::vector<std::vector<double>>& pnls_per_config,
+    const TradeBootstrapConfig& cfg
+);
+
+} // namespace util
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace util {
+
+/**
+ * Streaming reader for one worksheet of an .xlsx workbook.
+ * - The zip central directory is read once; the sheet entry is inflated
+ *   (zlib, raw deflate) in fixed-size chunks while it is parsed.
+ * - SAX-style scan of <row>/<c>/<v>/<is><t>: no DOM, one row alive at a time.
+ * - Shared strings (xl/sharedStrings.xml) are resolved to text; numeric cells
+ *   are returned as written in the XML (Excel serial dates stay numbers).
+ * Memory is O(chunk + shared strings + widest row), independent of sheet size.
+ *
+ * sheet = 1 => xl/worksheets/sheet1.xml (Excel's own numbering of the parts).
+ */
+class XlsxSheetReader {
+public:
+    explicit XlsxSheetReader(const std::string& path, int sheet = 1);
+    ~XlsxSheetReader();
+
+    XlsxSheetReader(const XlsxSheetReader&) = delete;
+    XlsxSheetReader& operator=(const XlsxSheetReader&) = delete;
+
+    // next non-empty row; cells placed by column letter, gaps => "". false at end
+    bool next_row(std::vector<std::string>& cells);
+
+    const std::vector<std::string>& shared_strings() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> p_;
+};
+
+// Excel serial date (1900 system, days since 1899-12-30) -> "YYYY-MM-DD HH:MM:SS"
+std::string excel_serial_to_iso(double serial);
+
+} // namespace util
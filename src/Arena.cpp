@@ -0,0 +1,74 @@
+#include "utilities/Arena.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace util {
+
+namespace {
+trace::Counter c_arena_blocks("arena_blocks");    // blocchi presi dall'upstream
+} // anon
+
+Arena::Arena(size_t first_block, size_t retain_bytes, std::pmr::memory_resource* upstream)
+    : first_block_(std::max<size_t>(first_block, 256)), retain_(retain_bytes), up_(upstream) {}
+
+Arena::~Arena(){ release(); }
+
+size_t Arena::used_bytes() const {
+    size_t n = off_;
+    for (size_t b=0; b<cur_ && b<blocks_.size(); ++b) n += blocks_[b].size;
+    return n;
+}
+
+void* Arena::do_allocate(size_t n, size_t align){
+    for (;;){
+        if (cur_ < blocks_.size()){
+            Block& B = blocks_[cur_];
+            // si allinea l'indirizzo, non l'offset: i blocchi sono allineati solo a
+            // max_align_t, e n + align basta anche per align maggiori
+            const std::uintptr_t at = reinterpret_cast<std::uintptr_t>(B.p) + off_;
+            const size_t start = off_ + ((align - at % align) % align);
+            if (start + n <= B.size){
+                off_ = start + n;
+                high_water_ = std::max(high_water_, used_bytes());
+                return B.p + start;
+            }
+            if (cur_ + 1 < blocks_.size()) { ++cur_; off_ = 0; continue; }
+        }
+        // nessun blocco tenuto basta: uno nuovo, almeno il doppio dell'ultimo
+        const size_t last = blocks_.empty() ? first_block_ / 2 : blocks_.back().size;
+        const size_t size = std::max(2 * last, n + align);
+        blocks_.push_back({static_cast<std::byte*>(up_->allocate(size, alignof(std::max_align_t))), size});
+        reserved_ += size;
+        c_arena_blocks.add();
+        cur_ = blocks_.size() - 1;
+        off_ = 0;
+    }
+}
+
+void Arena::rewind(Mark m){
+    cur_ = m.block;
+    off_ = m.offset;
+    if (cur_ != 0 || off_ != 0 || reserved_ <= retain_) return;
+    // arena vuota: restituisce i blocchi oltre la soglia (dai più grandi, in coda)
+    while (blocks_.size() > 1 && reserved_ > retain_){
+        const Block b = blocks_.back();
+        blocks_.pop_back();
+        up_->deallocate(b.p, b.size, alignof(std::max_align_t));
+        reserved_ -= b.size;
+    }
+}
+
+void Arena::release(){
+    for (const auto& b : blocks_) up_->deallocate(b.p, b.size, alignof(std::max_align_t));
+    blocks_.clear();
+    cur_ = off_ = 0;
+    reserved_ = 0;
+}
+
+Arena& thread_arena(){
+    thread_local Arena a;
+    return a;
+}
+
+} // namespace util
@@ -1,185 +1,249 @@
 #include "utilities/Backtest.hpp"
+#include "utilities/CompactPrices.hpp"
 #include "utilities/Loaders.hpp"     // for PriceRow/PriceTable
+#include "utilities/Trace.hpp"
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
 #include <limits>
+#include <stdexcept>
 
 namespace util {
 
+static trace::Counter c_trades("trades");
+
 static inline double safe_log_ratio(double a, double b){
     return (a>0.0 && b>0.0) ? std::log(a/b) : 0.0;
 }
 
+// ---------------------------------------------------------------------------
+// Policy-specialized kernels.
+// Each (side, cost, record) combination compiles to its own loop: no per-bar
+// test on cfg.symmetric / cfg.record, no 3-way state switch, and the cost
+// (two logs) is evaluated only on entry/exit bars instead of every bar.
+// The leverage is resolved once before the loop (NaN => f=1, as before).
+// The table is a template parameter too: PriceTable rows or CompactPriceTable
+// columns, where the per-bar scan only touches the contiguous Rt column.
+// ---------------------------------------------------------------------------
+namespace {
+
+double rt_at(const PriceTable& t, size_t i)        { return t[i].Rt; }
+double rt_at(const CompactPriceTable& t, size_t i) { return t.rt(i); }
+std::int64_t ts_at(const PriceTable& t, size_t i)        { return iso_to_epoch_seconds(t[i].Time); }
+std::int64_t ts_at(const CompactPriceTable& t, size_t i) { return t.ts(i); }
+
+struct SymmetricSide { static constexpr bool symmetric = true;  };
+struct LongOnlySide  { static constexpr bool symmetric = false; };
+
+struct QuotedCost {
+    static double half(const PriceTable& t, size_t i){
+        const PriceRow& r = t[i];
+        return 0.5 * (safe_log_ratio(r.Ask1, r.Bid1) + safe_log_ratio(r.Ask2, r.Bid2));
+    }
+    static double half(const CompactPriceTable& t, size_t i){
+        return 0.5 * (safe_log_ratio(t.ask1(i), t.bid1(i)) + safe_log_ratio(t.ask2(i), t.bid2(i)));
+    }
+};
+struct ZeroCost {
+    template <class Table>
+    static double half(const Table&, size_t){ return 0.0; }
+};
+
+struct RecordAll  { static constexpr bool enabled = true;  };
+struct RecordNone { static constexpr bool enabled = false; };
+
+struct KernelParams {
+    double d, u, l;
+    double f_abs;
+};
+
+// z-score sources: fixed OU parameters, or one (eta, sigma_stat) per bar.
+// operator() = z della barra (NaN => nessuna entrata); held() = z per TP/SL di una
+// posizione aperta, che non deve restare cieca nei tratti NaN del percorso.
+struct FixedZ {
+    double eta, sigma_stat;
+    double operator()(size_t, double x) const { return (x - eta) / sigma_stat; }
+    double held(size_t i, double x) const { return (*this)(i, x); }
+};
+struct PathZ {
+    const double* eta;
+    const double* sigma_stat;
+    mutable size_t last_ok = SIZE_MAX;      // ultima barra con parametri finiti vista dal kernel
+    double operator()(size_t i, double x) const {
+        const double z = (x - eta[i]) / sigma_stat[i];
+        if (std::isfinite(z)) last_ok = i;
+        return z;
+    }
+    // barra NaN: ultimi parametri finiti (il kernel chiama operator() su ogni barra, in ordine)
+    double held(size_t i, double x) const {
+        const double z = (*this)(i, x);
+        if (std::isfinite(z) || last_ok == SIZE_MAX) return z;
+        return (x - eta[last_ok]) / sigma_stat[last_ok];
+    }
+};
+
+template <class Side, class Cost, class Record, class Z, class Table>
+void run_kernel(const Table& os, const KernelParams& p, const Z& zf,
+                BacktestResult& R, MetricsAccumulator& acc)
+{
+    const size_t n = os.size();
+    size_t i = 0;
+
+    while (i < n){
+        // ---- Flat: scan for an entry ----
+        double z = 0.0;
+        int side = 0;
+        for (; i < n; ++i){
+            z = zf(i, rt_at(os, i));
+            if (z <= p.d) { side = +1; break; }
+            if constexpr (Side::symmetric){
+                if (z >= -p.d) { side = -1; break; }
+            }
+        }
+        if (side == 0) break;
+
+        const size_t i_entry = i;
+        const double x_entry = rt_at(os, i);
+        const double z_entry = z;
+        const double f_used  = side * p.f_abs;
+        const double f_abs   = std::abs(f_used);
+        double costs_acc     = f_abs * Cost::half(os, i);   // entry cost
+
+        // ---- Long/Short: scan for TP/SL ----
+        // short rules mirror the long ones: with s=-1, s*z is an exact negation,
+        // so (s*z >= u || s*z <= l) <=> (z <= -u || z >= -l)
+        const double s = static_cast<double>(side);
+        bool closed = false;
+        for (++i; i < n; ++i){
+            const double x  = rt_at(os, i);
+            z = zf.held(i, x);
+            const double sz = s * z;
+            if (sz >= p.u || sz <= p.l){
+                costs_acc += f_abs * Cost::half(os, i);     // exit cost
+                const double pnl = (x - x_entry) * f_used - costs_acc;
+                acc.on_close(pnl);
+
+                if constexpr (Record::enabled){
+                    Trade tr;
+                    tr.entry_idx = i_entry;
+                    tr.exit_idx  = i;
+                    tr.entry_ts  = ts_at(os, i_entry);
+                    tr.exit_ts   = ts_at(os, i);
+                    tr.z_entry   = z_entry;
+                    tr.z_exit    = z;
+                    tr.x_entry   = x_entry;
+                    tr.x_exit    = x;
+                    tr.f         = f_used;
+                    tr.costs     = costs_acc;
+                    tr.pnl       = pnl;
+                    tr.bars      = i - i_entry;
+                    R.trades.push_back(tr);
+                    if (pnl != 0.0) R.equity.push_back({i, acc.equity});
+                }
+                closed = true;
+                ++i;   // re-entry is checked from the next bar
+                break;
+            }
+        }
+        if (!closed) break;
+    }
+}
+
+template <class Z, class Table = PriceTable>
+using KernelFn = void(*)(const Table&, const KernelParams&, const Z&,
+                         BacktestResult&, MetricsAccumulator&);
+
+template <class Z, class Table, class Side, class Cost>
+KernelFn<Z, Table> pick_record(RecordMode mode){
+    return (mode == RecordMode::Full) ? &run_kernel<Side, Cost, RecordAll, Z, Table>
+                                      : &run_kernel<Side, Cost, RecordNone, Z, Table>;
+}
+
+template <class Z, class Table, class Side>
+KernelFn<Z, Table> pick_cost(const BacktestConfig& cfg){
+    return (cfg.cost == CostModel::Quoted) ? pick_record<Z, Table, Side, QuotedCost>(cfg.record)
+                                           : pick_record<Z, Table, Side, ZeroCost>(cfg.record);
+}
+
+// runtime dispatcher: BacktestConfig -> kernel instantiation
+template <class Z, class Table = PriceTable>
+KernelFn<Z, Table> pick_kernel(const BacktestConfig& cfg){
+    return cfg.symmetric ? pick_cost<Z, Table, SymmetricSide>(cfg)
+                         : pick_cost<Z, Table, LongOnlySide>(cfg);
+}
+
+KernelParams kernel_params(const BacktestConfig& cfg){
+    KernelParams p;
+    p.d = cfg.d; p.u = cfg.u; p.l = cfg.l;
+    p.f_abs = std::isfinite(cfg.f) ? cfg.f : 1.0; // if you pass NaN, default f=1 here
+    return p;
+}
+
+} // anon
+
 BacktestResult backtest_os(const PriceTable& os, const BacktestConfig& cfg)
 {
+    trace::Scope trace_scope("backtest_os");
     BacktestResult R;
 
     if (os.size() < 2) return R;
 
-    const double sigma_stat = cfg.sigma_hat / std::sqrt(2.0 * cfg.k_hat);
-
-    // equity path init
-    R.equity_path.reserve(os.size());
-    R.equity_time.reserve(os.size());
-    double equity = 0.0;
-    double peak   = 0.0;
-    double max_dd = 0.0;
-
-    // per-bar equity diffs for Sharpe
-    std::vector<double> dlog_e(os.size(), 0.0);
-
-    enum class State { Flat, Long, Short };
-    State st = State::Flat;
-
-    size_t i_entry = 0;
-    double x_entry = 0.0;
-    double z_entry = 0.0;
-    double f_used  = 0.0;
-    double costs_acc = 0.0;
-
-    auto flush_equity = [&](size_t i, double dlog){
-        equity += dlog;
-        dlog_e[i] = dlog;
-        R.equity_path.push_back(equity);
-        R.equity_time.push_back(os[i].Time);
-        peak = std::max(peak, equity);
-        max_dd = std::min(max_dd, equity - peak);
-    };
-
-    for (size_t i=0; i<os.size(); ++i){
-        const auto& r = os[i];
-        const double x = r.Rt; // your spread (log Mid1 / Mid2)
-        const double z = (x - cfg.eta_hat) / sigma_stat;
-
-        // half-cost at this bar per unit leverage
-        const double c_bar = safe_log_ratio(r.Ask1, r.Bid1) + safe_log_ratio(r.Ask2, r.Bid2);
-        const double half_cost = 0.5 * c_bar;
-
-        double dlog_now = 0.0; // equity change this bar (if we close)
-
-        switch (st){
-        case State::Flat:
-            // long entry
-            if (z <= cfg.d){
-                st = State::Long;
-                i_entry = i;
-                x_entry = x;
-                z_entry = z;
-                f_used  = std::isfinite(cfg.f) ? cfg.f : 1.0; // if you pass NaN, default f=1 here
-                costs_acc = std::abs(f_used) * half_cost;     // entry cost
-            }
-            // short entry (mirror)
-            else if (cfg.symmetric && z >= -cfg.d){
-                st = State::Short;
-                i_entry = i;
-                x_entry = x;
-                z_entry = z;
-                f_used  = - (std::isfinite(cfg.f) ? cfg.f : 1.0);
-                costs_acc = std::abs(f_used) * half_cost;
-            }
-            break;
-
-        case State::Long: {
-            bool takeprofit = (z >= cfg.u);
-            bool stoploss   = (z <= cfg.l);
-
-            if (takeprofit || stoploss){
-                const double gross = (x - x_entry) * f_used; // log PnL (no cost)
-                const double exit_cost = std::abs(f_used) * half_cost;
-                costs_acc += exit_cost;
-
-                Trade tr;
-                tr.entry_idx = i_entry;
-                tr.exit_idx  = i;
-                tr.entry_time= os[i_entry].Time;
-                tr.exit_time = r.Time;
-                tr.z_entry   = z_entry;
-                tr.z_exit    = z;
-                tr.x_entry   = x_entry;
-                tr.x_exit    = x;
-                tr.f         = f_used;
-                tr.costs     = costs_acc;
-                tr.pnl       = gross - costs_acc;
-                tr.bars      = i - i_entry;
-
-                R.trades.push_back(tr);
-
-                dlog_now = tr.pnl;
-                st = State::Flat;
-                f_used = 0.0;
-                costs_acc = 0.0;
-            }
-            break;
-        }
+    const FixedZ z{cfg.eta_hat, cfg.sigma_hat / std::sqrt(2.0 * cfg.k_hat)};
 
-        case State::Short: {
-            // mirror rules: exit TP when z <= -cfg.u ; stop when z >= -cfg.l
-            bool takeprofit = (z <= -cfg.u);
-            bool stoploss   = (z >= -cfg.l);
-
-            if (takeprofit || stoploss){
-                const double gross = (x_entry - x) * (-f_used); // or (x - x_entry)*f_used with f_used<0
-                const double exit_cost = std::abs(f_used) * half_cost;
-                costs_acc += exit_cost;
-
-                Trade tr;
-                tr.entry_idx = i_entry;
-                tr.exit_idx  = i;
-                tr.entry_time= os[i_entry].Time;
-                tr.exit_time = r.Time;
-                tr.z_entry   = z_entry;
-                tr.z_exit    = z;
-                tr.x_entry   = x_entry;
-                tr.x_exit    = x;
-                tr.f         = f_used;
-                tr.costs     = costs_acc;
-                tr.pnl       = gross - costs_acc;
-                tr.bars      = i - i_entry;
-
-                R.trades.push_back(tr);
-
-                dlog_now = tr.pnl;
-                st = State::Flat;
-                f_used = 0.0;
-                costs_acc = 0.0;
-            }
-            break;
-        }
-        } // switch
+    // metrics accumulated online (no second pass over per-bar diffs)
+    MetricsAccumulator acc;
+    pick_kernel<FixedZ>(cfg)(os, kernel_params(cfg), z, R, acc);
+    R.metrics = acc.finish();
+    c_trades.add(R.metrics.n_trades);
 
-        flush_equity(i, dlog_now);
-    }
+    return R;
+}
 
-    // compute metrics
-    R.metrics.n_trades = R.trades.size();
-    size_t wins = 0;
-    double sum_pnl = 0.0;
-    for (const auto& t : R.trades){
-        sum_pnl += t.pnl;
-        if (t.pnl > 0.0) ++wins;
-    }
-    R.metrics.winners  = wins;
-    R.metrics.hit_ratio= (R.metrics.n_trades ? (double)wins / R.metrics.n_trades : 0.0);
-    R.metrics.sum_pnl  = sum_pnl;
-    R.metrics.avg_pnl  = (R.metrics.n_trades ? sum_pnl / R.metrics.n_trades : 0.0);
-    R.metrics.equity_end = (R.equity_path.empty() ? 0.0 : R.equity_path.back());
-    R.metrics.max_dd = max_dd; // negative number (log drawdown)
-
-    // simple per-bar Sharpe on equity diffs
-    // remove zeros (most bars will be 0 when flat/holding)
-    double m=0.0, s=0.0;
-    size_t n=0;
-    for (double v : dlog_e){ if (v!=0.0){ m += v; ++n; } }
-    if (n>1){
-        m /= n;
-        double var=0.0;
-        for (double v : dlog_e){ if (v!=0.0){ double d=v-m; var+=d*d; } }
-        var /= (n-1);
-        s = std::sqrt(std::max(0.0, var));
-        R.metrics.sharpe_bar = (s>0.0 ? m/s : 0.0);
-    }
+BacktestResult backtest_os(const CompactPriceTable& os, const BacktestConfig& cfg)
+{
+    trace::Scope trace_scope("backtest_os");
+    BacktestResult R;
+
+    if (os.size() < 2) return R;
+
+    const FixedZ z{cfg.eta_hat, cfg.sigma_hat / std::sqrt(2.0 * cfg.k_hat)};
+    MetricsAccumulator acc;
+    pick_kernel<FixedZ, CompactPriceTable>(cfg)(os, kernel_params(cfg), z, R, acc);
+    R.metrics = acc.finish();
+    c_trades.add(R.metrics.n_trades);
 
     return R;
 }
 
+BacktestResult backtest_os(const PriceTable& os, const BacktestConfig& cfg,
+                           const OUParamPath& path)
+{
+    if (path.eta.size() != os.size() || path.sigma_stat.size() != os.size())
+        throw std::invalid_argument("backtest_os: OU path must have one entry per OS bar.");
+
+    trace::Scope trace_scope("backtest_os");
+    BacktestResult R;
+    if (os.size() < 2) return R;
+
+    const PathZ z{path.eta.data(), path.sigma_stat.data()};
+    MetricsAccumulator acc;
+    pick_kernel<PathZ>(cfg)(os, kernel_params(cfg), z, R, acc);
+    R.metrics = acc.finish();
+    c_trades.add(R.metrics.n_trades);
+
+    return R;
+}
+
+std::vector<double> dense_equity(const BacktestResult& R, size_t n_bars)
+{
+    std::vector<double> out(n_bars, 0.0);
+    double eq = 0.0;
+    size_t k = 0;
+    for (size_t i=0; i<n_bars; ++i){
+        while (k < R.equity.size() && R.equity[k].idx <= i) eq = R.equity[k++].log_equity;
+        out[i] = eq;
+    }
+    return out;
+}
+
 } // namespace util
\ No newline at end of file
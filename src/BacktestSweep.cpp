@@ -0,0 +1,145 @@
+#include "utilities/BacktestSweep.hpp"
+#include "utilities/Loaders.hpp"     // for PriceRow/PriceTable
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+namespace util {
+
+static inline double safe_log_ratio(double a, double b){
+    return (a>0.0 && b>0.0) ? std::log(a/b) : 0.0;
+}
+
+namespace {
+
+enum : std::uint8_t { FLAT = 0, LONG = 1, SHORT = 2 };
+
+// Stato SoA: un elemento per config
+struct SweepState {
+    // parametri (costanti durante il loop)
+    std::vector<double> eta, sigma_stat;
+    std::vector<double> d, u, l, f_abs;
+    std::vector<std::uint8_t> symmetric, quoted_cost;
+
+    // macchina a stati
+    std::vector<std::uint8_t> st;
+    std::vector<size_t> i_entry;
+    std::vector<double> x_entry, z_entry, f_used, costs_acc;
+
+    // metriche accumulate (stesse formule di backtest_os)
+    std::vector<MetricsAccumulator> acc;
+
+    explicit SweepState(size_t n)
+        : eta(n), sigma_stat(n), d(n), u(n), l(n), f_abs(n), symmetric(n), quoted_cost(n),
+          st(n, FLAT), i_entry(n, 0), x_entry(n, 0.0), z_entry(n, 0.0),
+          f_used(n, 0.0), costs_acc(n, 0.0), acc(n) {}
+};
+
+} // anon
+
+SweepResult backtest_sweep(const PriceTable& os,
+                           const std::vector<BacktestConfig>& cfgs,
+                           bool keep_trades)
+{
+    SweepResult R;
+    const size_t K = cfgs.size();
+    R.metrics.resize(K);
+    if (keep_trades) R.trades.resize(K);
+    if (os.size() < 2 || K == 0) return R;
+
+    const size_t n = os.size();
+
+    // colonne precalcolate una volta per tutte le config
+    std::vector<double> x(n), half_cost(n);
+    for (size_t i=0; i<n; ++i){
+        const auto& r = os[i];
+        x[i] = r.Rt;
+        const double c_bar = safe_log_ratio(r.Ask1, r.Bid1) + safe_log_ratio(r.Ask2, r.Bid2);
+        half_cost[i] = 0.5 * c_bar;
+    }
+
+    SweepState S(K);
+    bool shared_ou = true;
+    for (size_t j=0; j<K; ++j){
+        const auto& c = cfgs[j];
+        S.eta[j]        = c.eta_hat;
+        S.sigma_stat[j] = c.sigma_hat / std::sqrt(2.0 * c.k_hat);
+        S.d[j] = c.d; S.u[j] = c.u; S.l[j] = c.l;
+        S.f_abs[j] = std::isfinite(c.f) ? c.f : 1.0; // come backtest_os: NaN => f=1
+        S.symmetric[j] = c.symmetric ? 1 : 0;
+        S.quoted_cost[j] = (c.cost == CostModel::Quoted) ? 1 : 0;
+        if (c.k_hat != cfgs[0].k_hat || c.eta_hat != cfgs[0].eta_hat ||
+            c.sigma_hat != cfgs[0].sigma_hat) shared_ou = false;
+    }
+
+    // z condiviso se tutte le config usano gli stessi parametri OU
+    std::vector<double> z_shared;
+    if (shared_ou){
+        z_shared.resize(n);
+        for (size_t i=0; i<n; ++i) z_shared[i] = (x[i] - S.eta[0]) / S.sigma_stat[0];
+    }
+
+    for (size_t i=0; i<n; ++i){
+        const double xi = x[i];
+
+        for (size_t j=0; j<K; ++j){
+            const double z  = shared_ou ? z_shared[i] : (xi - S.eta[j]) / S.sigma_stat[j];
+            const double hc = S.quoted_cost[j] ? half_cost[i] : 0.0;
+
+            if (S.st[j] == FLAT){
+                int side = 0;
+                if (z <= S.d[j])                      side = +1;
+                else if (S.symmetric[j] && z >= -S.d[j]) side = -1;
+                if (side != 0){
+                    S.st[j]        = (side > 0) ? LONG : SHORT;
+                    S.i_entry[j]   = i;
+                    S.x_entry[j]   = xi;
+                    S.z_entry[j]   = z;
+                    S.f_used[j]    = (side > 0) ? S.f_abs[j] : -S.f_abs[j];
+                    S.costs_acc[j] = std::abs(S.f_used[j]) * hc;
+                }
+                continue;
+            }
+
+            const bool is_long = (S.st[j] == LONG);
+            const bool exit_now = is_long
+                ? (z >= S.u[j]  || z <= S.l[j])
+                : (z <= -S.u[j] || z >= -S.l[j]);
+            if (!exit_now) continue;
+
+            // (x_entry - x)*(-f) == (x - x_entry)*f anche bit a bit
+            const double gross = (xi - S.x_entry[j]) * S.f_used[j];
+            const double costs = S.costs_acc[j] + std::abs(S.f_used[j]) * hc;
+            const double pnl   = gross - costs;
+
+            if (keep_trades){
+                Trade tr;
+                tr.entry_idx = S.i_entry[j];
+                tr.exit_idx  = i;
+                tr.entry_ts  = iso_to_epoch_seconds(os[S.i_entry[j]].Time);
+                tr.exit_ts   = iso_to_epoch_seconds(os[i].Time);
+                tr.z_entry   = S.z_entry[j];
+                tr.z_exit    = z;
+                tr.x_entry   = S.x_entry[j];
+                tr.x_exit    = xi;
+                tr.f         = S.f_used[j];
+                tr.costs     = costs;
+                tr.pnl       = pnl;
+                tr.bars      = i - S.i_entry[j];
+                R.trades[j].push_back(std::move(tr));
+            }
+
+            S.acc[j].on_close(pnl);
+
+            S.st[j]        = FLAT;
+            S.f_used[j]    = 0.0;
+            S.costs_acc[j] = 0.0;
+        }
+    }
+
+    for (size_t j=0; j<K; ++j) R.metrics[j] = S.acc[j].finish();
+
+    return R;
+}
+
+} // namespace util
@@ -0,0 +1,639 @@
+#include "utilities/BatchRunner.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/Loaders.hpp"
+#include "utilities/Parallel.hpp"
+#include "utilities/Resample.hpp"
+#include "utilities/ResultWriter.hpp"
+#include "utilities/RunOutputs.hpp"
+#include "utilities/StageCache.hpp"
+#include "utilities/TaskGraph.hpp"
+#include "utilities/ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace util {
+
+namespace {
+
+// ------------------------- job file -------------------------
+std::string trim(const std::string& s){
+    const auto b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return "";
+    const auto e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+std::vector<std::string> split_trim(const std::string& s, char sep){
+    std::vector<std::string> out;
+    size_t b = 0;
+    for (;;){
+        const size_t e = s.find(sep, b);
+        out.push_back(trim(s.substr(b, e == std::string::npos ? std::string::npos : e - b)));
+        if (e == std::string::npos) break;
+        b = e + 1;
+    }
+    return out;
+}
+
+// numero finito: "opt", "nan", "inf" sono errori qui, non a valle nelle bande
+double to_double(const std::string& s){
+    size_t pos = 0;
+    double v = 0.0;
+    try { v = std::stod(s, &pos); } catch (const std::exception&) { pos = 0; }
+    if (s.empty() || pos != s.size() || !std::isfinite(v)) throw std::invalid_argument("not a number: '" + s + "'");
+    return v;
+}
+
+// leva: numero finito o "opt" (=> NaN, f*); solo per f_list / f_bt
+double to_leverage(const std::string& s){
+    if (s == "opt") return std::numeric_limits<double>::quiet_NaN();
+    return to_double(s);
+}
+
+long long to_int(const std::string& s){
+    size_t pos = 0;
+    long long v = 0;
+    try { v = std::stoll(s, &pos); } catch (const std::exception&) { pos = 0; }
+    if (s.empty() || pos != s.size() || v < 0) throw std::invalid_argument("not a non-negative integer: '" + s + "'");
+    return v;
+}
+
+bool to_bool(const std::string& s){
+    if (s == "1" || s == "true"  || s == "yes") return true;
+    if (s == "0" || s == "false" || s == "no")  return false;
+    throw std::invalid_argument("not a boolean: '" + s + "'");
+}
+
+std::vector<double> to_doubles(const std::string& s, double (*conv)(const std::string&) = to_double){
+    std::vector<double> v;
+    for (const auto& x : split_trim(s, ',')) v.push_back(conv(x));
+    return v;
+}
+
+template <size_t N>
+std::array<double,N> to_darray(const std::string& s){
+    const auto v = to_doubles(s);
+    if (v.size() != N) throw std::invalid_argument("expected " + std::to_string(N) + " numbers");
+    std::array<double,N> a{};
+    std::copy(v.begin(), v.end(), a.begin());
+    return a;
+}
+
+template <size_t N>
+std::array<std::string,N> to_sarray(const std::string& s){
+    const auto v = split_trim(s, ',');
+    if (v.size() != N) throw std::invalid_argument("expected " + std::to_string(N) + " names");
+    std::array<std::string,N> a;
+    std::copy(v.begin(), v.end(), a.begin());
+    return a;
+}
+
+void apply_key(RunSpec& r, const std::string& k, const std::string& v){
+    const bool none = (v == "none" || v.empty());
+    if      (k == "csv")              r.csv_path = v;
+    else if (k == "time_col")         r.time_col = v;
+    else if (k == "bid_ask_cols")     r.bid_ask_cols = to_sarray<4>(v);
+    else if (k == "mid_cols")         r.mid_cols = none ? std::nullopt : std::optional(to_sarray<2>(v));
+    else if (k == "ticks")            r.ticks = none ? std::nullopt : std::optional(to_darray<2>(v));
+    else if (k == "convs")            r.convs = to_darray<2>(v);
+    else if (k == "start_date")       r.start_date = none ? std::nullopt : std::optional(v);
+    else if (k == "end_date")         r.end_date = none ? std::nullopt : std::optional(v);
+    else if (k == "bar")              r.bar_seconds = static_cast<std::int64_t>(to_int(v));
+    else if (k == "is_hours")         r.IS_hours = to_darray<2>(v);
+    else if (k == "cost_hours")       r.cost_hours = to_darray<2>(v);
+    else if (k == "os_exclude_hours") r.OS_exclude_hours = to_darray<2>(v);
+    else if (k == "split_months")     r.split_months = static_cast<int>(to_int(v));
+    else if (k == "m_boot")           r.M_boot = static_cast<int>(to_int(v));
+    else if (k == "alpha_ci")         r.alpha_CI = to_double(v);
+    else if (k == "seed")             r.seed = static_cast<std::uint64_t>(to_int(v));
+    else if (k == "l_list")           r.l_list = to_doubles(v);
+    else if (k == "f_list")           r.f_list = to_doubles(v, to_leverage);
+    else if (k == "m_opt")            r.M_opt = static_cast<int>(to_int(v));
+    else if (k == "alpha")            r.alpha = to_double(v);
+    else if (k == "grid")             r.grid = static_cast<int>(to_int(v));
+    else if (k == "l_bt")             r.l_bt = to_double(v);
+    else if (k == "f_bt")             r.f_bt = to_leverage(v);
+    else if (k == "symmetric")        r.symmetric = to_bool(v);
+    else if (k == "trade_resamples")  r.trade_resamples = static_cast<size_t>(to_int(v));
+    else if (k == "output_dir")       r.output_dir = v;
+    else throw std::invalid_argument("unknown key '" + k + "'");
+}
+
+struct KeyValue { std::string key, value; int line; };
+
+std::string safe_dir_name(const std::string& name){
+    std::string s = name;
+    for (char& c : s)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.' && c != '=' && c != ',')
+            c = '_';
+    return s;
+}
+
+// una sezione [run] -> una o più RunSpec (prodotto cartesiano delle chiavi con '|')
+void expand_run(const std::string& path, const std::string& name,
+                const std::vector<KeyValue>& kvs, std::vector<RunSpec>& out)
+{
+    std::vector<std::vector<std::string>> alts;
+    for (const auto& kv : kvs) alts.push_back(split_trim(kv.value, '|'));
+
+    std::vector<size_t> pick(kvs.size(), 0);
+    for (;;){
+        RunSpec r;
+        r.name = name;
+        std::string suffix;
+        for (size_t i=0; i<kvs.size(); ++i){
+            const std::string& v = alts[i][pick[i]];
+            try {
+                apply_key(r, kvs[i].key, v);
+            } catch (const std::exception& ex) {
+                throw std::runtime_error(path + ":" + std::to_string(kvs[i].line) + ": " + ex.what());
+            }
+            if (alts[i].size() > 1) suffix += (suffix.empty() ? "" : ",") + kvs[i].key + "=" + v;
+        }
+        if (!suffix.empty()) r.name += "/" + suffix;
+        if (r.output_dir.empty()) r.output_dir = "outputs/batch/" + safe_dir_name(r.name);
+        out.push_back(std::move(r));
+
+        // contatore misto sulle alternative
+        size_t i = 0;
+        for (; i<pick.size(); ++i){
+            if (++pick[i] < alts[i].size()) break;
+            pick[i] = 0;
+        }
+        if (i == pick.size()) break;
+    }
+}
+
+// ------------------------- stage slots -------------------------
+// output di uno stadio condiviso da più run; rilasciato dopo l'ultimo consumatore
+struct SlotBase {
+    std::string error;                  // non vuoto => stadio fallito (o input a monte fallito)
+    std::atomic<int> uses{0};           // consumatori non ancora conclusi
+    TaskGraph::NodeId node = 0;
+
+    virtual ~SlotBase() = default;
+    virtual void drop() = 0;
+    void release(){ if (uses.fetch_sub(1, std::memory_order_acq_rel) == 1) drop(); }
+};
+
+template <class T>
+struct Slot : SlotBase {
+    T value{};
+    void drop() override { value = T{}; }
+};
+
+template <class T>
+class StageTable {
+public:
+    // slot esistente con questa chiave, altrimenti nullptr
+    Slot<T>* find(const CacheKey& k){
+        auto it = index_.find({k.lo, k.hi});
+        return it == index_.end() ? nullptr : it->second;
+    }
+    Slot<T>& insert(const CacheKey& k){
+        Slot<T>& s = slots_.emplace_back();
+        index_[{k.lo, k.hi}] = &s;
+        return s;
+    }
+    size_t size() const { return slots_.size(); }
+
+private:
+    std::deque<Slot<T>> slots_;         // indirizzi stabili
+    std::map<std::pair<std::uint64_t, std::uint64_t>, Slot<T>*> index_;
+};
+
+// compute() solo se gli input sono validi, altrimenti propaga il primo errore; poi rilascia gli input
+template <class T, class F>
+void run_stage(Slot<T>& out, const std::vector<SlotBase*>& in, F&& compute){
+    for (auto* s : in) if (!s->error.empty()) { out.error = s->error; break; }
+    if (out.error.empty()){
+        try { out.value = compute(); }
+        catch (const std::exception& ex) { out.error = ex.what(); }
+    }
+    for (auto* s : in) s->release();
+}
+
+// etichetta della leva come in main ("1", "2", "5"); NaN => "opt"
+std::string f_label(double f){
+    if (std::isnan(f)) return "opt";
+    std::ostringstream oss;
+    oss << f;
+    return oss.str();
+}
+
+} // anon
+
+// ------------------------- parse -------------------------
+std::vector<RunSpec> parse_job_file(const std::string& path){
+    std::ifstream f(path);
+    if (!f) throw std::runtime_error("cannot open job file " + path);
+
+    std::vector<KeyValue> defaults;
+    std::vector<KeyValue>* cur = nullptr;
+    std::vector<std::pair<std::string, std::vector<KeyValue>>> runs;   // (nome, default + propri)
+
+    std::string line;
+    for (int ln = 1; std::getline(f, line); ++ln){
+        const auto c = line.find_first_of("#;");
+        line = trim(c == std::string::npos ? line : line.substr(0, c));
+        if (line.empty()) continue;
+
+        auto fail = [&](const std::string& msg){
+            throw std::runtime_error(path + ":" + std::to_string(ln) + ": " + msg);
+        };
+        if (line.front() == '['){
+            if (line.back() != ']') fail("unterminated section header");
+            const std::string sec = trim(line.substr(1, line.size() - 2));
+            if (sec == "defaults") { cur = &defaults; continue; }
+            if (sec.rfind("run", 0) != 0 || sec.size() < 5 || !std::isspace(static_cast<unsigned char>(sec[3])))
+                fail("expected [defaults] or [run <name>]");
+            runs.emplace_back(trim(sec.substr(4)), defaults);
+            cur = &runs.back().second;
+            continue;
+        }
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) fail("expected key = value");
+        if (!cur) fail("key outside of a section");
+        KeyValue kv{trim(line.substr(0, eq)), trim(line.substr(eq + 1)), ln};
+        // la chiave della run sostituisce il default (anche uno sweep)
+        auto it = std::find_if(cur->begin(), cur->end(), [&](const KeyValue& o){ return o.key == kv.key; });
+        if (it != cur->end()) *it = std::move(kv);
+        else cur->push_back(std::move(kv));
+    }
+
+    std::vector<RunSpec> out;
+    for (const auto& [name, kvs] : runs) expand_run(path, name, kvs, out);
+
+    std::vector<std::string> names;
+    for (const auto& r : out) names.push_back(r.name);
+    std::sort(names.begin(), names.end());
+    const auto dup = std::adjacent_find(names.begin(), names.end());
+    if (dup != names.end()) throw std::runtime_error(path + ": duplicate run name '" + *dup + "'");
+    return out;
+}
+
+// ------------------------- stadi comuni -------------------------
+namespace {
+
+// load + eventuale ricampionamento tick -> barre
+PriceTable load_run_table(const RunSpec& s){
+    auto tbl = load_and_process_price_data_csv(
+        s.csv_path, s.time_col, s.bid_ask_cols, s.mid_cols, s.ticks, s.convs, s.start_date, s.end_date);
+    if (tbl.empty()) throw std::runtime_error("no rows loaded from " + s.csv_path);
+    if (s.bar_seconds > 0){
+        ResampleConfig rc;
+        rc.bar_seconds = s.bar_seconds;
+        tbl = resample_ticks(tbl, rc).bars;
+    }
+    return tbl;
+}
+
+// dt dell'OU: 30 min sulle barre del file, misurato sulle barre ricampionate
+double ou_dt_years(const RunSpec& s, const PriceTable& clean_IS){
+    if (s.bar_seconds <= 0) return (0.5/24.0)/365.0;
+    const double dt = measure_dt_years(clean_IS);
+    return dt > 0.0 ? dt : static_cast<double>(s.bar_seconds) / (365.0 * 86400.0);
+}
+
+} // anon
+
+// ------------------------- calibrazione singola -------------------------
+RunCalibration calibrate_run(const RunSpec& s)
+{
+    RunCalibration K;
+    PriceTable IS, OS;
+    {
+        const PriceTable tbl = load_run_table(s);
+        std::tie(IS, OS) = trim_and_split_price_table(tbl, s.IS_hours[0], s.IS_hours[1],
+            s.OS_exclude_hours[0], s.OS_exclude_hours[1], s.split_months);
+        K.C = avg_log_cost(trim_and_split_price_table(tbl, s.cost_hours[0], s.cost_hours[1],
+            s.OS_exclude_hours[0], s.OS_exclude_hours[1], s.split_months).first);
+    }
+    K.clean_OS = remove_outliers(OS).clean;
+    {
+        const PriceTable clean_IS = remove_outliers(IS).clean;
+        K.ou = stats::ou_bootstrap(clean_IS, s.M_boot, s.alpha_CI, s.seed, ou_dt_years(s, clean_IS));
+    }
+    K.bands = optimal_trading_bands(s.M_opt, s.l_bt, s.f_bt, K.ou.k, K.ou.sigma, K.C, s.alpha, s.grid);
+
+    K.cfg.k_hat     = K.ou.k;
+    K.cfg.eta_hat   = K.ou.eta;
+    K.cfg.sigma_hat = K.ou.sigma;
+    K.cfg.d = -std::abs(K.bands.d_estimated);
+    K.cfg.u =  std::abs(K.bands.u_estimated);
+    K.cfg.l = s.l_bt;
+    K.cfg.f = s.f_bt;
+    K.cfg.symmetric = s.symmetric;
+    return K;
+}
+
+// ------------------------- batch -------------------------
+BatchReport run_batch(const std::vector<RunSpec>& specs, const BatchOptions& opt)
+{
+    BatchReport R;
+    R.runs.resize(specs.size());
+    if (specs.empty()) return R;
+
+    const unsigned T = resolve_threads(opt.n_threads);
+    const size_t W = opt.max_live_inputs ? opt.max_live_inputs : T;
+    StageCache* cache = (opt.cache && opt.cache->enabled()) ? opt.cache : nullptr;
+
+    // cache su disco: stessa chiave di piano, ma radicata nel contenuto del CSV
+    auto cached = [cache](const char* stage, const CacheKey& k, auto&& compute){
+        using V = std::decay_t<decltype(compute())>;
+        if (!cache) return compute();
+        return cache->get_or_compute<V>(stage, [&](Hasher& h){ h.add(k); }, compute);
+    };
+
+    StageTable<PriceTable>                          loads;
+    StageTable<std::pair<PriceTable, PriceTable>>   splits;
+    StageTable<OutlierResult>                       cleans;
+    StageTable<stats::OUBootstrapResult>            boots;
+    StageTable<double>                              costs;
+    StageTable<OptimalBandsResult>                  bands;
+    StageTable<BacktestResult>                      backtests;
+    StageTable<TradeBootstrapResult>                tboots;
+
+    TaskGraph g;
+    std::map<std::string, CacheKey> file_keys;
+
+    // un nodo nuovo per chiave; gli input contano un consumatore in più
+    auto node = [&](auto& table, const CacheKey& k, const char* name, std::vector<SlotBase*> in,
+                    auto make_fn) -> auto& {
+        ++R.stages_requested;
+        if (auto* s = table.find(k)) return *s;
+        auto& s = table.insert(k);
+        std::vector<TaskGraph::NodeId> deps;
+        for (auto* x : in) { ++x->uses; deps.push_back(x->node); }
+        s.node = g.add(name, make_fn(s, std::move(in)), deps);
+        return s;
+    };
+
+    // gruppi di run per file di input, nell'ordine di prima apparizione
+    std::vector<std::pair<CacheKey, std::vector<size_t>>> groups;
+    std::vector<CacheKey> load_key(specs.size());
+    for (size_t i=0; i<specs.size(); ++i){
+        const auto& s = specs[i];
+        Hasher h;
+        h.add(s.csv_path).add(s.time_col).add(s.bid_ask_cols).add(s.mid_cols)
+         .add(s.ticks).add(s.convs).add(s.start_date).add(s.end_date).add(s.bar_seconds);
+        if (cache){
+            auto it = file_keys.find(s.csv_path);
+            if (it == file_keys.end()) it = file_keys.emplace(s.csv_path, Hasher().add_file(s.csv_path).key()).first;
+            h.add(it->second);
+        }
+        load_key[i] = h.key();
+        auto gi = std::find_if(groups.begin(), groups.end(),
+                               [&](const auto& gr){ return gr.first == load_key[i]; });
+        if (gi == groups.end()) groups.push_back({load_key[i], {i}});
+        else gi->second.push_back(i);
+    }
+
+    std::vector<std::vector<TaskGraph::NodeId>> group_done(groups.size());
+
+    for (size_t gi=0; gi<groups.size(); ++gi){
+        const auto& [lk, members] = groups[gi];
+        const RunSpec& first = specs[members.front()];
+
+        /// LOAD: al massimo W gruppi in volo, il successivo aspetta la fine del gruppo gi-W
+        auto& load = loads.insert(lk);
+        R.stages_requested += members.size();
+        {
+            std::vector<TaskGraph::NodeId> wait;
+            if (gi >= W) wait = group_done[gi - W];
+            load.node = g.add("load", [&load, &first, cached, lk]{
+                run_stage(load, {}, [&]{
+                    return cached("batch_load", lk, [&]{ return load_run_table(first); });
+                });
+            }, wait);
+        }
+
+        for (size_t ri : members){
+            const RunSpec& s = specs[ri];
+
+            /// TRIM & SPLIT (finestra IS e finestra del costo: un solo nodo se coincidono)
+            auto split = [&](const CacheKey& k, std::array<double,2> hours) -> Slot<std::pair<PriceTable, PriceTable>>& {
+                return node(splits, k, "split", {&load}, [&](auto& out, std::vector<SlotBase*> in){
+                    return [&out, in, src = &load, &s, hours, k, cached]{
+                        run_stage(out, in, [&]{
+                            return cached("batch_split", k, [&]{
+                                return trim_and_split_price_table(src->value, hours[0], hours[1],
+                                    s.OS_exclude_hours[0], s.OS_exclude_hours[1], s.split_months);
+                            });
+                        });
+                    };
+                });
+            };
+            const CacheKey k_sp_IS   = Hasher().add(lk).add(s.IS_hours).add(s.OS_exclude_hours).add(s.split_months).key();
+            const CacheKey k_sp_cost = Hasher().add(lk).add(s.cost_hours).add(s.OS_exclude_hours).add(s.split_months).key();
+            auto& sp_IS   = split(k_sp_IS, s.IS_hours);
+            auto& sp_cost = split(k_sp_cost, s.cost_hours);
+
+            /// OUTLIERS (0 = IS, 1 = OS)
+            auto clean = [&](const CacheKey& k, int side) -> Slot<OutlierResult>& {
+                return node(cleans, k, "clean", {&sp_IS}, [&](auto& out, std::vector<SlotBase*> in){
+                    return [&out, in, src = &sp_IS, side, k, cached]{
+                        run_stage(out, in, [&]{
+                            return cached("batch_clean", k, [&]{
+                                return remove_outliers(side == 0 ? src->value.first : src->value.second);
+                            });
+                        });
+                    };
+                });
+            };
+            const CacheKey k_cl_IS = Hasher().add(k_sp_IS).add(0).key();
+            const CacheKey k_cl_OS = Hasher().add(k_sp_IS).add(1).key();
+            auto& cl_IS = clean(k_cl_IS, 0);
+            auto& cl_OS = clean(k_cl_OS, 1);
+
+            /// BOOTSTRAP OU
+            const CacheKey k_boot = Hasher().add(k_cl_IS).add(s.M_boot).add(s.alpha_CI).add(s.seed).key();
+            auto& boot = node(boots, k_boot, "ou_boot", {&cl_IS}, [&](auto& out, std::vector<SlotBase*> in){
+                return [&out, in, src = &cl_IS, &s, k = k_boot, cached]{
+                    run_stage(out, in, [&]{
+                        return cached("batch_ou_boot", k, [&]{
+                            return stats::ou_bootstrap(src->value.clean, s.M_boot, s.alpha_CI, s.seed,
+                                                       ou_dt_years(s, src->value.clean));
+                        });
+                    });
+                };
+            });
+
+            /// COSTO DI TRANSAZIONE MEDIO (IS grezzo, finestra cost_hours)
+            const CacheKey k_cost = Hasher().add(k_sp_cost).add("cost").key();
+            auto& cost = node(costs, k_cost, "transaction_cost", {&sp_cost}, [&](auto& out, std::vector<SlotBase*> in){
+                return [&out, in, src = &sp_cost, k = k_cost, cached]{
+                    run_stage(out, in, [&]{
+                        return cached("batch_cost_v2", k, [&]{
+                            return avg_log_cost(src->value.first);
+                        });
+                    });
+                };
+            });
+
+            /// OPTIMAL BANDS: celle l x f + quella del backtest (condivisa se coincide)
+            auto band_key = [&](double l, double f){
+                return Hasher().add(k_boot).add(k_cost).add(l).add(f).add(s.M_opt).add(s.alpha).add(s.grid).key();
+            };
+            auto band = [&](double l, double f) -> Slot<OptimalBandsResult>& {
+                const CacheKey k = band_key(l, f);
+                return node(bands, k, "bands_cell", {&boot, &cost}, [&](auto& out, std::vector<SlotBase*> in){
+                    return [&out, in, b = &boot, c = &cost, &s, l, f, k, cached]{
+                        run_stage(out, in, [&]{
+                            return cached("batch_bands", k, [&]{
+                                return optimal_trading_bands(s.M_opt, l, f, b->value.k, b->value.sigma,
+                                                             c->value, s.alpha, s.grid);
+                            });
+                        });
+                    };
+                });
+            };
+            std::vector<SlotBase*> cells;
+            for (double l : s.l_list)
+                for (double f : s.f_list) cells.push_back(&band(l, f));
+            auto& band_bt = band(s.l_bt, s.f_bt);
+            const CacheKey k_band_bt = band_key(s.l_bt, s.f_bt);
+
+            /// BACKTEST OS
+            const CacheKey k_bt = Hasher().add(k_band_bt).add(k_cl_OS).add(s.l_bt).add(s.f_bt).add(s.symmetric).key();
+            auto& bt = node(backtests, k_bt, "backtest", {&band_bt, &boot, &cl_OS}, [&](auto& out, std::vector<SlotBase*> in){
+                return [&out, in, bb = &band_bt, b = &boot, os = &cl_OS, &s, k = k_bt, cached]{
+                    run_stage(out, in, [&]{
+                        return cached("batch_backtest", k, [&]{
+                            BacktestConfig cfg;
+                            cfg.k_hat     = b->value.k;
+                            cfg.eta_hat   = b->value.eta;
+                            cfg.sigma_hat = b->value.sigma;
+                            cfg.d = -std::abs(bb->value.d_estimated);
+                            cfg.u =  std::abs(bb->value.u_estimated);
+                            cfg.l = s.l_bt;
+                            cfg.f = s.f_bt;
+                            cfg.symmetric = s.symmetric;
+                            return backtest_os(os->value.clean, cfg);
+                        });
+                    });
+                };
+            });
+
+            // ---- CI delle metriche (un thread: il parallelismo è tra le run) ----
+            const CacheKey k_tb = Hasher().add(k_bt).add(s.trade_resamples).key();
+            auto& tboot = node(tboots, k_tb, "trade_boot", {&bt}, [&](auto& out, std::vector<SlotBase*> in){
+                return [&out, in, src = &bt, &s, k = k_tb, cached]{
+                    run_stage(out, in, [&]{
+                        return cached("batch_trade_boot", k, [&]{
+                            TradeBootstrapConfig tb;
+                            tb.n_resamples = s.trade_resamples;
+                            tb.scheme      = ResampleScheme::IID;
+                            tb.alpha       = 0.05;
+                            tb.n_threads   = 1;
+                            return bootstrap_trade_metrics(src->value, tb);
+                        });
+                    });
+                };
+            });
+
+            /// RACCOLTA + FILE della run
+            std::vector<SlotBase*> in = {&boot, &cost, &band_bt, &bt, &tboot, &cl_OS};
+            in.insert(in.end(), cells.begin(), cells.end());
+            std::vector<TaskGraph::NodeId> deps;
+            for (auto* x : in) { ++x->uses; deps.push_back(x->node); }
+            RunOutcome& O = R.runs[ri];
+            O.name = s.name;
+            group_done[gi].push_back(g.add("run_outputs",
+                [&O, &s, in, cells, b = &boot, c = &cost, bb = &band_bt, t = &bt, tb = &tboot, os = &cl_OS,
+                 write = opt.write_outputs]{
+                    for (auto* x : in) if (!x->error.empty()) { O.error = x->error; break; }
+                    if (O.error.empty()){
+                        O.ou = b->value;
+                        O.ou.boot_k.clear(); O.ou.boot_eta.clear(); O.ou.boot_sigma.clear();
+                        O.C = c->value;
+                        for (auto* x : cells) O.bands.push_back(static_cast<Slot<OptimalBandsResult>*>(x)->value);
+                        O.bands_bt = bb->value;
+                        O.metrics  = t->value.metrics;
+                        O.trade_ci = tb->value;
+                        O.ok = true;
+                        if (write && !write_run_outputs(s, O, os->value.clean, t->value)){
+                            O.ok = false;
+                            O.error = "cannot write outputs to " + s.output_dir;
+                        }
+                    }
+                    for (auto* x : in) x->release();
+                }, deps));
+        }
+    }
+
+    R.stages_executed = loads.size() + splits.size() + cleans.size() + boots.size() + costs.size()
+                      + bands.size() + backtests.size() + tboots.size();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(T);
+        g.run(pool);
+    }
+    R.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    for (const auto& o : R.runs) if (!o.ok) ++R.n_failed;
+    R.runs_per_hour = R.wall_s > 0.0 ? 3600.0 * static_cast<double>(specs.size()) / R.wall_s : 0.0;
+    return R;
+}
+
+// ------------------------- output -------------------------
+bool write_run_outputs(const RunSpec& spec, const RunOutcome& out,
+                       const PriceTable& clean_OS, const BacktestResult& bt)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(spec.output_dir, ec);
+    if (ec) return false;
+    const std::string dir = spec.output_dir + "/";
+
+    std::vector<BandsRow> rows;
+    rows.reserve(out.bands.size());
+    for (size_t il=0; il<spec.l_list.size(); ++il)
+        for (size_t jf=0; jf<spec.f_list.size(); ++jf)
+            rows.push_back({spec.l_list[il], f_label(spec.f_list[jf]), out.bands[il * spec.f_list.size() + jf]});
+
+    bool ok = write_bands_csv(dir + "optimal_bands_results.csv", rows);
+    ok = write_trades_csv(dir + "os_trades.csv", bt, clean_OS) && ok;
+    ok = write_equity_csv(dir + "os_equity.csv", bt, clean_OS) && ok;
+    return ok;
+}
+
+bool write_batch_summary(const std::string& path, const BatchReport& R){
+    const auto dir = std::filesystem::path(path).parent_path();
+    std::error_code ec;
+    if (!dir.empty()) std::filesystem::create_directories(dir, ec);
+
+    const auto F6 = ColFmt::Fixed;
+    CsvWriter w(path, {
+        {"run", ColFmt::Text}, {"ok", ColFmt::Int}, {"error", ColFmt::Text},
+        {"k"}, {"eta"}, {"sigma"}, {"C"},
+        {"d_bt", F6}, {"u_bt", F6},
+        {"trades", ColFmt::Int}, {"hit_ratio"}, {"sum_pnl"}, {"max_dd"},
+        {"sharpe_bar"}, {"sharpe_CI_low"}, {"sharpe_CI_high"}
+    });
+    if (!w.is_open()) return false;
+    for (const auto& o : R.runs){
+        std::string err = o.error;
+        std::replace(err.begin(), err.end(), ',', ';');     // niente quoting nel writer
+        w.add(o.name).add(o.ok ? 1 : 0).add(err)
+         .add(o.ou.k).add(o.ou.eta).add(o.ou.sigma).add(o.C)
+         .add(o.bands_bt.d_estimated).add(o.bands_bt.u_estimated)
+         .add(o.metrics.n_trades).add(o.metrics.hit_ratio).add(o.metrics.sum_pnl).add(o.metrics.max_dd)
+         .add(o.trade_ci.sharpe_bar.point).add(o.trade_ci.sharpe_bar.lo).add(o.trade_ci.sharpe_bar.hi);
+        w.end_row();
+    }
+    return w.close();
+}
+
+} // namespace util
@@ -0,0 +1,312 @@
+#include "utilities/CompactPrices.hpp"
+#include "utilities/Arena.hpp"
+#include "utilities/Loaders.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <memory_resource>
+#include <numeric>
+#include <stdexcept>
+
+namespace util {
+
+namespace {
+
+double hour_of(std::int64_t ts){
+    const std::int64_t s = ((ts % 86400) + 86400) % 86400;
+    return double(s) / 3600.0;                      // = extract_decimal_hour sull'ISO
+}
+
+// percentile semplice (p in [0,1]) come remove_outliers; si ordina la copia sull'arena
+template <class Vec>
+double percentile(const Vec& src, double p){
+    if (src.empty()) return NAN;
+    ScratchScope scratch;
+    std::pmr::vector<double> v(src.begin(), src.end(), scratch.resource());
+    std::sort(v.begin(), v.end());
+    double idx = p * (v.size()-1);
+    size_t i = static_cast<size_t>(std::floor(idx));
+    size_t j = static_cast<size_t>(std::ceil(idx));
+    if (i==j) return v[i];
+    double w = idx - i;
+    return (1.0 - w)*v[i] + w*v[j];
+}
+
+} // anon
+
+PriceStorage parse_price_storage(const std::string& s){
+    if (s == "f32")   return PriceStorage::Float32;
+    if (s == "ticks") return PriceStorage::Ticks32;
+    throw std::invalid_argument("price storage: expected f32 or ticks, got '" + s + "'");
+}
+
+const char* price_storage_name(PriceStorage m){
+    return m == PriceStorage::Float32 ? "f32" : "ticks";
+}
+
+// ---------------------------- tabella ----------------------------
+
+CompactPriceTable::CompactPriceTable(PriceStorage mode, std::array<double,2> tick)
+    : mode_(mode), tick_(tick)
+{
+    if (mode_ == PriceStorage::Ticks32){
+        if (!(tick_[0] > 0.0) || !(tick_[1] > 0.0))
+            throw std::invalid_argument("Ticks32 storage needs a tick size > 0 on both legs");
+        q_ = {tick_[0] / 2.0, tick_[1] / 2.0};
+    }
+}
+
+CompactPriceTable CompactPriceTable::from(const PriceTable& T, PriceStorage mode,
+                                          std::array<double,2> tick){
+    CompactPriceTable C(mode, tick);
+    C.reserve(T.size());
+    for (const auto& r : T) C.push_back(r);
+    return C;
+}
+
+void CompactPriceTable::reserve(size_t n){
+    ts_.reserve(n);
+    rt_.reserve(n);
+    for (auto& c : px_) c.reserve(n);
+}
+
+std::uint32_t CompactPriceTable::enc(int c, double p) const {
+    if (mode_ == PriceStorage::Float32) return std::bit_cast<std::uint32_t>(float(p));
+    const double n = std::nearbyint(p / q_[c < 3 ? 0 : 1]);
+    if (!(n >= double(INT32_MIN) && n <= double(INT32_MAX)))
+        throw std::out_of_range("Ticks32 storage: price " + std::to_string(p) + " outside int32 half-ticks");
+    return std::uint32_t(std::int32_t(n));
+}
+
+void CompactPriceTable::push_back(std::int64_t ts, double bid1, double ask1, double mid1,
+                                  double bid2, double ask2, double mid2){
+    // codifica tutto prima di toccare le colonne: un'eccezione lascia la tabella intatta
+    const std::uint32_t v[6] = {enc(0, bid1), enc(1, ask1), enc(2, mid1),
+                                enc(3, bid2), enc(4, ask2), enc(5, mid2)};
+    ts_.push_back(ts);
+    rt_.push_back((mid1 > 0.0 && mid2 > 0.0) ? std::log(mid1 / mid2) : 0.0);   // come il loader
+    for (int c=0; c<6; ++c) px_[c].push_back(v[c]);
+}
+
+void CompactPriceTable::push_back(const PriceRow& r){
+    const std::int64_t ts = iso_to_epoch_seconds(r.Time);
+    if (ts == INT64_MIN) throw std::invalid_argument("CompactPriceTable: bad Time '" + r.Time + "'");
+    const std::uint32_t v[6] = {enc(0, r.Bid1), enc(1, r.Ask1), enc(2, r.Mid1),
+                                enc(3, r.Bid2), enc(4, r.Ask2), enc(5, r.Mid2)};
+    ts_.push_back(ts);
+    rt_.push_back(r.Rt);
+    for (int c=0; c<6; ++c) px_[c].push_back(v[c]);
+}
+
+void CompactPriceTable::append(const CompactPriceTable& src, size_t i){
+    ts_.push_back(src.ts_[i]);
+    rt_.push_back(src.rt_[i]);
+    for (int c=0; c<6; ++c) px_[c].push_back(src.px_[c][i]);
+}
+
+PriceRow CompactPriceTable::row(size_t i) const {
+    PriceRow r;
+    r.Time = epoch_seconds_to_iso(ts_[i]);
+    r.Bid1 = bid1(i); r.Ask1 = ask1(i); r.Mid1 = mid1(i);
+    r.Bid2 = bid2(i); r.Ask2 = ask2(i); r.Mid2 = mid2(i);
+    r.Rt = rt(i);
+    return r;
+}
+
+PriceTable CompactPriceTable::to_table() const {
+    PriceTable T;
+    T.reserve(size());
+    for (size_t i=0; i<size(); ++i) T.push_back(row(i));
+    return T;
+}
+
+CompactPriceTable CompactPriceTable::select(const std::vector<bool>& keep) const {
+    CompactPriceTable C(mode_, tick_);
+    const size_t n = std::min(keep.size(), size());
+    C.reserve(size_t(std::count(keep.begin(), keep.begin() + n, true)));
+    for (size_t i=0; i<n; ++i) if (keep[i]) C.append(*this, i);
+    return C;
+}
+
+// ---------------------------- stadi ----------------------------
+
+CompactPriceTable load_compact_price_data(const RunSpec& spec, PriceStorage mode, size_t* bad_time){
+    trace::Scope trace_scope("load_compact");
+    std::array<double,2> tick{0.0, 0.0};
+    if (mode == PriceStorage::Ticks32){
+        if (!spec.ticks) throw std::runtime_error("ticks storage needs 'ticks' in the run spec");
+        tick = {(*spec.ticks)[0] * spec.convs[0], (*spec.ticks)[1] * spec.convs[1]};
+    }
+    CompactPriceTable T(mode, tick);
+    size_t bad = 0;
+    stream_price_data_csv(spec.csv_path, spec.time_col, spec.bid_ask_cols, spec.mid_cols,
+                          spec.ticks, spec.convs, spec.start_date, spec.end_date,
+                          [&](PriceRow& r){
+                              const std::int64_t ts = iso_to_epoch_seconds(r.Time);
+                              if (ts == INT64_MIN) { ++bad; return true; }
+                              T.push_back(ts, r.Bid1, r.Ask1, r.Mid1, r.Bid2, r.Ask2, r.Mid2);
+                              return true;
+                          });
+    if (bad_time) *bad_time = bad;
+    return T;
+}
+
+std::pair<CompactPriceTable, CompactPriceTable> trim_and_split_price_table(
+    const CompactPriceTable& data,
+    std::array<double,2> IS_hours,
+    std::array<double,2> OS_exclude_hours,
+    int split_months)
+{
+    trace::Scope trace_scope("trim_and_split");
+    if (data.empty()) return {CompactPriceTable(data.storage(), data.tick()),
+                              CompactPriceTable(data.storage(), data.tick())};
+
+    ScratchScope scratch;
+    std::pmr::vector<size_t> idx(data.size(), scratch.resource());
+    std::iota(idx.begin(), idx.end(), size_t{0});
+    std::stable_sort(idx.begin(), idx.end(), [&](size_t a, size_t b){ return data.ts(a) < data.ts(b); });
+
+    // stesso criterio di split_price_table_by_months
+    const std::int64_t split_ts = iso_to_epoch_seconds(
+        add_months_iso(epoch_seconds_to_iso(data.ts(idx.front())), split_months));
+
+    auto in_window = [](double h, double a, double b){ return (h >= a) && (h <= b); };
+    std::vector<bool> to_IS(data.size(), false), to_OS(data.size(), false);
+    bool sorted = true;
+    for (size_t k=0; k<idx.size(); ++k){
+        const size_t i = idx[k];
+        sorted = sorted && i == k;
+        const double h = hour_of(data.ts(i));
+        if (data.ts(i) < split_ts) to_IS[i] = in_window(h, IS_hours[0], IS_hours[1]);
+        // tieni solo FUORI dalla finestra esclusa
+        else to_OS[i] = (h <= OS_exclude_hours[0] || h >= OS_exclude_hours[1]);
+    }
+    if (sorted) return {data.select(to_IS), data.select(to_OS)};
+
+    // file non ordinato: righe copiate nell'ordine di idx
+    std::pair<CompactPriceTable, CompactPriceTable> out{CompactPriceTable(data.storage(), data.tick()),
+                                                        CompactPriceTable(data.storage(), data.tick())};
+    for (size_t i : idx){
+        if      (to_IS[i]) out.first.append(data, i);
+        else if (to_OS[i]) out.second.append(data, i);
+    }
+    return out;
+}
+
+CompactOutlierResult remove_outliers(const CompactPriceTable& data){
+    trace::Scope trace_scope("remove_outliers");
+    CompactOutlierResult R{CompactPriceTable(data.storage(), data.tick()), {}};
+    R.is_outlier.assign(data.size(), false);
+    if (data.empty()) return R;
+
+    ScratchScope scratch;
+    auto* res = scratch.resource();
+
+    // Step 1: log-spread IQR sulla colonna Rt (double, contigua)
+    const std::span<const double> Rt = data.rt_column();
+    std::pmr::vector<size_t> c1(res);
+    {
+        double Q1 = percentile(Rt, 0.25);
+        double Q3 = percentile(Rt, 0.75);
+        double IQR = Q3 - Q1;
+        double lo  = Q1 - 3.0 * IQR;
+        double hi  = Q3 + 3.0 * IQR;
+        c1.reserve(data.size());
+        for (size_t i=0; i<data.size(); ++i){
+            if ((Rt[i] < lo) || (Rt[i] > hi)) R.is_outlier[i] = true;
+            else c1.push_back(i);
+        }
+    }
+
+    // Step 2: antipersistent sui sopravvissuti, IQR ricalcolato su di loro
+    if (c1.size() >= 3){
+        std::pmr::vector<double> x(res);
+        x.reserve(c1.size());
+        for (size_t i : c1) x.push_back(Rt[i]);
+        double Q1 = percentile(x, 0.25);
+        double Q3 = percentile(x, 0.75);
+        double IQR = Q3 - Q1;
+        for (size_t t=1; t+1<c1.size(); ++t){
+            double delta_prev = std::fabs(x[t] - x[t-1]);
+            double delta_next = std::fabs(x[t+1] - x[t]);
+            if (delta_prev > IQR && delta_next > 0.95 * IQR) R.is_outlier[c1[t]] = true;
+        }
+    }
+
+    std::vector<bool> keep(data.size());
+    for (size_t i=0; i<data.size(); ++i) keep[i] = !R.is_outlier[i];
+    R.clean = data.select(keep);
+    return R;
+}
+
+double avg_log_cost(const PriceTable& data, size_t* n_used){
+    double sum = 0.0;
+    size_t n = 0;
+    for (const auto& r : data){
+        const double ct = log_cost(r.Bid1, r.Ask1, r.Bid2, r.Ask2);
+        if (std::isfinite(ct)) { sum += ct; ++n; }
+    }
+    if (n_used) *n_used = n;
+    return n ? sum / static_cast<double>(n) : 0.0;
+}
+
+double avg_log_cost(const CompactPriceTable& data, size_t* n_used){
+    double sum = 0.0;
+    size_t n = 0;
+    for (size_t i=0; i<data.size(); ++i){
+        const double ct = log_cost(data.bid1(i), data.ask1(i), data.bid2(i), data.ask2(i));
+        if (std::isfinite(ct)) { sum += ct; ++n; }
+    }
+    if (n_used) *n_used = n;
+    return n ? sum / static_cast<double>(n) : 0.0;
+}
+
+CompactRunResult run_compact(const RunSpec& spec, PriceStorage mode){
+    if (spec.bar_seconds > 0) throw std::runtime_error("bar resampling is not supported by --compact (use --batch)");
+    const auto t0 = std::chrono::steady_clock::now();
+    CompactRunResult R;
+
+    CompactPriceTable raw = load_compact_price_data(spec, mode, &R.bad_time);
+    R.rows = raw.size();
+    R.table_bytes = raw.bytes();
+    if (raw.empty()) throw std::runtime_error("no rows loaded from " + spec.csv_path);
+
+    // costo C sull'IS grezzo (finestra cost_hours), come run_batch
+    R.C = avg_log_cost(trim_and_split_price_table(raw, spec.cost_hours, spec.OS_exclude_hours,
+                                                  spec.split_months).first);
+    auto [IS, OS] = trim_and_split_price_table(raw, spec.IS_hours, spec.OS_exclude_hours, spec.split_months);
+    raw = CompactPriceTable(mode, raw.tick());                 // libera le colonne grezze
+    R.IS_rows = IS.size();
+    R.OS_rows = OS.size();
+
+    const CompactPriceTable clean_IS = remove_outliers(IS).clean;
+    const CompactPriceTable clean_OS = remove_outliers(OS).clean;
+    R.IS_clean = clean_IS.size();
+    R.OS_clean = clean_OS.size();
+
+    R.ou = stats::ou_bootstrap(clean_IS, spec.M_boot, spec.alpha_CI, spec.seed);
+    R.ou.boot_k.clear(); R.ou.boot_eta.clear(); R.ou.boot_sigma.clear();
+    if (!(R.ou.k > 0.0) || !std::isfinite(R.ou.sigma))
+        throw std::runtime_error("OU calibration failed");
+
+    R.bands = optimal_trading_bands(spec.M_opt, spec.l_bt, spec.f_bt, R.ou.k, R.ou.sigma,
+                                    R.C, spec.alpha, spec.grid);
+    BacktestConfig bc;
+    bc.k_hat     = R.ou.k;
+    bc.eta_hat   = R.ou.eta;
+    bc.sigma_hat = R.ou.sigma;
+    bc.d = -std::abs(R.bands.d_estimated);
+    bc.u =  std::abs(R.bands.u_estimated);
+    bc.l = spec.l_bt;
+    bc.f = spec.f_bt;
+    bc.symmetric = spec.symmetric;
+    bc.record = RecordMode::MetricsOnly;
+    R.metrics = backtest_os(clean_OS, bc).metrics;
+
+    R.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return R;
+}
+
+} // namespace util
@@ -1,9 +1,15 @@
 #include "utilities/DataOrdering.hpp"
+#include "utilities/Trace.hpp"
+#include "utilities/Arena.hpp"
 #include <cmath>
 #include <algorithm>
+#include <memory_resource>
+#include <numeric>
 #include <stdexcept>
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
+#include <climits>
 
 namespace util {
 
@@ -15,6 +21,20 @@ static bool parse_iso(const std::string& s, std::tm& tm_out){
 }
 
 double extract_decimal_hour(const std::string& iso_time){
+    // percorso rapido per "YYYY-MM-DD HH:MM:SS" esatto (il formato del loader), senza stream;
+    // il resto (e i valori fuori range) passa da get_time come prima
+    const std::string& s = iso_time;
+    if (s.size() == 19 && s[4]=='-' && s[7]=='-' && s[10]==' ' && s[13]==':' && s[16]==':'){
+        bool digits = true;
+        for (size_t p : {0,1,2,3,5,6,8,9,11,12,14,15,17,18})
+            digits = digits && s[p] >= '0' && s[p] <= '9';
+        auto d2 = [&](size_t p){ return (s[p]-'0')*10 + (s[p+1]-'0'); };
+        if (digits){
+            const int mo = d2(5), d = d2(8), H = d2(11), M = d2(14), S = d2(17);
+            if (mo >= 1 && mo <= 12 && d >= 1 && d <= 31 && H <= 23 && M <= 59 && S <= 59)
+                return double(H) + double(M)/60.0 + double(S)/3600.0;
+        }
+    }
     std::tm tm{};
     if (!parse_iso(iso_time, tm)) return NAN;
     return double(tm.tm_hour) + double(tm.tm_min)/60.0 + double(tm.tm_sec)/3600.0;
@@ -61,6 +81,67 @@ bool iso_less(const std::string& a, const std::string& b){
     return a < b;
 }
 
+// giorni dal 1970-01-01 (calendario gregoriano prolettico)
+static std::int64_t days_from_civil(int y, unsigned m, unsigned d){
+    y -= (m <= 2);
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+std::int64_t iso_to_epoch_seconds(const std::string& s){
+    // parsing a posizioni fisse, niente stream: chiamato per ogni tick
+    auto dig = [&](size_t pos, size_t len, int& out){
+        if (pos + len > s.size()) return false;
+        int v = 0;
+        for (size_t k=pos; k<pos+len; ++k){
+            const char c = s[k];
+            if (c < '0' || c > '9') return false;
+            v = v*10 + (c - '0');
+        }
+        out = v; return true;
+    };
+    int y, mo, d, H = 0, M = 0, S = 0;
+    if (!dig(0,4,y) || s[4] != '-' || !dig(5,2,mo) || s[7] != '-' || !dig(8,2,d))
+        return INT64_MIN;
+    // "YYYY-MM-DD", "YYYY-MM-DD HH:MM" o "YYYY-MM-DD HH:MM:SS[...]"; altre lunghezze non valide
+    if (s.size() != 10){
+        if (s.size() < 16 || s.size() == 17 || s.size() == 18) return INT64_MIN;
+        if (!dig(11,2,H) || s[13] != ':' || !dig(14,2,M)) return INT64_MIN;
+        if (s.size() >= 19 && (s[16] != ':' || !dig(17,2,S))) return INT64_MIN;
+    }
+    if (mo < 1 || mo > 12 || d < 1 || d > 31) return INT64_MIN;
+    if (H > 23 || M > 59 || S > 60) return INT64_MIN;
+    return days_from_civil(y, static_cast<unsigned>(mo), static_cast<unsigned>(d)) * 86400
+         + H*3600 + M*60 + S;
+}
+
+std::string epoch_seconds_to_iso(std::int64_t t){
+    std::int64_t days = t / 86400;
+    std::int64_t secs = t % 86400;
+    if (secs < 0) { secs += 86400; --days; }
+
+    // inverso di days_from_civil
+    days += 719468;
+    const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    const unsigned doy = doe - (365*yoe + yoe/4 - yoe/100);
+    const unsigned mp  = (5*doy + 2)/153;
+    const unsigned d   = doy - (153*mp + 2)/5 + 1;
+    const unsigned m   = mp < 10 ? mp + 3 : mp - 9;
+    const std::int64_t y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+
+    // anno int64 nel caso peggiore (20 caratteri con segno) + "-MM-DD HH:MM:SS"
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02u %02d:%02d:%02d",
+                  static_cast<long long>(y), m, d,
+                  int(secs/3600), int((secs/60)%60), int(secs%60));
+    return buf;
+}
+
 // ---------------------------
 // Utilità interne
 // ---------------------------
@@ -125,9 +206,12 @@ static void filter_by_date(std::vector<std::string>& t,
     t.swap(t2); a.swap(a2); b.swap(b2); c.swap(c2); d.swap(d2); e.swap(e2); f.swap(f2);
 }
 
-// percentile semplice (p in [0,1])
-static double percentile(std::vector<double> v, double p){
-    if (v.empty()) return NAN;
+// percentile semplice (p in [0,1]); la copia da ordinare sta sull'arena del thread
+template <class Vec>
+static double percentile(const Vec& src, double p){
+    if (src.empty()) return NAN;
+    ScratchScope scratch;
+    std::pmr::vector<double> v(src.begin(), src.end(), scratch.resource());
     std::sort(v.begin(), v.end());
     double idx = p * (v.size()-1);
     size_t i = static_cast<size_t>(std::floor(idx));
@@ -213,7 +297,7 @@ std::pair<PriceTable, PriceTable> split_price_table_by_months(
         if (iso_less(r.Time, split_date)) IS.push_back(r);
         else                              OS.push_back(r);
     }
-    return {IS, OS};
+    return {std::move(IS), std::move(OS)};
 }
 
 std::pair<PriceTable, PriceTable> trim_and_split_price_table(
@@ -223,45 +307,62 @@ std::pair<PriceTable, PriceTable> trim_and_split_price_table(
     std::optional<double> OS_start_hour,
     std::optional<double> OS_end_hour,
     int split_months){
-    // ordina per tempo (le ISO ordinate lessicograficamente bastano)
-    PriceTable sorted = data;
-    std::sort(sorted.begin(), sorted.end(), [](const PriceRow& a, const PriceRow& b){
-        return a.Time < b.Time;
+    trace::Scope trace_scope("trim_and_split");
+    if (data.empty()) return {{},{}};
+
+    // ordina per tempo un vettore di indici (sull'arena) invece di copiare la tabella:
+    // std::sort dipende solo dagli esiti dei confronti, quindi l'ordine è lo stesso;
+    // ogni riga viene poi copiata una sola volta, nella tabella di destinazione
+    ScratchScope scratch;
+    std::pmr::vector<size_t> idx(data.size(), scratch.resource());
+    std::iota(idx.begin(), idx.end(), size_t{0});
+    std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b){
+        return data[a].Time < data[b].Time;
     });
 
-    auto [raw_IS, raw_OS] = split_price_table_by_months(sorted, split_months);
+    // stesso criterio di split_price_table_by_months
+    const std::string split_date = add_months_iso(data[idx.front()].Time, split_months);
 
     auto in_window = [](double h, double a, double b){ return (h >= a) && (h <= b); };
 
-    PriceTable IS = raw_IS;
-    if (IS_start_hour && IS_end_hour){
-        PriceTable tmp; tmp.reserve(IS.size());
-        for (const auto& r : IS){
-            double h = extract_decimal_hour(r.Time);
-            if (in_window(h, *IS_start_hour, *IS_end_hour)) tmp.push_back(r);
+    // 1 = IS, 2 = OS, 0 = scartata dalle finestre orarie
+    std::pmr::vector<unsigned char> dest(idx.size(), 0, scratch.resource());
+    size_t n_IS = 0, n_OS = 0;
+    for (size_t k=0; k<idx.size(); ++k){
+        const auto& r = data[idx[k]];
+        if (iso_less(r.Time, split_date)){
+            if (IS_start_hour && IS_end_hour){
+                double h = extract_decimal_hour(r.Time);
+                if (!in_window(h, *IS_start_hour, *IS_end_hour)) continue;
+            }
+            dest[k] = 1; ++n_IS;
+        } else {
+            if (OS_start_hour && OS_end_hour){
+                double h = extract_decimal_hour(r.Time);
+                // tieni solo FUORI dalla finestra esclusa
+                if (!(h <= *OS_start_hour || h >= *OS_end_hour)) continue;
+            }
+            dest[k] = 2; ++n_OS;
         }
-        IS.swap(tmp);
     }
 
-    PriceTable OS = raw_OS;
-    if (OS_start_hour && OS_end_hour){
-        PriceTable tmp; tmp.reserve(OS.size());
-        for (const auto& r : OS){
-            double h = extract_decimal_hour(r.Time);
-            // tieni solo FUORI dalla finestra esclusa
-            if (h <= *OS_start_hour || h >= *OS_end_hour) tmp.push_back(r);
-        }
-        OS.swap(tmp);
+    PriceTable IS, OS;
+    IS.reserve(n_IS);
+    OS.reserve(n_OS);
+    for (size_t k=0; k<idx.size(); ++k){
+        if      (dest[k] == 1) IS.push_back(data[idx[k]]);
+        else if (dest[k] == 2) OS.push_back(data[idx[k]]);
     }
-
-    return {IS, OS};
+    return {std::move(IS), std::move(OS)};
 }
 
 OutlierResult filter_log_spread_outliers(const PriceTable& data){
     OutlierResult R;
     if (data.empty()) return R;
 
-    std::vector<double> Rt; Rt.reserve(data.size());
+    ScratchScope scratch;
+    std::pmr::vector<double> Rt(scratch.resource());
+    Rt.reserve(data.size());
     for (auto& r : data) Rt.push_back(r.Rt);
 
     double Q1 = percentile(Rt, 0.25);
@@ -285,7 +386,9 @@ OutlierResult filter_antipersistent_outliers(const PriceTable& data){
     if (data.size() < 3) { R.clean = data; R.is_outlier.assign(data.size(), false); return R; }
 
     // IQR per soglie
-    std::vector<double> Rt; Rt.reserve(data.size());
+    ScratchScope scratch;
+    std::pmr::vector<double> Rt(scratch.resource());
+    Rt.reserve(data.size());
     for (auto& r : data) Rt.push_back(r.Rt);
     double Q1 = percentile(Rt, 0.25);
     double Q3 = percentile(Rt, 0.75);
@@ -307,23 +410,54 @@ OutlierResult filter_antipersistent_outliers(const PriceTable& data){
 }
 
 OutlierResult remove_outliers(const PriceTable& data){
-    // Step 1: log-spread IQR
-    auto R1 = filter_log_spread_outliers(data);
-
-    // Step 2: antipersistent sul filtrato
-    auto R2 = filter_antipersistent_outliers(R1.clean);
-
-    // Ricostruzione mask completa come in Python
+    trace::Scope trace_scope("remove_outliers");
+    // Stessi due passi di filter_log_spread_outliers + filter_antipersistent_outliers,
+    // ma su indici nell'arena: niente tabelle intermedie, le righe si copiano solo nel risultato
+    ScratchScope scratch;
+    auto* res = scratch.resource();
     OutlierResult R;
     R.is_outlier.assign(data.size(), false);
+    if (data.empty()) return R;
+
+    // Step 1: log-spread IQR -> indici puliti c1 (= R1.clean)
+    std::pmr::vector<size_t> c1(res);
+    {
+        std::pmr::vector<double> Rt(res);
+        Rt.reserve(data.size());
+        for (auto& r : data) Rt.push_back(r.Rt);
+        double Q1 = percentile(Rt, 0.25);
+        double Q3 = percentile(Rt, 0.75);
+        double IQR = Q3 - Q1;
+        double lo  = Q1 - 3.0 * IQR;
+        double hi  = Q3 + 3.0 * IQR;
+        c1.reserve(data.size());
+        for (size_t i=0;i<data.size();++i)
+            if (!((Rt[i] < lo) || (Rt[i] > hi))) c1.push_back(i);
+    }
+
+    // Step 2: antipersistent sul filtrato -> anti[t] (= R2.is_outlier)
+    std::pmr::vector<unsigned char> anti(c1.size(), 0, res);
+    if (c1.size() >= 3){
+        std::pmr::vector<double> Rt(res);
+        Rt.reserve(c1.size());
+        for (size_t i : c1) Rt.push_back(data[i].Rt);
+        double Q1 = percentile(Rt, 0.25);
+        double Q3 = percentile(Rt, 0.75);
+        double IQR = Q3 - Q1;
+        for (size_t t=1; t+1<c1.size(); ++t){
+            double delta_prev = std::fabs(Rt[t] - Rt[t-1]);
+            double delta_next = std::fabs(Rt[t+1] - Rt[t]);
+            if (delta_prev > IQR && delta_next > 0.95 * IQR) anti[t] = 1;
+        }
+    }
 
     // mark log-spread outlier
     {
         size_t j = 0;
         for (size_t i=0;i<data.size();++i){
             // se non presente in R1.clean → era outlier
-            if (j < R1.clean.size() && data[i].Time == R1.clean[j].Time &&
-                data[i].Rt == R1.clean[j].Rt) {
+            if (j < c1.size() && data[i].Time == data[c1[j]].Time &&
+                data[i].Rt == data[c1[j]].Rt) {
                 ++j;
             } else {
                 // potrebbe essere coincidenza su Time/Rt uguali; in un progetto vero,
@@ -333,36 +467,23 @@ OutlierResult remove_outliers(const PriceTable& data){
         }
     }
 
-    // togliamo falsi positivi segnando “antipersistent” sugli elementi rimasti in clean
-    {
-        // mappa rapida: per ogni elemento di R1.clean, segno se R2 lo ha marcato
-        // costruisco set basato su (Time, Rt)
-        auto key = [](const PriceRow& r){
-            return std::pair<std::string,double>{r.Time, r.Rt};
-        };
-        std::vector<std::pair<std::string,double>> keys_clean;
-        for (auto& r : R1.clean) keys_clean.push_back(key(r));
-
-        std::vector<bool> anti_mask_full(data.size(), false);
-        // marca “anti” per elementi che compaiono in R2.is_outlier
-        for (size_t idx=0; idx<R1.clean.size(); ++idx){
-            if (R2.is_outlier[idx]){
-                // trova nel data l’indice corrispondente
-                for (size_t i=0;i<data.size();++i){
-                    if (data[i].Time == keys_clean[idx].first &&
-                        data[i].Rt   == keys_clean[idx].second){
-                        anti_mask_full[i] = true; break;
-                    }
-                }
-            }
-        }
-
+    // togliamo falsi positivi segnando “antipersistent” sugli elementi rimasti in clean:
+    // per ogni elemento marcato, la prima riga di data con stessi (Time, Rt)
+    for (size_t idx=0; idx<c1.size(); ++idx){
+        if (!anti[idx]) continue;
+        const PriceRow& k = data[c1[idx]];
         for (size_t i=0;i<data.size();++i){
-            if (anti_mask_full[i]) R.is_outlier[i] = true;
+            if (data[i].Time == k.Time && data[i].Rt == k.Rt){
+                R.is_outlier[i] = true; break;
+            }
         }
     }
 
     // costruisci clean & outliers finali
+    size_t n_out = 0;
+    for (size_t i=0;i<data.size();++i) n_out += R.is_outlier[i];
+    R.outliers.reserve(n_out);
+    R.clean.reserve(data.size() - n_out);
     for (size_t i=0;i<data.size();++i){
         if (R.is_outlier[i]) R.outliers.push_back(data[i]);
         else                 R.clean.push_back(data[i]);
@@ -0,0 +1,80 @@
+#include "utilities/KalmanHedge.hpp"
+#include "utilities/Parallel.hpp"
+#include <cmath>
+
+namespace util {
+
+KalmanHedge::KalmanHedge(const KalmanHedgeConfig& cfg)
+    : cfg_(cfg),
+      q_(cfg.delta / (1.0 - cfg.delta)),
+      a_(cfg.alpha0), b_(cfg.beta0),
+      p00_(cfg.p0), p01_(0.0), p11_(cfg.p0)
+{}
+
+KalmanHedge::Step KalmanHedge::update(double y, double x)
+{
+    Step st;
+
+    // predict: stato random walk, P += Q
+    p00_ += q_;
+    p11_ += q_;
+
+    // spread con il beta a priori (causale)
+    st.spread = y - b_ * x;
+
+    // H = [1, x]:  S = H P H' + R,  K = P H' / S
+    const double ph0 = p00_ + p01_ * x;
+    const double ph1 = p01_ + p11_ * x;
+    const double S   = ph0 + ph1 * x + cfg_.obs_var;
+    const double e   = y - (a_ + b_ * x);
+    const double k0  = ph0 / S;
+    const double k1  = ph1 / S;
+
+    a_ += k0 * e;
+    b_ += k1 * e;
+
+    // P = P - K H P  (forma simmetrica: K H P = K (P H')')
+    p00_ -= k0 * ph0;
+    p01_ -= k0 * ph1;
+    p11_ -= k1 * ph1;
+
+    st.alpha = a_;
+    st.beta  = b_;
+    st.innovation = e;
+    st.innovation_var = S;
+    return st;
+}
+
+HedgeSeries apply_kalman_hedge(PriceTable& data, const KalmanHedgeConfig& cfg)
+{
+    HedgeSeries H;
+    H.alpha.resize(data.size());
+    H.beta.resize(data.size());
+
+    KalmanHedge kf(cfg);
+    for (size_t i=0; i<data.size(); ++i){
+        auto& r = data[i];
+        if (r.Mid1 > 0.0 && r.Mid2 > 0.0){
+            const auto st = kf.update(std::log(r.Mid1), std::log(r.Mid2));
+            r.Rt = st.spread;
+        } else {
+            r.Rt = 0.0;
+        }
+        H.alpha[i] = kf.alpha();
+        H.beta[i]  = kf.beta();
+    }
+    return H;
+}
+
+std::vector<HedgeSeries> apply_kalman_hedge(std::vector<PriceTable>& tables,
+                                            const KalmanHedgeConfig& cfg,
+                                            unsigned n_threads)
+{
+    std::vector<HedgeSeries> out(tables.size());
+    parallel_for(tables.size(), n_threads, [&](size_t b, size_t e, unsigned){
+        for (size_t i=b; i<e; ++i) out[i] = apply_kalman_hedge(tables[i], cfg);
+    });
+    return out;
+}
+
+} // namespace util
@@ -0,0 +1,85 @@
+#include "utilities/LatencyHistogram.hpp"
+#include "utilities/ResultWriter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace util {
+
+std::int64_t LatencyHistogram::highest_of(size_t idx){
+    if (idx < size_t(SUB)) return std::int64_t(idx);
+    const size_t o = (idx - size_t(SUB)) / size_t(SUB);
+    const std::uint64_t m = (idx - size_t(SUB)) % size_t(SUB) + std::uint64_t(SUB);
+    // in uint64: nell'ultimo bucket (m+1) << o = 2^63
+    return std::int64_t(((m + 1) << o) - 1);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& o){
+    for (size_t i=0; i<N_BUCKETS; ++i) counts_[i] += o.counts_[i];
+    n_ += o.n_;
+    sum_ += o.sum_;
+    min_ = std::min(min_, o.min_);
+    max_ = std::max(max_, o.max_);
+}
+
+void LatencyHistogram::reset(){
+    counts_.fill(0);
+    n_ = 0;
+    sum_ = 0.0;
+    min_ = INT64_MAX;
+    max_ = 0;
+}
+
+std::int64_t LatencyHistogram::percentile(double p) const {
+    if (n_ == 0) return 0;
+    if (p <= 0.0) return min();
+    const double q = std::min(p, 100.0) / 100.0;
+    const std::uint64_t target = std::max<std::uint64_t>(1, std::uint64_t(std::ceil(q * double(n_))));
+    std::uint64_t cum = 0;
+    for (size_t i=0; i<N_BUCKETS; ++i){
+        cum += counts_[i];
+        if (cum >= target) return std::min(highest_of(i), max_);
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::summary() const {
+    auto us = [](std::int64_t ns){ return double(ns) / 1e3; };
+    char buf[256];
+    std::snprintf(buf, sizeof buf,
+                  "n=%llu  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  p99.99 %.1f  max %.1f  mean %.1f us",
+                  static_cast<unsigned long long>(n_), us(min()), us(percentile(50)), us(percentile(90)),
+                  us(percentile(99)), us(percentile(99.9)), us(percentile(99.99)), us(max()), mean() / 1e3);
+    return buf;
+}
+
+bool LatencyHistogram::write_percentiles_csv(const std::string& path) const {
+    CsvWriter w(path, {{"value_us", ColFmt::Fixed, 3}, {"percentile", ColFmt::Fixed, 6},
+                       {"total_count", ColFmt::Int}, {"one_by_one_minus_p", ColFmt::Fixed, 2}},
+                WriterOptions{1 << 16, 2, false});
+    if (!w.is_open()) return false;
+    if (n_ == 0) return w.close();
+
+    auto row = [&](double q){                // q in [0,1]
+        const std::int64_t v = percentile(q * 100.0);
+        std::uint64_t cum = 0;               // campioni nei bucket fino a quello di v
+        for (size_t i=0, iv=index_of(v); i<=iv; ++i) cum += counts_[i];
+        w.add(double(v) / 1e3).add(q).add(static_cast<std::int64_t>(cum));
+        if (q < 1.0) w.add(1.0 / (1.0 - q)); else w.add(std::numeric_limits<double>::infinity());
+        w.end_row();
+    };
+    // 5 passi per ogni dimezzamento della coda: 0, 10, 20, 30, 40, 50, 55, ... fino a 1/n
+    const int ticks = 5;
+    for (int h=0;; ++h){
+        const double lo = 1.0 - std::ldexp(1.0, -h);
+        const double hi = 1.0 - std::ldexp(1.0, -(h + 1));
+        const int steps = (h == 0) ? 2 * ticks : ticks;
+        for (int s=0; s<steps; ++s) row(lo + (hi - lo) * double(s) / double(steps));
+        if (std::ldexp(1.0, h + 1) > double(n_)) break;
+    }
+    row(1.0);
+    return w.close();
+}
+
+} // namespace util
@@ -1,13 +1,20 @@
 #include "utilities/Loaders.hpp"
+#include "utilities/XlsxReader.hpp"
+#include "utilities/Trace.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
 #include <stdexcept>
+#include <cmath>
+#include <functional>
+#include <cstring>
 
 namespace util {
 
+static trace::Counter c_rows_parsed("rows_parsed");
+
 // --------------------- helpers base ---------------------
 static bool is_space_like(unsigned char c){
     // NBSP (0xA0) + spazi standard
@@ -21,25 +28,52 @@ static std::string trim_spaces(std::string s){
     return s.substr(i, j-i);
 }
 
-static std::vector<std::string> split_with_delim(const std::string& line, char delim){
-    std::vector<std::string> out; out.reserve(64);
-    std::string cur; bool in_quotes=false;
+static void trim_spaces_inplace(std::string& s){
+    size_t j = s.size();
+    while (j>0 && is_space_like((unsigned char)s[j-1])) --j;
+    s.resize(j);
+    size_t i = 0;
+    while (i<s.size() && is_space_like((unsigned char)s[i])) ++i;
+    s.erase(0, i);
+}
+
+// divide line su delim dentro out, riusando le stringhe della riga precedente:
+// a regime nessuna allocazione per riga (prima: due vettori + una stringa per cella)
+static void split_with_delim(const std::string& line, char delim, std::vector<std::string>& out){
+    size_t n = 0;
+    auto next_cell = [&]()->std::string& {
+        if (n == out.size()) out.emplace_back();
+        std::string& c = out[n++];
+        c.clear();
+        return c;
+    };
+    std::string* cur = &next_cell();
+    bool in_quotes=false;
     for(char ch: line){
         if (ch=='"'){ in_quotes=!in_quotes; continue; }
-        if (ch==delim && !in_quotes){ out.push_back(trim_spaces(cur)); cur.clear(); }
-        else cur.push_back(ch);
+        if (ch==delim && !in_quotes){ trim_spaces_inplace(*cur); cur = &next_cell(); }
+        else cur->push_back(ch);
     }
-    out.push_back(trim_spaces(cur));
-    return out;
+    trim_spaces_inplace(*cur);
+    out.resize(n);
 }
 
-static std::vector<std::string> split_auto(const std::string& line){
-    auto a = split_with_delim(line, ',');
-    auto b = split_with_delim(line, ';');
-    if (b.size()>a.size() && b.size()>1) return b;
-    if (a.size()>1) return a;
-    if (b.size()>1) return b;
-    return a;
+// stesso criterio di prima (vince il separatore che dà più celle, ';' a parità solo se ',' non divide),
+// deciso contando i separatori fuori dalle virgolette invece di dividere la riga due volte
+static void split_auto(const std::string& line, std::vector<std::string>& out){
+    size_t na = 1, nb = 1;
+    bool in_quotes=false;
+    for(char ch: line){
+        if (ch=='"'){ in_quotes=!in_quotes; continue; }
+        if (in_quotes) continue;
+        if (ch==',') ++na;
+        else if (ch==';') ++nb;
+    }
+    char delim = ',';
+    if (nb>na && nb>1) delim = ';';
+    else if (na>1)     delim = ',';
+    else if (nb>1)     delim = ';';
+    split_with_delim(line, delim, out);
 }
 
 static void to_upper_inplace(std::string& s){
@@ -112,39 +146,74 @@ static std::string to_iso_datetime_eu(std::string s){
         else { date = s.substr(0, sp); time = trim_spaces(s.substr(sp+1)); }
     }
 
-    int d=0,m=0,y=0;
-    {
-        std::vector<int> parts; parts.reserve(3);
+    // campi numerici: si tengono i primi 3 (array fisso, niente vettori per riga)
+    auto fields = [](const std::string& str, const char* seps, int (&out)[3])->size_t {
+        size_t n = 0;
         std::string cur;
-        for(char c: date){
-            if (c=='/' || c=='-' || c=='.'){ if(!cur.empty()){ parts.push_back(std::stoi(cur)); cur.clear(); } }
+        auto flush = [&]{ if(!cur.empty()){ const int v = std::stoi(cur); if (n<3) out[n] = v; ++n; cur.clear(); } };
+        for(char c: str){
+            if (std::strchr(seps, c) && c != '\0') flush();
             else if (std::isdigit((unsigned char)c)) cur.push_back(c);
         }
-        if(!cur.empty()) parts.push_back(std::stoi(cur));
-        if (parts.size()<3) return s;
+        flush();
+        return n;
+    };
+
+    int d=0,m=0,y=0;
+    {
+        int parts[3] = {0,0,0};
+        if (fields(date, "/-.", parts)<3) return s;
         d = parts[0]; m = parts[1]; y = parts[2];
         if (y < 100) y = yy_to_yyyy(y);
     }
 
     int H=0, M=0, S=0;
     if (!time.empty()){
-        std::vector<int> t; t.reserve(3);
-        std::string cur;
-        for(char c: time){
-            if (c==':' || c==' '){ if(!cur.empty()){ t.push_back(std::stoi(cur)); cur.clear(); } }
-            else if (std::isdigit((unsigned char)c)) cur.push_back(c);
-        }
-        if(!cur.empty()) t.push_back(std::stoi(cur));
-        if (!t.empty()) H = t[0];
-        if (t.size()>=2) M = t[1];
-        if (t.size()>=3) S = t[2];
+        int t[3] = {0,0,0};
+        const size_t n = fields(time, ": ", t);
+        if (n>=1) H = t[0];
+        if (n>=2) M = t[1];
+        if (n>=3) S = t[2];
     }
 
-    return pad4(y) + "-" + pad2(m) + "-" + pad2(d) + " " + pad2(H) + ":" + pad2(M) + ":" + pad2(S);
+    // un'unica allocazione per il risultato (le concatenazioni ne facevano una per '+')
+    std::string out;
+    out.reserve(19);
+    out += pad4(y); out += '-'; out += pad2(m); out += '-'; out += pad2(d);
+    out += ' ';     out += pad2(H); out += ':'; out += pad2(M); out += ':'; out += pad2(S);
+    return out;
 }
 
-// --------------------- funzione principale ---------------------
-PriceTable load_and_process_price_data_csv(
+// --------------------- core condiviso CSV / XLSX ---------------------
+// Sorgente di righe già divise in celle; false a fine input
+using RowSource = std::function<bool(std::vector<std::string>&)>;
+
+static bool is_numeric_cell(const std::string& s){
+    double v;
+    std::string t = trim_spaces(s);
+    if (!to_double(t, v)) return false;
+    for (char c : t) if (!(std::isdigit((unsigned char)c) || c=='.' || c==',' || c=='-' || c=='+' || c=='e' || c=='E')) return false;
+    return true;
+}
+
+// Seriale Excel (giorni dal 1899-12-30, come lo restituisce l'XLSX) -> ISO.
+// Solo numeri "plausibili" (1900-2199) senza separatori di data ('-', '/', un
+// secondo '.'), così un valore non-data o una data testuale non viene toccato.
+static bool excel_serial_time(const std::string& s, std::string& iso){
+    if (s.find_first_of("-/") != std::string::npos) return false;
+    if (std::count(s.begin(), s.end(), '.') > 1) return false;
+    double v;
+    if (!is_numeric_cell(s) || !to_double(s, v)) return false;
+    if (!(v >= 1.0 && v < 109575.0)) return false;
+    iso = excel_serial_to_iso(v);
+    return true;
+}
+
+// Header, colonne e filtri data comuni; ogni riga dati valida va a sink (false => stop).
+// Restituisce il numero di righe consegnate.
+static size_t scan_rows(
+    const RowSource& next_row,
+    const std::string& kind,                            // "CSV" / "XLSX": messaggi, seriali Excel
     const std::string& filepath,
     const std::string& time_col,
     const std::array<std::string,4>& bid_ask_cols,
@@ -152,16 +221,12 @@ PriceTable load_and_process_price_data_csv(
     const std::optional<std::array<double,2>>& ticks,
     const std::array<double,2>& convs,
     const std::optional<std::string>& start_date,
-    const std::optional<std::string>& end_date
+    const std::optional<std::string>& end_date,
+    const PriceRowSink& sink
 ){
-    std::ifstream fin(filepath);
-    if (!fin.is_open()) throw std::runtime_error("Cannot open CSV: " + filepath);
-
     auto read_header_row = [&](std::vector<std::string>& out)->bool {
-        std::string line;
-        while (std::getline(fin, line)) {
-            if (line.empty()) continue;
-            auto cols = split_auto(line);
+        std::vector<std::string> cols;
+        while (next_row(cols)) {
             size_t nonempty = 0;
             for (auto& c : cols) if (!c.empty()) ++nonempty;
             if (cols.size() >= 4 && nonempty >= 2) { out = std::move(cols); return true; }
@@ -169,9 +234,21 @@ PriceTable load_and_process_price_data_csv(
         return false;
     };
 
+    // seriali Excel e intestazione singola solo per i workbook: nei CSV le date
+    // sono testo e la seconda riga d'intestazione resta tale
+    const bool xlsx = (kind == "XLSX");
+
     std::vector<std::string> raw1, raw2;
-    if (!read_header_row(raw1)) throw std::runtime_error("Empty CSV: " + filepath);
-    if (!read_header_row(raw2)) throw std::runtime_error("CSV senza seconda riga d'intestazione: " + filepath);
+    if (!read_header_row(raw1)) throw std::runtime_error("Empty " + kind + ": " + filepath);
+    if (!read_header_row(raw2)) throw std::runtime_error(kind + " senza seconda riga d'intestazione: " + filepath);
+
+    // Una sola riga d'intestazione (tipico dei workbook): la "seconda" è già un dato
+    std::optional<std::vector<std::string>> first_data;
+    if (xlsx){
+        size_t nonempty = 0, numeric = 0;
+        for (auto& c : raw2) if (!c.empty()) { ++nonempty; if (is_numeric_cell(c)) ++numeric; }
+        if (2*numeric > nonempty) { first_data = std::move(raw2); raw2.clear(); }
+    }
 
     replace_nan_na_with_empty(raw1);
     replace_nan_na_with_empty(raw2);
@@ -188,7 +265,7 @@ PriceTable load_and_process_price_data_csv(
         else                           headers.push_back(a);
     }
 
-    std::cerr << "=== Debug CSV Headers (combined) ===\n";
+    std::cerr << "=== Debug " << kind << " Headers (combined) ===\n";
     for (auto& h : headers) std::cerr << "  [" << h << "]\n";
 
     std::string time_name = time_col;
@@ -222,10 +299,12 @@ PriceTable load_and_process_price_data_csv(
     }
 
     const size_t tcol = need_index(headers, time_name);
-    const size_t b1   = need_index(headers, bid_ask_cols[0]);
-    const size_t a1   = need_index(headers, bid_ask_cols[1]);
-    const size_t b2   = need_index(headers, bid_ask_cols[2]);
-    const size_t a2   = need_index(headers, bid_ask_cols[3]);
+    // nome vuoto => colonna assente (solo mid + ticks, es. workbook di soli prezzi)
+    auto opt_index = [&](const std::string& name){ return name.empty() ? (size_t)-1 : need_index(headers, name); };
+    const size_t b1   = opt_index(bid_ask_cols[0]);
+    const size_t a1   = opt_index(bid_ask_cols[1]);
+    const size_t b2   = opt_index(bid_ask_cols[2]);
+    const size_t a2   = opt_index(bid_ask_cols[3]);
     size_t m1 = (size_t)-1, m2 = (size_t)-1;
     if (mid_cols){
         m1 = need_index(headers, (*mid_cols)[0]);
@@ -237,29 +316,36 @@ PriceTable load_and_process_price_data_csv(
     if (start_date) start_iso = to_iso_datetime_eu(*start_date);
     if (end_date)   end_iso   = to_iso_datetime_eu(*end_date);
 
-    PriceTable out;
-    std::string line;
-    while (std::getline(fin, line)){
-        if (line.empty()) continue;
-        auto cols = split_auto(line);
-        if (cols.size() <= std::max({tcol,b1,a1,b2,a2})) continue;
+    size_t max_col = tcol;
+    for (size_t c : {b1, a1, b2, a2, m1, m2}) if (c != (size_t)-1) max_col = std::max(max_col, c);
+
+    size_t delivered = 0;
+    std::vector<std::string> cols;
+    auto fetch = [&]()->bool {
+        if (first_data) { cols = std::move(*first_data); first_data.reset(); return true; }
+        return next_row(cols);
+    };
+    auto cell = [&](size_t c, double& v){ if (c != (size_t)-1) to_double(cols[c], v); };
+
+    size_t parsed = 0;
+    while (fetch()){
+        ++parsed;
+        if (cols.size() <= max_col) continue;
 
         PriceRow r;
         std::string rawT = trim_spaces(cols[tcol]);
-        r.Time = to_iso_datetime_eu(rawT);
+        if (!xlsx || !excel_serial_time(rawT, r.Time)) r.Time = to_iso_datetime_eu(rawT);
 
         if (!start_iso.empty() && r.Time < start_iso) continue;
         if (!end_iso.empty()   && r.Time >= end_iso) continue;
 
         double B1=0,A1=0,M1=0,B2=0,A2=0,M2=0;
-        to_double(cols[b1], B1);
-        to_double(cols[a1], A1);
-        to_double(cols[b2], B2);
-        to_double(cols[a2], A2);
-        if (mid_cols){
-            to_double(cols[m1], M1);
-            to_double(cols[m2], M2);
-        }
+        cell(b1, B1);
+        cell(a1, A1);
+        cell(b2, B2);
+        cell(a2, A2);
+        cell(m1, M1);
+        cell(m2, M2);
 
         if (M1==0.0 && B1!=0.0 && A1!=0.0) M1 = 0.5*(B1+A1);
         if (M2==0.0 && B2!=0.0 && A2!=0.0) M2 = 0.5*(B2+A2);
@@ -271,10 +357,107 @@ PriceTable load_and_process_price_data_csv(
 
         if (r.Mid1>0 && r.Mid2>0) r.Rt = std::log(r.Mid1 / r.Mid2);
 
-        out.push_back(r);
+        ++delivered;
+        if (!sink(r)) break;
     }
+    c_rows_parsed.add(parsed);
 
+    return delivered;
+}
+
+static PriceTable load_from_rows(
+    const RowSource& next_row,
+    const std::string& kind,
+    const std::string& filepath,
+    const std::string& time_col,
+    const std::array<std::string,4>& bid_ask_cols,
+    const std::optional<std::array<std::string,2>>& mid_cols,
+    const std::optional<std::array<double,2>>& ticks,
+    const std::array<double,2>& convs,
+    const std::optional<std::string>& start_date,
+    const std::optional<std::string>& end_date
+){
+    trace::Scope trace_scope(kind == "CSV" ? "load_csv" : "load_xlsx");
+    PriceTable out;
+    scan_rows(next_row, kind, filepath, time_col, bid_ask_cols, mid_cols, ticks, convs,
+              start_date, end_date, [&](PriceRow& r){ out.push_back(std::move(r)); return true; });
     return out;
 }
 
+// --------------------- funzioni principali ---------------------
+PriceTable load_and_process_price_data_csv(
+    const std::string& filepath,
+    const std::string& time_col,
+    const std::array<std::string,4>& bid_ask_cols,
+    const std::optional<std::array<std::string,2>>& mid_cols,
+    const std::optional<std::array<double,2>>& ticks,
+    const std::array<double,2>& convs,
+    const std::optional<std::string>& start_date,
+    const std::optional<std::string>& end_date
+){
+    std::ifstream fin(filepath);
+    if (!fin.is_open()) throw std::runtime_error("Cannot open CSV: " + filepath);
+
+    std::string line;           // riusata tra le righe
+    RowSource rows = [&](std::vector<std::string>& cols)->bool {
+        while (std::getline(fin, line)){
+            if (line.empty()) continue;
+            split_auto(line, cols);
+            return true;
+        }
+        return false;
+    };
+    return load_from_rows(rows, "CSV", filepath, time_col, bid_ask_cols, mid_cols,
+                          ticks, convs, start_date, end_date);
+}
+
+size_t stream_price_data_csv(
+    const std::string& filepath,
+    const std::string& time_col,
+    const std::array<std::string,4>& bid_ask_cols,
+    const std::optional<std::array<std::string,2>>& mid_cols,
+    const std::optional<std::array<double,2>>& ticks,
+    const std::array<double,2>& convs,
+    const std::optional<std::string>& start_date,
+    const std::optional<std::string>& end_date,
+    const PriceRowSink& on_row
+){
+    trace::Scope trace_scope("stream_csv");
+    std::ifstream fin(filepath);
+    if (!fin.is_open()) throw std::runtime_error("Cannot open CSV: " + filepath);
+
+    std::string line;
+    RowSource rows = [&](std::vector<std::string>& cols)->bool {
+        while (std::getline(fin, line)){
+            if (line.empty()) continue;
+            split_auto(line, cols);
+            return true;
+        }
+        return false;
+    };
+    return scan_rows(rows, "CSV", filepath, time_col, bid_ask_cols, mid_cols,
+                     ticks, convs, start_date, end_date, on_row);
+}
+
+PriceTable load_and_process_price_data_xlsx(
+    const std::string& filepath,
+    const std::string& time_col,
+    const std::array<std::string,4>& bid_ask_cols,
+    const std::optional<std::array<std::string,2>>& mid_cols,
+    const std::optional<std::array<double,2>>& ticks,
+    const std::array<double,2>& convs,
+    const std::optional<std::string>& start_date,
+    const std::optional<std::string>& end_date,
+    int sheet
+){
+    XlsxSheetReader reader(filepath, sheet);
+    RowSource rows = [&](std::vector<std::string>& cols)->bool {
+        if (!reader.next_row(cols)) return false;
+        for (auto& c : cols) c = trim_spaces(c);
+        return true;
+    };
+    return load_from_rows(rows, "XLSX", filepath, time_col, bid_ask_cols, mid_cols,
+                          ticks, convs, start_date, end_date);
+}
+
 } // namespace util
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "utilities/MarketFeed.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace util {
+
+namespace {
+
+std::int64_t mono_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+[[noreturn]] void sys_fail(const std::string& what){
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+template <class T> void store(std::byte* p, size_t off, T v){ std::memcpy(p + off, &v, sizeof v); }
+
+sockaddr_in make_addr(const std::string& host, std::uint16_t port){
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &a.sin_addr) != 1)
+        throw std::runtime_error("feed: bad IPv4 address '" + host + "'");
+    return a;
+}
+
+std::uint16_t bound_port(int fd){
+    sockaddr_in a{};
+    socklen_t len = sizeof a;
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&a), &len) != 0) sys_fail("feed: getsockname");
+    return ntohs(a.sin_port);
+}
+
+void set_nodelay(int fd){
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+}
+
+void send_all(int fd, const std::byte* p, size_t n){
+    while (n){
+        const ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0){
+            if (errno == EINTR) continue;
+            sys_fail("feed: send");
+        }
+        p += w;
+        n -= size_t(w);
+    }
+}
+
+// chiude il descrittore all'uscita dallo scope
+struct Fd {
+    int fd = -1;
+    ~Fd(){ if (fd >= 0) ::close(fd); }
+};
+
+} // anon
+
+// ---------------------------- formato ----------------------------
+
+void encode_feed_tick(std::byte* out, std::uint32_t seq, std::int64_t ts, const PriceRow& r){
+    store(out, 0, seq);
+    store(out, 4, std::uint16_t(FeedMsgType::Tick));
+    store(out, 6, std::uint16_t(0));
+    store(out, 8, ts);
+    store(out, 16, std::int64_t(0));
+    store(out, 24, r.Rt);
+    store(out, 32, r.Bid1);
+    store(out, 40, r.Ask1);
+    store(out, 48, r.Bid2);
+    store(out, 56, r.Ask2);
+}
+
+void encode_feed_end(std::byte* out, std::uint32_t seq){
+    std::memset(out, 0, FEED_MSG_BYTES);
+    store(out, 0, seq);
+    store(out, 4, std::uint16_t(FeedMsgType::End));
+}
+
+void stamp_feed_send(std::byte* msg, std::int64_t send_ns){ store(msg, 16, send_ns); }
+
+// ---------------------------- server ----------------------------
+
+ReplayServer::ReplayServer(const ReplayConfig& cfg) : cfg_(cfg) {
+    if (cfg_.transport == FeedTransport::Udp) { port_ = cfg_.port; return; }
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) sys_fail("replay: socket");
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    const sockaddr_in a = make_addr(cfg_.host, cfg_.port);
+    if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&a), sizeof a) != 0 || ::listen(listen_fd_, 1) != 0){
+        const int e = errno;
+        ::close(listen_fd_);
+        errno = e;
+        sys_fail("replay: bind/listen " + cfg_.host + ":" + std::to_string(cfg_.port));
+    }
+    port_ = bound_port(listen_fd_);
+}
+
+ReplayServer::~ReplayServer(){ if (listen_fd_ >= 0) ::close(listen_fd_); }
+
+ReplayStats ReplayServer::run(const PriceTable& data){
+    trace::Scope trace_scope("replay_server");
+    Fd out;
+    if (cfg_.transport == FeedTransport::Tcp){
+        do out.fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        while (out.fd < 0 && errno == EINTR);
+        if (out.fd < 0) sys_fail("replay: accept");
+        set_nodelay(out.fd);
+    } else {
+        out.fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (out.fd < 0) sys_fail("replay: socket");
+        const sockaddr_in a = make_addr(cfg_.host, port_);
+        if (::connect(out.fd, reinterpret_cast<const sockaddr*>(&a), sizeof a) != 0) sys_fail("replay: connect");
+    }
+
+    ReplayStats S;
+    alignas(64) std::byte msg[FEED_MSG_BYTES];
+    const auto t0 = std::chrono::steady_clock::now();
+    double feed_s = 0.0;                         // tempo feed trascorso (buchi compressi)
+    std::int64_t prev_ts = 0;
+
+    std::uint32_t seq = 0;
+    for (const auto& r : data){
+        const std::int64_t ts = iso_to_epoch_seconds(r.Time);
+        if (cfg_.speed > 0.0){
+            if (seq > 0 && ts != INT64_MIN && prev_ts != INT64_MIN)
+                feed_s += std::clamp(double(ts - prev_ts), 0.0, cfg_.max_gap_s);
+            std::this_thread::sleep_until(t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(feed_s / cfg_.speed)));
+        }
+        prev_ts = ts;
+
+        encode_feed_tick(msg, seq++, ts, r);
+        stamp_feed_send(msg, mono_ns());
+        send_all(out.fd, msg, FEED_MSG_BYTES);
+    }
+    encode_feed_end(msg, seq);
+    send_all(out.fd, msg, FEED_MSG_BYTES);
+    if (cfg_.transport == FeedTransport::Tcp) ::shutdown(out.fd, SHUT_WR);
+
+    S.messages = data.size();
+    S.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    S.msgs_per_s = S.wall_s > 0.0 ? double(S.messages) / S.wall_s : 0.0;
+    return S;
+}
+
+// ---------------------------- consumer ----------------------------
+
+FeedConsumer::FeedConsumer(const FeedConsumerConfig& cfg) : cfg_(cfg) {
+    if (cfg_.transport == FeedTransport::Tcp) { port_ = cfg_.port; return; }
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) sys_fail("feed: socket");
+    int rcv = 8 << 20;                           // assorbe i burst a velocità massima
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcv, sizeof rcv);
+    const sockaddr_in a = make_addr(cfg_.host, cfg_.port);
+    if (::bind(fd_, reinterpret_cast<const sockaddr*>(&a), sizeof a) != 0){
+        const int e = errno;
+        ::close(fd_);
+        fd_ = -1;
+        errno = e;
+        sys_fail("feed: bind " + cfg_.host + ":" + std::to_string(cfg_.port));
+    }
+    port_ = bound_port(fd_);
+}
+
+FeedConsumer::~FeedConsumer(){ if (fd_ >= 0) ::close(fd_); }
+
+FeedConsumerStats FeedConsumer::run(StreamingBacktester& bt, const TradeSink& on_trade){
+    trace::Scope trace_scope("feed_consumer");
+    const bool tcp = cfg_.transport == FeedTransport::Tcp;
+
+    if (tcp && fd_ < 0){
+        // il server può non essere ancora in ascolto: riprova fino a idle_timeout_ms
+        const sockaddr_in a = make_addr(cfg_.host, cfg_.port);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(cfg_.idle_timeout_ms);
+        for (;;){
+            fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd_ < 0) sys_fail("feed: socket");
+            if (::connect(fd_, reinterpret_cast<const sockaddr*>(&a), sizeof a) == 0) break;
+            const int e = errno;
+            ::close(fd_);
+            fd_ = -1;
+            errno = e;
+            if (e != ECONNREFUSED || std::chrono::steady_clock::now() >= deadline)
+                sys_fail("feed: connect " + cfg_.host + ":" + std::to_string(cfg_.port));
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        set_nodelay(fd_);
+        ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    }
+
+    Fd ep;
+    ep.fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (ep.fd < 0) sys_fail("feed: epoll_create1");
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd_;
+    if (::epoll_ctl(ep.fd, EPOLL_CTL_ADD, fd_, &ev) != 0) sys_fail("feed: epoll_ctl");
+
+    FeedConsumerStats S;
+    std::vector<std::byte> buf(std::max(cfg_.recv_buffer, 2 * FEED_MSG_BYTES));
+    size_t fill = 0;                             // TCP: byte di un messaggio a metà in testa
+    std::uint32_t expected = 0;
+    bool eof = false;
+
+    // decodifica in place e decisione; latenza presa appena il backtester ha deciso
+    auto consume = [&](const std::byte* p){
+        const FeedView v(p);
+        if (v.type() == FeedMsgType::End) { S.got_end = true; return; }
+        if (v.type() != FeedMsgType::Tick) return;
+        if (v.seq() < expected){
+            // datagramma in ritardo (UDP): il suo seq era già contato in lost e il
+            // backtester è andato avanti, quindi non lo si passa a on_quote
+            ++S.reordered;
+            if (S.lost > 0) --S.lost;
+            return;
+        }
+        S.lost += v.seq() - expected;
+        expected = v.seq() + 1;
+        const Trade* t = bt.on_quote(v.ts(), v.rt(), v.bid1(), v.ask1(), v.bid2(), v.ask2());
+        S.latency.record(mono_ns() - v.send_ns());
+        ++S.messages;
+        if (t && on_trade) on_trade(*t);
+    };
+
+    while (!S.got_end && !eof){
+        epoll_event got{};
+        const int n = ::epoll_wait(ep.fd, &got, 1, cfg_.idle_timeout_ms);
+        if (n < 0){
+            if (errno == EINTR) continue;
+            sys_fail("feed: epoll_wait");
+        }
+        if (n == 0) break;                       // nessun dato: feed finito o perso
+        ++S.wakeups;
+
+        // edge-triggered: svuota il socket fino a EAGAIN
+        for (;;){
+            const ssize_t r = tcp ? ::recv(fd_, buf.data() + fill, buf.size() - fill, 0)
+                                  : ::recv(fd_, buf.data(), buf.size(), 0);
+            if (r < 0){
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                sys_fail("feed: recv");
+            }
+            if (r == 0) { if (tcp) eof = true; break; }
+
+            if (tcp){
+                const size_t avail = fill + size_t(r);
+                size_t off = 0;
+                for (; off + FEED_MSG_BYTES <= avail && !S.got_end; off += FEED_MSG_BYTES)
+                    consume(buf.data() + off);
+                fill = avail - off;              // < 64 byte: spostati in testa
+                if (fill) std::memmove(buf.data(), buf.data() + off, fill);
+            } else {
+                for (size_t off = 0; off + FEED_MSG_BYTES <= size_t(r); off += FEED_MSG_BYTES)
+                    consume(buf.data() + off);
+            }
+            if (S.got_end) break;
+        }
+    }
+    S.metrics = bt.metrics();
+    return S;
+}
+
+} // namespace util
@@ -0,0 +1,100 @@
+#include "utilities/MonteCarloBacktest.hpp"
+#include "utilities/StreamingBacktest.hpp"
+#include "utilities/Parallel.hpp"
+#include "utilities/Loaders.hpp"     // for PriceRow/PriceTable
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+namespace util {
+
+static inline double safe_log_ratio(double a, double b){
+    return (a>0.0 && b>0.0) ? std::log(a/b) : 0.0;
+}
+
+// quantile (p in [0,1]) su vettore già ordinato, interpolazione lineare
+static double quantile_sorted(const std::vector<double>& v, double p){
+    if (v.empty()) return NAN;
+    const double idx = p * (v.size()-1);
+    const size_t i = static_cast<size_t>(std::floor(idx));
+    const size_t j = static_cast<size_t>(std::ceil(idx));
+    const double w = idx - i;
+    return (1.0 - w)*v[i] + w*v[j];
+}
+
+std::vector<double> empirical_half_costs(const PriceTable& data){
+    std::vector<double> out;
+    out.reserve(data.size());
+    for (const auto& r : data){
+        if (r.Bid1 > 0.0 && r.Ask1 > 0.0 && r.Bid2 > 0.0 && r.Ask2 > 0.0){
+            const double hc = 0.5 * (safe_log_ratio(r.Ask1, r.Bid1) + safe_log_ratio(r.Ask2, r.Bid2));
+            if (std::isfinite(hc)) out.push_back(hc);
+        }
+    }
+    return out;
+}
+
+MonteCarloResult backtest_monte_carlo(const stats::OUBootstrapResult& ou,
+                                      const BacktestConfig& cfg,
+                                      const MonteCarloConfig& mc)
+{
+    if (mc.param_uncertainty && ou.boot_k.empty())
+        throw std::invalid_argument("backtest_monte_carlo: param_uncertainty needs bootstrap samples.");
+
+    MonteCarloResult R;
+    R.q = mc.quantiles;
+
+    std::vector<BacktestMetrics> samples(mc.n_paths);
+    const size_t n_boot = ou.boot_k.size();
+    const size_t n_cost = mc.half_costs.size();
+
+    parallel_for(mc.n_paths, mc.n_threads, [&](size_t b, size_t e, unsigned){
+        std::normal_distribution<double> Z(0.0, 1.0);
+
+        for (size_t p=b; p<e; ++p){
+            std::mt19937_64 rng(stream_seed(mc.seed, p));
+
+            double k = ou.k, eta = ou.eta, sigma = ou.sigma;
+            if (mc.param_uncertainty){
+                const size_t m = std::uniform_int_distribution<size_t>(0, n_boot-1)(rng);
+                k = ou.boot_k[m]; eta = ou.boot_eta[m]; sigma = ou.boot_sigma[m];
+            }
+
+            // passo esatto OU (come ou_sim)
+            const double a  = std::exp(-k*mc.dt);
+            const double c  = eta * (1.0 - a);
+            const double sd = sigma * std::sqrt((1.0 - a*a) / (2.0*k));
+            std::uniform_int_distribution<size_t> pick(0, n_cost ? n_cost-1 : 0);
+
+            StreamingBacktester bt(cfg);
+            double x = std::isfinite(mc.x0) ? mc.x0 : eta;
+            for (size_t i=0; i<mc.n_bars; ++i){
+                const double hc = n_cost ? mc.half_costs[pick(rng)] : mc.half_cost;
+                bt.on_bar(x, hc);
+                x = a*x + c + sd*Z(rng);
+            }
+            samples[p] = bt.metrics();
+            Z.reset();
+        }
+    });
+
+    // quantili per metrica
+    std::vector<double> col(mc.n_paths);
+    auto fill_q = [&](auto get, std::vector<double>& out){
+        for (size_t p=0; p<mc.n_paths; ++p) col[p] = get(samples[p]);
+        std::sort(col.begin(), col.end());
+        out.clear();
+        for (double q : mc.quantiles) out.push_back(quantile_sorted(col, q));
+    };
+    fill_q([](const BacktestMetrics& m){ return m.sharpe_bar; }, R.sharpe_bar);
+    fill_q([](const BacktestMetrics& m){ return m.max_dd;     }, R.max_dd);
+    fill_q([](const BacktestMetrics& m){ return m.hit_ratio;  }, R.hit_ratio);
+    fill_q([](const BacktestMetrics& m){ return m.sum_pnl;    }, R.sum_pnl);
+    fill_q([](const BacktestMetrics& m){ return (double)m.n_trades; }, R.n_trades);
+
+    if (mc.keep_samples) R.samples = std::move(samples);
+    return R;
+}
+
+} // namespace util
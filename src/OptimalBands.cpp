@@ -1,4 +1,5 @@
 #include "utilities/OptimalBands.hpp"
+#include "utilities/Trace.hpp"
 #include <cmath>
 #include <stdexcept>
 #include <algorithm>
@@ -59,6 +60,8 @@ OptimalBandsResult optimal_trading_bands(
     double C, double alpha, int grid
 ){
     (void)M; (void)alpha; (void)grid; // se non usati nella tua versione attuale
+    trace::Scope trace_scope("optimal_trading_bands");
+    static trace::Counter c_evals("nlopt_evals");
 
     OptimalBandsResult R;
     R.f_input = f;
@@ -68,7 +71,9 @@ OptimalBandsResult optimal_trading_bands(
     const double c          = C / sigma_stat;
 
     // objective
+    std::uint64_t n_evals = 0;
     auto obj_fun = [&](const std::vector<double>& x, std::vector<double>& /*grad*/) {
+        ++n_evals;
         auto tup = long_return(x[0], x[1], c, l, sigma_stat, f);
         double mu = std::get<0>(tup);
         return -mu;
@@ -95,6 +100,7 @@ OptimalBandsResult optimal_trading_bands(
     std::vector<double> x0 = {-0.5, 0.5};
     double minf = 0.0;
     nlopt::result result = opt.optimize(x0, minf);
+    c_evals.add(n_evals);
 
     if (result > 0) {
         double d = std::abs(x0[0]);
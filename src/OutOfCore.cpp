@@ -0,0 +1,350 @@
+#include "utilities/OutOfCore.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/Loaders.hpp"
+#include "utilities/QuantileSketch.hpp"
+#include "utilities/StreamingOutliers.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+
+namespace util {
+
+namespace {
+
+// una riga durante il sort: ts + le 7 colonne double (64 byte)
+struct Rec {
+    std::int64_t ts;
+    double bid1, ask1, mid1, bid2, ask2, mid2, rt;
+};
+
+constexpr size_t N_COLS = 8;
+
+std::uint64_t rounded_chunk_rows(std::uint64_t n){ return (std::max<std::uint64_t>(n, 1) + 511) / 512 * 512; }
+
+void append_row(ResultStore::Writer& w, std::int64_t ts, double b1, double a1, double m1,
+                double b2, double a2, double m2, double rt){
+    w.append({ts, b1, a1, m1, b2, a2, m2, rt});
+}
+
+void write_run(const std::string& path, const std::vector<Rec>& recs, std::uint64_t chunk_rows){
+    ResultStore st(path, price_rows_schema(), recs.size(), chunk_rows, 1);
+    auto w = st.writer();
+    for (const auto& r : recs) append_row(w, r.ts, r.bid1, r.ask1, r.mid1, r.bid2, r.ask2, r.mid2, r.rt);
+}
+
+// k-way merge di file ordinati (parità: file precedente prima => sort stabile)
+void merge_runs(const std::vector<std::string>& in, const std::string& out, std::uint64_t chunk_rows){
+    trace::Scope scope("ooc_merge");
+    struct Cursor {
+        std::unique_ptr<PriceChunkReader> r;
+        size_t ci = 0, pos = 0;
+        PriceChunkReader::Chunk c;
+        bool load(){                                // prossimo chunk non vuoto
+            for (; ci < r->n_chunks(); ++ci){
+                c = r->chunk(ci);
+                pos = 0;
+                if (c.size()) return true;
+            }
+            return false;
+        }
+        bool advance(){
+            if (++pos < c.size()) return true;
+            r->evict(ci++);
+            return load();
+        }
+    };
+
+    std::vector<Cursor> cur(in.size());
+    size_t total = 0;
+    for (size_t k=0; k<in.size(); ++k){
+        cur[k].r = std::make_unique<PriceChunkReader>(in[k]);
+        total += cur[k].r->rows();
+    }
+
+    using Head = std::pair<std::int64_t, size_t>;   // (ts, indice del file)
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    for (size_t k=0; k<cur.size(); ++k)
+        if (cur[k].load()) heap.push({cur[k].c.ts[0], k});
+
+    ResultStore st(out, price_rows_schema(), total, chunk_rows, 1);
+    auto w = st.writer();
+    while (!heap.empty()){
+        const size_t k = heap.top().second;
+        heap.pop();
+        Cursor& C = cur[k];
+        const size_t i = C.pos;
+        append_row(w, C.c.ts[i], C.c.bid1[i], C.c.ask1[i], C.c.mid1[i],
+                   C.c.bid2[i], C.c.ask2[i], C.c.mid2[i], C.c.rt[i]);
+        if (C.advance()) heap.push({C.c.ts[C.pos], k});
+    }
+}
+
+double hour_of(std::int64_t ts){
+    const std::int64_t s = ((ts % 86400) + 86400) % 86400;
+    return double(s) / 3600.0;                      // = extract_decimal_hour sull'ISO
+}
+
+} // anon
+
+StoreSchema price_rows_schema(){
+    return {"PriceRow", {
+        {"ts", SlotType::I64},
+        {"bid1"}, {"ask1"}, {"mid1"}, {"bid2"}, {"ask2"}, {"mid2"}, {"rt"}
+    }};
+}
+
+// ---------------------------- lettura a chunk ----------------------------
+
+PriceChunkReader::PriceChunkReader(const std::string& path) : store_(path) {
+    const char* names[N_COLS] = {"ts", "bid1", "ask1", "mid1", "bid2", "ask2", "mid2", "rt"};
+    for (size_t c=0; c<N_COLS; ++c){
+        col_[c] = store_.column(names[c]);
+        if (col_[c] < 0) throw std::runtime_error("PriceChunkReader: column '" + std::string(names[c]) + "' missing in " + path);
+    }
+}
+
+PriceChunkReader::Chunk PriceChunkReader::chunk(size_t i) const {
+    const auto c = store_.chunk(i);
+    Chunk out;
+    out.ts   = c.col<std::int64_t>(size_t(col_[0]));
+    out.bid1 = c.col<double>(size_t(col_[1]));
+    out.ask1 = c.col<double>(size_t(col_[2]));
+    out.mid1 = c.col<double>(size_t(col_[3]));
+    out.bid2 = c.col<double>(size_t(col_[4]));
+    out.ask2 = c.col<double>(size_t(col_[5]));
+    out.mid2 = c.col<double>(size_t(col_[6]));
+    out.rt   = c.col<double>(size_t(col_[7]));
+    return out;
+}
+
+PriceRow PriceChunkReader::Chunk::row(size_t i) const {
+    PriceRow r;
+    r.Time = epoch_seconds_to_iso(ts[i]);
+    r.Bid1 = bid1[i]; r.Ask1 = ask1[i]; r.Mid1 = mid1[i];
+    r.Bid2 = bid2[i]; r.Ask2 = ask2[i]; r.Mid2 = mid2[i];
+    r.Rt   = rt[i];
+    return r;
+}
+
+// ---------------------------- import + sort esterno ----------------------------
+
+ColumnarImport import_sorted_columnar(const RunSpec& spec, const std::string& out_path,
+                                      const std::string& tmp_dir, const OutOfCoreConfig& cfg){
+    trace::Scope trace_scope("ooc_import");
+    ColumnarImport I;
+    const std::uint64_t chunk_rows = rounded_chunk_rows(cfg.chunk_rows);
+    const size_t chunk_bytes = N_COLS * chunk_rows * 8;
+    // stable_sort prende fino a n/2 record di appoggio: buffer = limite / 2
+    const size_t run_cap = std::max<size_t>(chunk_rows, cfg.memory_limit / (2 * sizeof(Rec)));
+    const size_t fan_in  = std::max<size_t>(2, cfg.memory_limit / (2 * chunk_bytes));
+
+    std::vector<std::string> runs;
+    std::vector<Rec> buf;
+    buf.reserve(run_cap);
+    auto run_path = [&](size_t pass, size_t n){
+        return tmp_dir + "/run_" + std::to_string(pass) + "_" + std::to_string(n) + ".store";
+    };
+    auto flush_run = [&](const std::string& path){
+        trace::Scope scope("ooc_sort_run");
+        std::stable_sort(buf.begin(), buf.end(), [](const Rec& a, const Rec& b){ return a.ts < b.ts; });
+        write_run(path, buf, chunk_rows);
+        I.rows += buf.size();
+        buf.clear();
+    };
+
+    stream_price_data_csv(spec.csv_path, spec.time_col, spec.bid_ask_cols, spec.mid_cols, spec.ticks,
+                          spec.convs, spec.start_date, spec.end_date,
+        [&](PriceRow& r){
+            const std::int64_t ts = iso_to_epoch_seconds(r.Time);
+            if (ts == INT64_MIN) { ++I.bad_time; return true; }
+            buf.push_back({ts, r.Bid1, r.Ask1, r.Mid1, r.Bid2, r.Ask2, r.Mid2, r.Rt});
+            if (buf.size() == run_cap){
+                runs.push_back(run_path(0, runs.size()));
+                flush_run(runs.back());
+            }
+            return true;
+        });
+
+    if (runs.empty()){                          // tutto in un buffer: niente merge
+        I.runs = 1;
+        flush_run(out_path);
+        return I;
+    }
+    if (!buf.empty()){
+        runs.push_back(run_path(0, runs.size()));
+        flush_run(runs.back());
+    }
+    buf = std::vector<Rec>{};                   // libera il buffer prima del merge
+    I.runs = runs.size();
+
+    auto remove_all = [](const std::vector<std::string>& files){
+        std::error_code ec;
+        for (const auto& f : files) std::filesystem::remove(f, ec);
+    };
+    // fan-in limitato: gruppi consecutivi (l'ordine dei file resta quello del CSV)
+    while (runs.size() > fan_in){
+        ++I.merge_passes;
+        std::vector<std::string> next;
+        for (size_t b=0; b<runs.size(); b+=fan_in){
+            const std::vector<std::string> group(runs.begin() + b, runs.begin() + std::min(runs.size(), b + fan_in));
+            if (group.size() == 1) { next.push_back(group[0]); continue; }
+            next.push_back(run_path(I.merge_passes, next.size()));
+            merge_runs(group, next.back(), chunk_rows);
+            remove_all(group);
+        }
+        runs = std::move(next);
+    }
+    ++I.merge_passes;
+    merge_runs(runs, out_path, chunk_rows);
+    remove_all(runs);
+    return I;
+}
+
+// ---------------------------- run completa ----------------------------
+
+OutOfCoreResult run_out_of_core(const RunSpec& spec, const OutOfCoreConfig& cfg, const TradeSink& on_trade){
+    trace::Scope trace_scope("ooc_run");
+    if (spec.bar_seconds > 0) throw std::runtime_error("bar resampling is not supported by --ooc (use --batch)");
+    const auto t0 = std::chrono::steady_clock::now();
+    OutOfCoreResult R;
+
+    std::string dir = cfg.work_dir;
+    if (dir.empty()){
+        std::string name = spec.name.empty() ? "run" : spec.name;
+        for (char& ch : name) if (ch == '/' || ch == '\\' || ch == ' ') ch = '_';
+        dir = "outputs/ooc/" + name;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    const std::string sorted = dir + "/sorted.store";
+
+    R.import = import_sorted_columnar(spec, sorted, dir, cfg);
+    struct Cleanup {
+        std::string path; bool keep;
+        ~Cleanup(){ if (!keep) { std::error_code e; std::filesystem::remove(path, e); } }
+    } cleanup{sorted, cfg.keep_sorted};
+
+    const PriceChunkReader in(sorted);
+    if (in.rows() == 0) throw std::runtime_error("no rows loaded from " + spec.csv_path);
+
+    // split come trim_and_split_price_table: prima riga (ordinata) + split_months
+    std::int64_t first_ts = 0;
+    for (size_t i=0; i<in.n_chunks(); ++i){
+        const auto c = in.chunk(i);
+        if (c.size()) { first_ts = c.ts[0]; break; }
+    }
+    const std::int64_t split_ts = iso_to_epoch_seconds(add_months_iso(epoch_seconds_to_iso(first_ts), spec.split_months));
+
+    auto in_window = [](double h, double a, double b){ return (h >= a) && (h <= b); };
+    enum Dest : unsigned char { DROP = 0, IS = 1, OS = 2 };
+    auto dest_of = [&](std::int64_t ts, double h){
+        if (ts < split_ts) return in_window(h, spec.IS_hours[0], spec.IS_hours[1]) ? IS : DROP;
+        // tieni solo FUORI dalla finestra esclusa
+        return (h <= spec.OS_exclude_hours[0] || h >= spec.OS_exclude_hours[1]) ? OS : DROP;
+    };
+
+    // ---- passata 1: costo, sketch delle Rt IS / OS ----
+    StreamingOutlierConfig oc;
+    oc.mode = FenceMode::Frozen;
+    oc.k = cfg.sketch_k;
+    KllSketch sk_IS(oc.k, oc.seed), sk_OS(oc.k, oc.seed);
+    double cost_sum = 0.0;
+    size_t cost_n = 0;
+    {
+        trace::Scope scope("ooc_pass_sketch");
+        in.for_each_chunk([&](const PriceChunkReader::Chunk& c){
+            for (size_t i=0; i<c.size(); ++i){
+                const double h = hour_of(c.ts[i]);
+                if (c.ts[i] < split_ts && in_window(h, spec.cost_hours[0], spec.cost_hours[1])){
+                    const double ct = log_cost(c.bid1[i], c.ask1[i], c.bid2[i], c.ask2[i]);
+                    if (std::isfinite(ct)) { cost_sum += ct; ++cost_n; }
+                }
+                switch (dest_of(c.ts[i], h)){
+                    case IS: sk_IS.update(c.rt[i]); ++R.IS_rows; break;
+                    case OS: sk_OS.update(c.rt[i]); ++R.OS_rows; break;
+                    default: break;
+                }
+            }
+        });
+    }
+    R.C = cost_n ? cost_sum / static_cast<double>(cost_n) : 0.0;
+
+    // ---- passata 2: outlier a fence congelate, somme OU, poi bande + backtest ----
+    StreamingOutlierFilter filt_IS(oc), filt_OS(oc);
+    filt_IS.freeze(OutlierFences::from(sk_IS));
+    filt_OS.freeze(OutlierFences::from(sk_OS));
+
+    stats::OUSums S;
+    bool has_prev = false;
+    double prev = 0.0;
+    auto add_IS = [&](const StreamingOutlierFilter::Decision* d){
+        if (!d || d->outlier) return;
+        ++R.IS_clean;
+        const double x = d->row.Rt;                 // stesse coppie di ou_mle
+        if (!has_prev) S.x_first = x;
+        else {
+            ++S.N;
+            S.sum_m += prev;       S.sum_p += x;
+            S.sum_mm += prev*prev; S.sum_pp += x*x; S.sum_pm += prev*x;
+        }
+        S.x_last = x;
+        prev = x;
+        has_prev = true;
+    };
+
+    std::unique_ptr<StreamingBacktester> bt;
+    auto calibrate = [&]{
+        add_IS(filt_IS.finish());
+        R.ou = stats::ou_mle_from_sums(S, cfg.dt);
+        if (!(R.ou.k > 0.0) || !std::isfinite(R.ou.sigma))
+            throw std::runtime_error("OU calibration failed");
+        R.bands = optimal_trading_bands(spec.M_opt, spec.l_bt, spec.f_bt, R.ou.k, R.ou.sigma,
+                                        R.C, spec.alpha, spec.grid);
+        BacktestConfig bc;
+        bc.k_hat     = R.ou.k;
+        bc.eta_hat   = R.ou.eta;
+        bc.sigma_hat = R.ou.sigma;
+        bc.d = -std::abs(R.bands.d_estimated);
+        bc.u =  std::abs(R.bands.u_estimated);
+        bc.l = spec.l_bt;
+        bc.f = spec.f_bt;
+        bc.symmetric = spec.symmetric;
+        bt = std::make_unique<StreamingBacktester>(bc);
+    };
+    auto add_OS = [&](const StreamingOutlierFilter::Decision* d){
+        if (!d || d->outlier) return;
+        ++R.OS_clean;
+        const Trade* t = bt->on_row(d->row);        // lo stato resta nel backtester tra i chunk
+        if (t && on_trade) on_trade(*t);
+    };
+
+    {
+        trace::Scope scope("ooc_pass_backtest");
+        PriceRow row;
+        in.for_each_chunk([&](const PriceChunkReader::Chunk& c){
+            for (size_t i=0; i<c.size(); ++i){
+                const Dest d = dest_of(c.ts[i], hour_of(c.ts[i]));
+                if (d == DROP) continue;
+                row = c.row(i);
+                if (d == IS) add_IS(filt_IS.push(row));
+                else {
+                    if (!bt) calibrate();           // ordinato: tutto l'IS è già passato
+                    add_OS(filt_OS.push(row));
+                }
+            }
+        });
+        if (!bt) calibrate();
+        add_OS(filt_OS.finish());
+    }
+    R.metrics = bt->metrics();
+    R.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return R;
+}
+
+} // namespace util
@@ -0,0 +1,148 @@
+#include "utilities/PairScreening.hpp"
+#include "utilities/StatisticalBootstrap.hpp"
+#include "utilities/Parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace util {
+
+namespace {
+
+// Σ a[t]·b[t], Σ a[t+1]·b[t], Σ b[t+1]·a[t] su t in [0, n).
+// Quattro accumulatori indipendenti per corsia: senza -ffast-math il compilatore
+// non può riassociare una riduzione singola, così invece vettorizza.
+inline void lag_dots(const double* a, const double* b, size_t n,
+                     double& s00, double& s10, double& s01)
+{
+    double x0[4] = {0,0,0,0}, x1[4] = {0,0,0,0}, x2[4] = {0,0,0,0};
+    size_t t = 0;
+    for (; t + 4 <= n; t += 4){
+        for (int u=0; u<4; ++u){
+            x0[u] += a[t+u]   * b[t+u];
+            x1[u] += a[t+u+1] * b[t+u];
+            x2[u] += b[t+u+1] * a[t+u];
+        }
+    }
+    for (; t < n; ++t){
+        x0[0] += a[t]   * b[t];
+        x1[0] += a[t+1] * b[t];
+        x2[0] += b[t+1] * a[t];
+    }
+    s00 += (x0[0] + x0[1]) + (x0[2] + x0[3]);
+    s10 += (x1[0] + x1[1]) + (x1[2] + x1[3]);
+    s01 += (x2[0] + x2[1]) + (x2[2] + x2[3]);
+}
+
+} // anon
+
+std::vector<PairScore> screen_pairs(const InstrumentTable& tbl, const ScreeningConfig& cfg)
+{
+    const size_t n = tbl.mid.size();
+    if (n < 2) return {};
+    const size_t Nb = tbl.mid[0].size();       // barre = N+1
+    for (const auto& c : tbl.mid)
+        if (c.size() != Nb) throw std::invalid_argument("screen_pairs: column size mismatch.");
+    if (Nb < 3) return {};
+    const size_t N = Nb - 1;
+
+    const bool has_quotes = !tbl.bid.empty() && !tbl.ask.empty();
+    if (has_quotes && (tbl.bid.size() != n || tbl.ask.size() != n))
+        throw std::invalid_argument("screen_pairs: bid/ask must cover every instrument.");
+
+    // log-prezzi centrati (la media si riporta solo su eta), somme e costi per strumento
+    std::vector<std::vector<double>> A(n, std::vector<double>(Nb));
+    std::vector<double> mu(n), S_m(n), S_p(n), cost(n, 0.0);
+
+    parallel_for(n, cfg.n_threads, [&](size_t b, size_t e, unsigned){
+        for (size_t i=b; i<e; ++i){
+            auto& a = A[i];
+            double s = 0.0;
+            for (size_t t=0; t<Nb; ++t){ a[t] = std::log(tbl.mid[i][t]); s += a[t]; }
+            mu[i] = s / static_cast<double>(Nb);
+            double sm = 0.0;
+            for (size_t t=0; t<Nb; ++t){ a[t] -= mu[i]; if (t < N) sm += a[t]; }
+            S_m[i] = sm;
+            S_p[i] = sm - a[0] + a[N];
+
+            if (has_quotes){
+                double c = 0.0; size_t cnt = 0;
+                for (size_t t=0; t<Nb; ++t){
+                    const double bb = tbl.bid[i][t], aa = tbl.ask[i][t];
+                    if (bb > 0.0 && aa > 0.0){ c += std::log(aa / bb); ++cnt; }
+                }
+                cost[i] = cnt ? c / static_cast<double>(cnt) : 0.0;
+            }
+        }
+    });
+
+    // Gram condivise: G0[i][j] = Σ a_i,t a_j,t ; G1[i][j] = Σ a_i,t+1 a_j,t  (t < N)
+    std::vector<double> G0(n*n, 0.0), G1(n*n, 0.0);
+    const size_t B = std::max<size_t>(cfg.block_bars, 16);
+
+    parallel_for(n, cfg.n_threads, [&](size_t rb, size_t re, unsigned){
+        // blocchi di barre all'esterno: le colonne del blocco restano in cache per tutte le j
+        for (size_t t0=0; t0<N; t0+=B){
+            const size_t len = std::min(B, N - t0);
+            for (size_t i=rb; i<re; ++i){
+                const double* ai = A[i].data() + t0;
+                for (size_t j=i; j<n; ++j){
+                    const double* aj = A[j].data() + t0;
+                    double s00 = 0.0, s10 = 0.0, s01 = 0.0;
+                    lag_dots(ai, aj, len, s00, s10, s01);
+                    G0[i*n + j] += s00;
+                    G1[i*n + j] += s10;
+                    if (j != i) G1[j*n + i] += s01;  // riga j scritta solo dal thread che possiede i<j
+                }
+            }
+        }
+    });
+    for (size_t i=0; i<n; ++i)
+        for (size_t j=0; j<i; ++j) G0[i*n + j] = G0[j*n + i];
+
+    // statistiche per coppia
+    std::vector<PairScore> out;
+    out.reserve(n*(n-1)/2);
+    for (size_t i=0; i<n; ++i){
+        for (size_t j=i+1; j<n; ++j){
+            const double a0i = A[i][0], a0j = A[j][0], aNi = A[i][N], aNj = A[j][N];
+            auto Gpp = [&](size_t p, size_t q, double a0p, double a0q, double aNp, double aNq){
+                return G0[p*n + q] - a0p*a0q + aNp*aNq;
+            };
+
+            stats::OUSums S;
+            S.N      = N;
+            S.sum_m  = S_m[i] - S_m[j];
+            S.sum_p  = S_p[i] - S_p[j];
+            S.sum_mm = G0[i*n+i] - 2.0*G0[i*n+j] + G0[j*n+j];
+            S.sum_pp = Gpp(i,i,a0i,a0i,aNi,aNi) - 2.0*Gpp(i,j,a0i,a0j,aNi,aNj) + Gpp(j,j,a0j,a0j,aNj,aNj);
+            S.sum_pm = G1[i*n+i] - G1[i*n+j] - G1[j*n+i] + G1[j*n+j];
+            S.x_first = a0i - a0j;
+            S.x_last  = aNi - aNj;
+
+            const auto E = stats::ou_mle_from_sums(S, cfg.dt);
+            if (!(E.rho > 0.0 && E.rho < 1.0)) continue;   // non mean-reverting
+
+            PairScore ps;
+            ps.i = i; ps.j = j;
+            ps.k = E.k;
+            ps.eta = E.eta + (mu[i] - mu[j]);
+            ps.sigma = E.sigma;
+            ps.rho = E.rho;
+            ps.half_life  = std::log(2.0) / E.k;
+            ps.sigma_stat = E.sigma / std::sqrt(2.0 * E.k);
+            ps.mean_cost  = cost[i] + cost[j];
+
+            if (ps.half_life > cfg.max_half_life) continue;
+            if (ps.sigma_stat < cfg.min_sigma_to_cost * ps.mean_cost) continue;
+            out.push_back(ps);
+        }
+    }
+
+    std::sort(out.begin(), out.end(), [](const PairScore& a, const PairScore& b){
+        return a.half_life < b.half_life;
+    });
+    return out;
+}
+
+} // namespace util
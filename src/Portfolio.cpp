@@ -0,0 +1,155 @@
+#include "utilities/Portfolio.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/Loaders.hpp"
+#include "utilities/DataOrdering.hpp"
+#include "utilities/Resample.hpp"
+#include "utilities/ThreadPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <future>
+#include <tuple>
+
+namespace util {
+
+PairOutcome run_pair(const PairSpec& spec)
+{
+    PairOutcome out;
+    out.name = spec.name;
+
+    // LOAD + TRIM & SPLIT
+    PriceTable IS, OS;
+    {
+        auto tbl = load_and_process_price_data_csv(
+            spec.csv_path, spec.time_col, spec.bid_ask_cols, spec.mid_cols,
+            spec.ticks, spec.convs, spec.start_date, spec.end_date);
+        if (tbl.empty()) throw std::runtime_error("no rows loaded from " + spec.csv_path);
+        if (spec.bar_seconds > 0){
+            ResampleConfig rc;
+            rc.bar_seconds = spec.bar_seconds;
+            tbl = resample_ticks(tbl, rc).bars;
+        }
+
+        // COSTO MEDIO (IS grezzo, finestra cost_start/end_hour, come main)
+        {
+            out.C = avg_log_cost(trim_and_split_price_table(
+                tbl, spec.cost_start_hour, spec.cost_end_hour,
+                spec.OS_start_hour, spec.OS_end_hour, spec.split_months).first);
+        }
+
+        std::tie(IS, OS) = trim_and_split_price_table(
+            tbl, spec.IS_start_hour, spec.IS_end_hour,
+            spec.OS_start_hour, spec.OS_end_hour, spec.split_months);
+    }
+    if (IS.size() < 3 || OS.size() < 2) throw std::runtime_error("IS/OS too short after split");
+
+    // OUTLIERS + OU (IS)
+    {
+        auto clean_IS = remove_outliers(IS).clean;
+        const double dt = spec.bar_seconds > 0 ? measure_dt_years(clean_IS) : (0.5/24.0)/365.0;
+        out.ou = stats::ou_bootstrap(clean_IS, spec.M_boot, spec.alpha, spec.seed, dt);
+    }
+    if (!(out.ou.k > 0.0) || !std::isfinite(out.ou.sigma))
+        throw std::runtime_error("OU calibration failed");
+
+    IS = PriceTable{};   // libera memoria prima della parte OS
+
+    // BANDS
+    out.bands = optimal_trading_bands(spec.M_opt, spec.l, spec.f,
+                                      out.ou.k, out.ou.sigma,
+                                      out.C, spec.alpha, spec.grid);
+    if (!std::isfinite(out.bands.d_estimated) || !std::isfinite(out.bands.u_estimated))
+        throw std::runtime_error("band optimization failed");
+
+    // BACKTEST (OS pulito)
+    const auto clean_OS = remove_outliers(OS).clean;
+    BacktestConfig cfg;
+    cfg.k_hat     = out.ou.k;
+    cfg.eta_hat   = out.ou.eta;
+    cfg.sigma_hat = out.ou.sigma;
+    cfg.d = -std::abs(out.bands.d_estimated);
+    cfg.u =  std::abs(out.bands.u_estimated);
+    cfg.l = spec.l;
+    cfg.f = spec.f;
+    cfg.symmetric = spec.symmetric;
+    out.bt = backtest_os(clean_OS, cfg);
+
+    out.equity_ts.reserve(out.bt.equity.size());
+    for (const auto& p : out.bt.equity)
+        out.equity_ts.emplace_back(iso_to_epoch_seconds(clean_OS[p.idx].Time), p.log_equity);
+
+    out.ok = true;
+    return out;
+}
+
+PortfolioResult run_portfolio(const std::vector<PairSpec>& specs, unsigned n_threads)
+{
+    PortfolioResult R;
+    R.pairs.resize(specs.size());
+
+    // un task indipendente per coppia; gli errori restano nella propria coppia
+    {
+        ThreadPool pool(n_threads);
+        std::vector<std::future<PairOutcome>> futs;
+        futs.reserve(specs.size());
+        for (const auto& s : specs)
+            futs.push_back(pool.submit([&s]{ return run_pair(s); }));
+
+        for (size_t i=0; i<specs.size(); ++i){
+            try {
+                R.pairs[i] = futs[i].get();
+            } catch (const std::exception& ex) {
+                R.pairs[i].name  = specs[i].name;
+                R.pairs[i].ok    = false;
+                R.pairs[i].error = ex.what();
+            }
+        }
+    }
+
+    // merge su griglia comune: eventi (t, coppia, equity) ordinati per tempo
+    struct Event { std::int64_t t; size_t pair; double eq; };
+    std::vector<Event> ev;
+    for (size_t i=0; i<R.pairs.size(); ++i){
+        const auto& P = R.pairs[i];
+        if (!P.ok) { ++R.n_failed; continue; }
+        for (const auto& [t, eq] : P.equity_ts) ev.push_back({t, i, eq});
+    }
+    std::stable_sort(ev.begin(), ev.end(), [](const Event& a, const Event& b){ return a.t < b.t; });
+
+    std::vector<double> cur(R.pairs.size(), 0.0);
+    MetricsAccumulator acc;       // DD e Sharpe sul percorso aggregato
+    double book = 0.0;
+    for (size_t k=0; k<ev.size(); ){
+        const std::int64_t t = ev[k].t;
+        for (; k<ev.size() && ev[k].t == t; ++k){
+            const auto& e = ev[k];
+            const double w = specs[e.pair].weight;
+            book += w * (e.eq - cur[e.pair]);
+            cur[e.pair] = e.eq;
+        }
+        acc.on_close(book - acc.equity);
+        R.time.push_back(t);
+        R.log_equity.push_back(book);
+    }
+
+    R.metrics = acc.finish();
+    // conteggi e PnL medi: sui trade reali delle coppie, non sui passi della griglia
+    size_t n_trades = 0, winners = 0;
+    double sum_pnl = 0.0;
+    for (size_t i=0; i<R.pairs.size(); ++i){
+        const auto& P = R.pairs[i];
+        if (!P.ok) continue;
+        n_trades += P.bt.metrics.n_trades;
+        winners  += P.bt.metrics.winners;
+        sum_pnl  += specs[i].weight * P.bt.metrics.sum_pnl;
+    }
+    R.metrics.n_trades  = n_trades;
+    R.metrics.winners   = winners;
+    R.metrics.hit_ratio = n_trades ? (double)winners / n_trades : 0.0;
+    R.metrics.sum_pnl   = sum_pnl;
+    R.metrics.avg_pnl   = n_trades ? sum_pnl / n_trades : 0.0;
+
+    return R;
+}
+
+} // namespace util
@@ -0,0 +1,139 @@
+#include "utilities/QuantileSketch.hpp"
+#include "utilities/Parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace util {
+
+// ------------------------- KllSketch -------------------------
+KllSketch::KllSketch(std::uint32_t k, std::uint64_t seed)
+    : k_(std::max<std::uint32_t>(k, 8)), rng_(stream_seed(seed, 0)),
+      min_(INFINITY), max_(-INFINITY), levels_(1)
+{}
+
+void KllSketch::clear(){
+    n_ = 0;
+    min_ = INFINITY; max_ = -INFINITY;
+    levels_.assign(1, {});
+}
+
+size_t KllSketch::capacity(size_t level) const {
+    // livello più alto = k, scendendo * (2/3) per livello, minimo 2
+    const size_t depth = levels_.size() - 1 - level;
+    return std::max<size_t>(2, static_cast<size_t>(std::ceil(k_ * std::pow(2.0/3.0, double(depth)))));
+}
+
+size_t KllSketch::retained() const {
+    size_t s = 0;
+    for (const auto& L : levels_) s += L.size();
+    return s;
+}
+
+bool KllSketch::coin(){
+    rng_ = stream_seed(rng_, 0);
+    return rng_ & 1u;
+}
+
+void KllSketch::compress(){
+    for (;;){
+        size_t size = 0, cap = 0;
+        for (size_t h=0; h<levels_.size(); ++h){ size += levels_[h].size(); cap += capacity(h); }
+        if (size <= cap) return;
+
+        // primo livello pieno: metà degli elementi (uno sì e uno no) sale di livello
+        for (size_t h=0; h<levels_.size(); ++h){
+            if (levels_[h].size() < capacity(h)) continue;
+            if (h + 1 == levels_.size()) levels_.emplace_back();
+
+            auto& L  = levels_[h];
+            auto& up = levels_[h+1];
+            std::sort(L.begin(), L.end());
+            const bool odd = (L.size() % 2) != 0;
+            const double spare = odd ? L.back() : 0.0;
+            const size_t even = L.size() - (odd ? 1 : 0);
+            for (size_t i = coin() ? 1 : 0; i < even; i += 2) up.push_back(L[i]);
+            L.clear();
+            if (odd) L.push_back(spare);
+            break;
+        }
+    }
+}
+
+void KllSketch::update(double x){
+    if (std::isnan(x)) return;
+    ++n_;
+    min_ = std::min(min_, x);
+    max_ = std::max(max_, x);
+    levels_[0].push_back(x);
+    if (levels_[0].size() >= capacity(0)) compress();
+}
+
+void KllSketch::merge(const KllSketch& other){
+    if (other.n_ == 0) return;
+    if (levels_.size() < other.levels_.size()) levels_.resize(other.levels_.size());
+    for (size_t h=0; h<other.levels_.size(); ++h)
+        levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+    n_ += other.n_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    compress();
+}
+
+double KllSketch::quantile(double p) const {
+    if (n_ == 0) return NAN;
+    if (p <= 0.0) return min_;
+    if (p >= 1.0) return max_;
+
+    std::vector<std::pair<double, std::uint64_t>> items;
+    items.reserve(retained());
+    for (size_t h=0; h<levels_.size(); ++h)
+        for (double v : levels_[h]) items.emplace_back(v, std::uint64_t(1) << h);
+    std::sort(items.begin(), items.end());
+
+    std::uint64_t W = 0;
+    for (const auto& it : items) W += it.second;
+    const double target = p * double(W);
+    std::uint64_t cum = 0;
+    for (const auto& it : items){
+        cum += it.second;
+        if (double(cum) >= target) return it.first;
+    }
+    return max_;
+}
+
+// ------------------------- RollingQuantileSketch -------------------------
+RollingQuantileSketch::RollingQuantileSketch(size_t window, size_t n_blocks,
+                                             std::uint32_t k, std::uint64_t seed)
+{
+    if (window == 0 || n_blocks == 0)
+        throw std::invalid_argument("RollingQuantileSketch: window and n_blocks must be > 0.");
+    n_blocks  = std::min(n_blocks, window);
+    block_len_ = (window + n_blocks - 1) / n_blocks;
+    blocks_.reserve(n_blocks);
+    for (size_t b=0; b<n_blocks; ++b) blocks_.emplace_back(k, stream_seed(seed, b));
+}
+
+void RollingQuantileSketch::update(double x){
+    if (blocks_[cur_].count() >= block_len_){
+        cur_ = (cur_ + 1) % blocks_.size();
+        blocks_[cur_].clear();      // scade il blocco più vecchio
+    }
+    blocks_[cur_].update(x);
+}
+
+KllSketch RollingQuantileSketch::merged() const {
+    KllSketch out = blocks_[cur_];
+    for (size_t b=0; b<blocks_.size(); ++b)
+        if (b != cur_) out.merge(blocks_[b]);
+    return out;
+}
+
+std::uint64_t RollingQuantileSketch::count() const {
+    std::uint64_t n = 0;
+    for (const auto& b : blocks_) n += b.count();
+    return n;
+}
+
+} // namespace util
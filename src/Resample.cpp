@@ -0,0 +1,129 @@
+#include "utilities/Resample.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+namespace util {
+
+namespace {
+
+// divisione intera con floor anche per t < origin
+inline std::int64_t floor_div(std::int64_t a, std::int64_t b){
+    std::int64_t q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) --q;
+    return q;
+}
+
+constexpr double SECONDS_PER_YEAR = 365.0 * 86400.0;
+
+} // anon
+
+BarResampler::BarResampler(const ResampleConfig& cfg) : cfg_(cfg) {
+    if (cfg_.bar_seconds <= 0) throw std::invalid_argument("BarResampler: bar_seconds must be > 0.");
+}
+
+void BarResampler::on_tick(std::int64_t t, const PriceRow& q){
+    if (t == INT64_MIN) return;                         // timestamp non valido
+    const std::int64_t b = floor_div(t - cfg_.origin, cfg_.bar_seconds);
+
+    if (open_ && b < bucket_) { ++out_.n_late; return; }
+    if (open_ && b > bucket_) close_bar();
+    if (!open_){
+        open_ = true; bucket_ = b; n_ = 0;
+        sum_m1_ = sum_m2_ = 0.0; cnt_m1_ = cnt_m2_ = 0;
+        last_m1_ = last_m2_ = 0.0;
+        q1_ = q2_ = false;
+        spr1_ = spr2_ = 0.0;
+        b1_ = a1_ = b2_ = a2_ = 0.0;
+    }
+
+    ++n_;
+    // tick di un feed irregolare: può mancare la quota di una gamba (mid 0)
+    if (q.Mid1 > 0.0) { sum_m1_ += q.Mid1; ++cnt_m1_; last_m1_ = q.Mid1; }
+    if (q.Mid2 > 0.0) { sum_m2_ += q.Mid2; ++cnt_m2_; last_m2_ = q.Mid2; }
+    if (q.Bid1 > 0.0 && q.Ask1 >= q.Bid1){
+        const double s = q.Ask1 - q.Bid1;
+        if (!q1_ || s < spr1_) { q1_ = true; spr1_ = s; b1_ = q.Bid1; a1_ = q.Ask1; }
+    }
+    if (q.Bid2 > 0.0 && q.Ask2 >= q.Bid2){
+        const double s = q.Ask2 - q.Bid2;
+        if (!q2_ || s < spr2_) { q2_ = true; spr2_ = s; b2_ = q.Bid2; a2_ = q.Ask2; }
+    }
+}
+
+void BarResampler::close_bar(){
+    open_ = false;
+    // senza un mid valido su entrambe le gambe la barra non ha spread: niente riga
+    // (un Rt=0 finirebbe in remove_outliers / ou_bootstrap come osservazione vera)
+    if (cnt_m1_ == 0 || cnt_m2_ == 0) { ++out_.n_unpriced; return; }
+
+    PriceRow r;
+    r.Time = epoch_seconds_to_iso(cfg_.origin + bucket_ * cfg_.bar_seconds);
+    if (cfg_.mid == MidAgg::Mean){
+        r.Mid1 = sum_m1_ / cnt_m1_;
+        r.Mid2 = sum_m2_ / cnt_m2_;
+    } else {
+        r.Mid1 = last_m1_;
+        r.Mid2 = last_m2_;
+    }
+    r.Bid1 = b1_; r.Ask1 = a1_;
+    r.Bid2 = b2_; r.Ask2 = a2_;
+    r.Rt = std::log(r.Mid1 / r.Mid2);
+
+    out_.bars.push_back(std::move(r));
+    out_.tick_count.push_back(n_);
+}
+
+BarTable BarResampler::finish(){
+    if (open_) close_bar();
+    out_.dt = measure_dt_years(out_.bars);
+    BarTable res = std::move(out_);
+    out_ = BarTable{};
+    return res;
+}
+
+std::vector<BarTable> resample_ticks(const PriceTable& ticks,
+                                     const std::vector<ResampleConfig>& cfgs)
+{
+    std::vector<BarResampler> rs;
+    rs.reserve(cfgs.size());
+    for (const auto& c : cfgs) rs.emplace_back(c);
+
+    for (const auto& q : ticks){
+        const std::int64_t t = iso_to_epoch_seconds(q.Time);   // una sola volta per tick
+        for (auto& r : rs) r.on_tick(t, q);
+    }
+
+    std::vector<BarTable> out;
+    out.reserve(rs.size());
+    for (auto& r : rs) out.push_back(r.finish());
+    return out;
+}
+
+BarTable resample_ticks(const PriceTable& ticks, const ResampleConfig& cfg){
+    return std::move(resample_ticks(ticks, std::vector<ResampleConfig>{cfg}).front());
+}
+
+double measure_dt_years(const std::vector<std::int64_t>& t){
+    std::vector<std::int64_t> gaps;
+    gaps.reserve(t.size());
+    for (size_t i=1; i<t.size(); ++i){
+        if (t[i] == INT64_MIN || t[i-1] == INT64_MIN) continue;
+        const std::int64_t g = t[i] - t[i-1];
+        if (g > 0) gaps.push_back(g);
+    }
+    if (gaps.empty()) return 0.0;
+    auto mid = gaps.begin() + gaps.size()/2;
+    std::nth_element(gaps.begin(), mid, gaps.end());
+    return static_cast<double>(*mid) / SECONDS_PER_YEAR;
+}
+
+double measure_dt_years(const PriceTable& data){
+    std::vector<std::int64_t> t;
+    t.reserve(data.size());
+    for (const auto& r : data) t.push_back(iso_to_epoch_seconds(r.Time));
+    return measure_dt_years(t);
+}
+
+} // namespace util
@@ -0,0 +1,273 @@
+#include "utilities/ResultStore.hpp"
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace util {
+
+namespace {
+
+constexpr char MAGIC[8] = {'A','R','B','R','S','T','1','\0'};
+constexpr std::uint32_t VERSION = 1;
+constexpr size_t HEADER_BYTES = 4096;
+constexpr size_t MAX_COLS = 64;
+
+struct ColumnDesc {
+    char name[40];
+    std::uint32_t type;
+    std::uint32_t pad;
+};
+
+// primi HEADER_BYTES del file
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t n_cols;
+    char record_type[48];
+    std::uint64_t chunk_records;
+    std::uint64_t n_chunks;
+    std::uint64_t next_chunk;       // atomico: chunk già assegnati
+    std::uint64_t data_offset;
+    ColumnDesc cols[MAX_COLS];
+};
+static_assert(sizeof(FileHeader) <= HEADER_BYTES, "header must fit in one page");
+static_assert(std::atomic_ref<std::uint64_t>::is_always_lock_free, "need lock-free 64-bit atomics");
+
+size_t round_up(size_t x, size_t a){ return (x + a - 1) / a * a; }
+
+[[noreturn]] void sys_fail(const std::string& what, const std::string& path){
+    throw std::runtime_error(what + " (" + path + "): " + std::strerror(errno));
+}
+
+} // anon
+
+// ------------------------- writer side -------------------------
+ResultStore::ResultStore(const std::string& path, const StoreSchema& schema,
+                         std::uint64_t max_records, std::uint64_t chunk_records,
+                         unsigned max_writers)
+    : schema_(schema)
+{
+    if (schema.columns.empty() || schema.columns.size() > MAX_COLS)
+        throw std::runtime_error("ResultStore: schema needs 1.." + std::to_string(MAX_COLS) + " columns.");
+    if (schema.record_type.size() >= 48) throw std::runtime_error("ResultStore: record_type too long.");
+    for (const auto& c : schema.columns)
+        if (c.name.size() >= 40) throw std::runtime_error("ResultStore: column name too long: " + c.name);
+
+    n_cols_        = schema.columns.size();
+    chunk_records_ = round_up(std::max<std::uint64_t>(chunk_records, 1), 512);  // chunk allineati a pagina
+    // + un chunk parziale per writer: ognuno lascia al più un chunk non pieno
+    n_chunks_      = (max_records + chunk_records_ - 1) / chunk_records_ + std::max(max_writers, 1u);
+
+    const size_t counts_bytes = round_up(n_chunks_ * 8, HEADER_BYTES);
+    const size_t data_offset  = HEADER_BYTES + counts_bytes;
+    map_len_ = data_offset + n_chunks_ * n_cols_ * chunk_records_ * 8;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) sys_fail("ResultStore: cannot create", path);
+    if (::ftruncate(fd_, static_cast<off_t>(map_len_)) != 0) sys_fail("ResultStore: ftruncate", path);  // sparso
+
+    void* p = ::mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) sys_fail("ResultStore: mmap", path);
+    map_ = static_cast<unsigned char*>(p);
+
+    auto* h = reinterpret_cast<FileHeader*>(map_);
+    std::memcpy(h->magic, MAGIC, 8);
+    h->version = VERSION;
+    h->n_cols  = static_cast<std::uint32_t>(n_cols_);
+    std::strncpy(h->record_type, schema.record_type.c_str(), sizeof(h->record_type) - 1);
+    h->chunk_records = chunk_records_;
+    h->n_chunks      = n_chunks_;
+    h->next_chunk    = 0;
+    h->data_offset   = data_offset;
+    for (size_t c=0; c<n_cols_; ++c){
+        std::strncpy(h->cols[c].name, schema.columns[c].name.c_str(), sizeof(h->cols[c].name) - 1);
+        h->cols[c].type = static_cast<std::uint32_t>(schema.columns[c].type);
+    }
+
+    next_chunk_ = &h->next_chunk;
+    counts_     = reinterpret_cast<std::uint64_t*>(map_ + HEADER_BYTES);
+}
+
+ResultStore::~ResultStore(){
+    if (map_) ::munmap(map_, map_len_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void ResultStore::sync(){
+    if (map_ && ::msync(map_, map_len_, MS_SYNC) != 0)
+        throw std::runtime_error(std::string("ResultStore: msync: ") + std::strerror(errno));
+}
+
+unsigned char* ResultStore::chunk_base(std::uint64_t c) const {
+    const auto* h = reinterpret_cast<const FileHeader*>(map_);
+    return map_ + h->data_offset + c * n_cols_ * chunk_records_ * 8;
+}
+
+ResultStore::Writer& ResultStore::Writer::operator=(Writer&& o) noexcept {
+    store_ = o.store_; chunk_ = o.chunk_; used_ = o.used_;
+    has_chunk_ = o.has_chunk_; written_ = o.written_;
+    o.store_ = nullptr; o.has_chunk_ = false;
+    return *this;
+}
+
+void ResultStore::evict(std::uint64_t c) const {
+    // chunk allineati a pagina (data_offset e chunk_records multipli di 512 slot)
+    ::madvise(chunk_base(c), n_cols_ * chunk_records_ * 8, MADV_DONTNEED);
+}
+
+void ResultStore::Writer::claim_chunk(){
+    if (has_chunk_) store_->evict(chunk_);     // chunk pieno: non verrà più scritto
+    // unico punto condiviso fra i writer: un fetch_add sul contatore dell'header
+    const std::uint64_t c = std::atomic_ref<std::uint64_t>(*store_->next_chunk_)
+                                .fetch_add(1, std::memory_order_relaxed);
+    if (c >= store_->n_chunks_)
+        throw std::runtime_error("ResultStore: full (capacity " +
+                                 std::to_string(store_->capacity()) + " records).");
+    chunk_ = c; used_ = 0; has_chunk_ = true;
+}
+
+void ResultStore::Writer::append(const Slot* values, size_t n){
+    if (!store_) throw std::runtime_error("ResultStore::Writer: not attached to a store.");
+    if (n != store_->n_cols_)
+        throw std::runtime_error("ResultStore: record has " + std::to_string(n) +
+                                 " fields, schema has " + std::to_string(store_->n_cols_));
+    if (!has_chunk_ || used_ == store_->chunk_records_) claim_chunk();
+
+    unsigned char* base = store_->chunk_base(chunk_);
+    const std::uint64_t stride = store_->chunk_records_ * 8;
+    for (size_t c=0; c<n; ++c)
+        std::memcpy(base + c * stride + used_ * 8, &values[c].bits, 8);
+
+    ++used_;
+    ++written_;
+    // pubblica il record: chi legge count con acquire vede i dati scritti sopra
+    std::atomic_ref<std::uint64_t>(store_->counts_[chunk_]).store(used_, std::memory_order_release);
+}
+
+void ResultStore::Writer::append(std::initializer_list<Slot> values){
+    append(values.begin(), values.size());
+}
+
+// ------------------------- reader side -------------------------
+ResultStoreReader::ResultStoreReader(const std::string& path){
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) sys_fail("ResultStoreReader: cannot open", path);
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) sys_fail("ResultStoreReader: fstat", path);
+    map_len_ = static_cast<size_t>(st.st_size);
+    if (map_len_ < HEADER_BYTES) throw std::runtime_error("ResultStoreReader: not a result store: " + path);
+
+    void* p = ::mmap(nullptr, map_len_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) sys_fail("ResultStoreReader: mmap", path);
+    map_ = static_cast<const unsigned char*>(p);
+
+    const auto* h = reinterpret_cast<const FileHeader*>(map_);
+    if (std::memcmp(h->magic, MAGIC, 8) != 0 || h->version != VERSION || h->n_cols == 0 || h->n_cols > MAX_COLS)
+        throw std::runtime_error("ResultStoreReader: bad header: " + path);
+
+    n_cols_        = h->n_cols;
+    chunk_records_ = h->chunk_records;
+    n_chunks_      = h->n_chunks;
+    data_offset_   = h->data_offset;
+    if (data_offset_ + n_chunks_ * n_cols_ * chunk_records_ * 8 > map_len_)
+        throw std::runtime_error("ResultStoreReader: truncated file: " + path);
+
+    schema_.record_type = std::string(h->record_type, strnlen(h->record_type, sizeof(h->record_type)));
+    for (size_t c=0; c<n_cols_; ++c){
+        StoreColumn col;
+        col.name = std::string(h->cols[c].name, strnlen(h->cols[c].name, sizeof(h->cols[c].name)));
+        col.type = static_cast<SlotType>(h->cols[c].type);
+        schema_.columns.push_back(std::move(col));
+    }
+    next_chunk_ = &h->next_chunk;
+    counts_     = reinterpret_cast<const std::uint64_t*>(map_ + HEADER_BYTES);
+}
+
+ResultStoreReader::~ResultStoreReader(){
+    if (map_) ::munmap(const_cast<unsigned char*>(map_), map_len_);
+    if (fd_ >= 0) ::close(fd_);
+}
+
+int ResultStoreReader::column(std::string_view name) const {
+    for (size_t c=0; c<schema_.columns.size(); ++c)
+        if (schema_.columns[c].name == name) return static_cast<int>(c);
+    return -1;
+}
+
+size_t ResultStoreReader::n_chunks() const {
+    const auto claimed = std::atomic_ref<std::uint64_t>(*const_cast<std::uint64_t*>(next_chunk_))
+                             .load(std::memory_order_relaxed);
+    return static_cast<size_t>(std::min(claimed, n_chunks_));
+}
+
+ResultStoreReader::Chunk ResultStoreReader::chunk(size_t i) const {
+    Chunk c;
+    c.stride = chunk_records_ * 8;
+    c.base   = map_ + data_offset_ + i * n_cols_ * c.stride;
+    c.n      = static_cast<size_t>(std::atomic_ref<std::uint64_t>(*const_cast<std::uint64_t*>(&counts_[i]))
+                                       .load(std::memory_order_acquire));
+    return c;
+}
+
+void ResultStoreReader::evict(size_t i) const {
+    const size_t bytes = n_cols_ * chunk_records_ * 8;
+    ::madvise(const_cast<unsigned char*>(map_ + data_offset_ + i * bytes), bytes, MADV_DONTNEED);
+}
+
+size_t ResultStoreReader::size() const {
+    size_t n = 0;
+    for (size_t i=0; i<n_chunks(); ++i) n += chunk(i).n;
+    return n;
+}
+
+// ------------------------- schemi -------------------------
+StoreSchema backtest_metrics_schema(){
+    using T = SlotType;
+    return {"BacktestMetrics", {
+        {"config_id", T::I64}, {"n_trades", T::I64}, {"winners", T::I64},
+        {"hit_ratio"}, {"sum_pnl"}, {"avg_pnl"}, {"equity_end"}, {"max_dd"}, {"sharpe_bar"}
+    }};
+}
+
+void append_record(ResultStore::Writer& w, std::int64_t config_id, const BacktestMetrics& m){
+    w.append({config_id, m.n_trades, m.winners,
+              m.hit_ratio, m.sum_pnl, m.avg_pnl, m.equity_end, m.max_dd, m.sharpe_bar});
+}
+
+StoreSchema optimal_bands_schema(){
+    return {"OptimalBandsResult", {
+        {"config_id", SlotType::I64},
+        {"d"}, {"d_lo"}, {"d_hi"},
+        {"u"}, {"u_lo"}, {"u_hi"},
+        {"mu"}, {"mu_lo"}, {"mu_hi"},
+        {"f"}, {"f_lo"}, {"f_hi"}, {"f_input"}
+    }};
+}
+
+void append_record(ResultStore::Writer& w, std::int64_t config_id, const OptimalBandsResult& b){
+    w.append({config_id,
+              b.d_estimated, b.d_CI[0], b.d_CI[1],
+              b.u_estimated, b.u_CI[0], b.u_CI[1],
+              b.mu_estimated, b.mu_CI[0], b.mu_CI[1],
+              b.f_estimated, b.f_opt_CI[0], b.f_opt_CI[1], b.f_input});
+}
+
+StoreSchema ou_bootstrap_samples_schema(){
+    return {"OUBootstrapSample", {
+        {"config_id", SlotType::I64}, {"replicate", SlotType::I64},
+        {"k"}, {"eta"}, {"sigma"}
+    }};
+}
+
+void append_samples(ResultStore::Writer& w, std::int64_t config_id, const stats::OUBootstrapResult& r){
+    const size_t n = std::min({r.boot_k.size(), r.boot_eta.size(), r.boot_sigma.size()});
+    for (size_t i=0; i<n; ++i)
+        w.append({config_id, i, r.boot_k[i], r.boot_eta[i], r.boot_sigma[i]});
+}
+
+} // namespace util
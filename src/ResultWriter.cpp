@@ -0,0 +1,162 @@
+#include "utilities/ResultWriter.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace util {
+
+CsvWriter::CsvWriter(const std::string& path, CsvSchema schema, WriterOptions opt)
+    : schema_(std::move(schema)), opt_(opt),
+      out_(path, std::ios::binary | std::ios::trunc)
+{
+    open_ = out_.is_open();
+    if (!open_) return;
+    opt_.buffer_bytes  = std::max<size_t>(opt_.buffer_bytes, 4096);
+    opt_.max_in_flight = std::max<size_t>(opt_.max_in_flight, 1);
+    cur_.reserve(opt_.buffer_bytes);
+
+    for (size_t c=0; c<schema_.size(); ++c){
+        if (c) cur_.push_back(',');
+        cur_.append(schema_[c].name);
+    }
+    cur_.push_back('\n');
+
+    if (opt_.background) io_ = std::thread([this]{ writer_loop(); });
+}
+
+CsvWriter::~CsvWriter(){ close(); }
+
+void CsvWriter::sep(){
+    if (col_ >= schema_.size())
+        throw std::logic_error("CsvWriter: too many fields in row (schema has " +
+                               std::to_string(schema_.size()) + ")");
+    if (col_) cur_.push_back(',');
+}
+
+char* CsvWriter::reserve(size_t n){
+    if (cur_.size() + n > cur_.capacity() && cur_.size() >= opt_.buffer_bytes / 2) hand_off();
+    const size_t old = cur_.size();
+    cur_.resize(old + n);
+    return cur_.data() + old;
+}
+
+CsvWriter& CsvWriter::add(double x){
+    if (!open_) return *this;
+    sep();
+    const Column& c = schema_[col_++];
+
+    if (c.fmt == ColFmt::Fixed && !std::isfinite(x)) return *this;   // campo vuoto
+    // fixed con |x| enorme può servire fino a ~310 cifre intere
+    const size_t room = (c.fmt != ColFmt::Fixed) ? 64
+                      : (std::fabs(x) < 1e15 ? 24 : 330) + size_t(std::max(c.precision, 0));
+    char* p = reserve(room);
+    std::to_chars_result r;
+    switch (c.fmt){
+        case ColFmt::Fixed:   r = std::to_chars(p, p + room, x, std::chars_format::fixed, c.precision); break;
+        case ColFmt::General: r = std::to_chars(p, p + room, x, std::chars_format::general, c.precision); break;
+        case ColFmt::Int:     r = std::to_chars(p, p + room, static_cast<std::int64_t>(x)); break;
+        default:              r = std::to_chars(p, p + room, x); break;
+    }
+    cur_.resize(static_cast<size_t>(r.ptr - cur_.data()));
+    return *this;
+}
+
+CsvWriter& CsvWriter::add(std::int64_t x){
+    if (!open_) return *this;
+    if (col_ < schema_.size() &&
+        (schema_[col_].fmt == ColFmt::Fixed || schema_[col_].fmt == ColFmt::General))
+        return add(static_cast<double>(x));
+    sep();
+    ++col_;
+    char* p = reserve(24);
+    auto r = std::to_chars(p, p + 24, x);
+    cur_.resize(static_cast<size_t>(r.ptr - cur_.data()));
+    return *this;
+}
+
+CsvWriter& CsvWriter::add(std::string_view s){
+    if (!open_) return *this;
+    sep();
+    ++col_;
+    char* p = reserve(s.size());
+    std::memcpy(p, s.data(), s.size());
+    return *this;
+}
+
+void CsvWriter::end_row(){
+    if (!open_) return;
+    if (col_ != schema_.size())
+        throw std::logic_error("CsvWriter: row has " + std::to_string(col_) +
+                               " fields, schema has " + std::to_string(schema_.size()));
+    cur_.push_back('\n');
+    col_ = 0;
+    ++rows_;
+    if (cur_.size() >= opt_.buffer_bytes) hand_off();
+}
+
+void CsvWriter::hand_off(){
+    if (cur_.empty()) return;
+    if (!opt_.background){
+        out_.write(cur_.data(), static_cast<std::streamsize>(cur_.size()));
+        if (!out_) failed_ = true;
+        cur_.clear();
+        return;
+    }
+
+    std::string next;
+    {
+        std::unique_lock<std::mutex> lk(m_);
+        // backpressure: al massimo max_in_flight blocchi in coda
+        cv_.wait(lk, [&]{ return full_.size() < opt_.max_in_flight; });
+        full_.push_back(std::move(cur_));
+        if (!free_.empty()) { next = std::move(free_.back()); free_.pop_back(); }
+    }
+    cv_.notify_all();
+    next.clear();
+    if (next.capacity() < opt_.buffer_bytes) next.reserve(opt_.buffer_bytes);
+    cur_ = std::move(next);
+}
+
+void CsvWriter::writer_loop(){
+    for (;;){
+        std::string blk;
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            cv_.wait(lk, [&]{ return stop_ || !full_.empty(); });
+            if (full_.empty()) return;          // stop_ e coda vuota
+            blk = std::move(full_.front());
+            full_.pop_front();
+        }
+        cv_.notify_all();                       // sblocca un producer in attesa
+
+        out_.write(blk.data(), static_cast<std::streamsize>(blk.size()));
+        const bool bad = !out_;
+
+        std::lock_guard<std::mutex> lk(m_);
+        if (bad) failed_ = true;
+        if (free_.size() < opt_.max_in_flight) free_.push_back(std::move(blk));
+    }
+}
+
+bool CsvWriter::close(){
+    if (!open_) return false;
+    if (col_ != 0) { cur_.push_back('\n'); col_ = 0; }   // riga parziale: chiusa così com'è
+    hand_off();
+    if (io_.joinable()){
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        io_.join();
+    }
+    out_.flush();
+    if (!out_) failed_ = true;
+    out_.close();
+    open_ = false;
+    return !failed_;
+}
+
+} // namespace util
@@ -0,0 +1,93 @@
+#include "utilities/RollingOU.hpp"
+#include <cmath>
+#include <stdexcept>
+
+namespace stats {
+
+RollingOUEstimator::RollingOUEstimator(size_t window, double dt)
+    : window_(window), dt_(dt), ring_(window + 1)
+{
+    if (window < 2) throw std::invalid_argument("RollingOUEstimator: window must be >= 2.");
+    if (!(dt > 0.0)) throw std::invalid_argument("RollingOUEstimator: dt must be > 0.");
+}
+
+void RollingOUEstimator::reset(){
+    head_ = n_points_ = n_pairs_ = 0;
+    has_ref_ = false; ref_ = 0.0;
+    sum_m_ = sum_p_ = sum_mm_ = sum_pp_ = sum_pm_ = NeumaierSum{};
+}
+
+void RollingOUEstimator::add(double x_raw){
+    if (!has_ref_) { ref_ = x_raw; has_ref_ = true; }
+    const double x = x_raw - ref_;
+    const size_t cap = ring_.size();
+
+    if (n_points_ > 0){
+        // nuova coppia (ultimo punto, x)
+        const double xm = ring_[(head_ + n_points_ - 1) % cap];
+        sum_m_.add(xm);        sum_p_.add(x);
+        sum_mm_.add(xm*xm);    sum_pp_.add(x*x);
+        sum_pm_.add(xm*x);
+        ++n_pairs_;
+    }
+
+    if (n_points_ == cap){
+        // esce la coppia più vecchia (x0, x1)
+        const double x0 = ring_[head_];
+        const double x1 = ring_[(head_ + 1) % cap];
+        sum_m_.add(-x0);       sum_p_.add(-x1);
+        sum_mm_.add(-x0*x0);   sum_pp_.add(-x1*x1);
+        sum_pm_.add(-x0*x1);
+        --n_pairs_;
+        ring_[head_] = x;
+        head_ = (head_ + 1) % cap;
+    } else {
+        ring_[(head_ + n_points_) % cap] = x;
+        ++n_points_;
+    }
+}
+
+RollingOUEstimate RollingOUEstimator::estimate() const {
+    RollingOUEstimate R;
+    R.ready = ready();
+    if (n_pairs_ < 2) return R;
+
+    const size_t cap = ring_.size();
+    OUSums S;
+    S.N      = n_pairs_;
+    S.sum_m  = sum_m_.value();
+    S.sum_p  = sum_p_.value();
+    S.sum_mm = sum_mm_.value();
+    S.sum_pp = sum_pp_.value();
+    S.sum_pm = sum_pm_.value();
+    S.x_first = ring_[head_];
+    S.x_last  = ring_[(head_ + n_points_ - 1) % cap];
+
+    const auto E = ou_mle_from_sums(S, dt_);
+    R.k     = E.k;
+    R.eta   = E.eta + ref_;
+    R.sigma = E.sigma;
+    R.rho   = E.rho;
+    R.sigma_stat = E.sigma / std::sqrt(2.0 * E.k);
+    R.half_life  = std::log(2.0) / E.k;
+    return R;
+}
+
+util::OUParamPath rolling_ou_path(const util::PriceTable& data, size_t window, double dt)
+{
+    util::OUParamPath P;
+    P.eta.assign(data.size(), NAN);
+    P.sigma_stat.assign(data.size(), NAN);
+
+    RollingOUEstimator est(window, dt);
+    for (size_t i=0; i<data.size(); ++i){
+        est.add(data[i].Rt);
+        if (!est.ready()) continue;
+        const auto E = est.estimate();
+        P.eta[i]        = E.eta;
+        P.sigma_stat[i] = E.sigma_stat;
+    }
+    return P;
+}
+
+} // namespace stats
@@ -0,0 +1,71 @@
+#include "utilities/RunOutputs.hpp"
+#include "utilities/ResultWriter.hpp"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace util {
+
+std::string fmt6(double x){
+    std::ostringstream oss;
+    if (std::isfinite(x)) oss << std::fixed << std::setprecision(6) << x;
+    return oss.str();
+}
+
+bool write_bands_csv(const std::string& path, const std::vector<BandsRow>& rows){
+    const auto F6 = ColFmt::Fixed;
+    const auto TX = ColFmt::Text;
+    CsvWriter fout(path, {
+        {"Stop-loss", F6}, {"Leverage", TX},
+        {"d*", F6}, {"d_CI_low", F6}, {"d_CI_high", F6},
+        {"u*", F6}, {"u_CI_low", F6}, {"u_CI_high", F6},
+        {"mu", F6}, {"mu_CI_low", F6}, {"mu_CI_high", F6},
+        {"f*", TX}, {"f_CI_low", TX}, {"f_CI_high", TX}
+    });
+    if (!fout.is_open()) return false;
+    for (const auto& r : rows){
+        const auto& b = r.bands;
+        const bool opt = (r.f_label == "opt");
+        fout.add(r.l).add(r.f_label)
+            .add(b.d_estimated).add(b.d_CI[0]).add(b.d_CI[1])
+            .add(b.u_estimated).add(b.u_CI[0]).add(b.u_CI[1])
+            .add(b.mu_estimated).add(b.mu_CI[0]).add(b.mu_CI[1])
+            .add(opt ? fmt6(b.f_estimated) : std::string())
+            .add(opt ? fmt6(b.f_opt_CI[0]) : std::string())
+            .add(opt ? fmt6(b.f_opt_CI[1]) : std::string());
+        fout.end_row();
+    }
+    return fout.close();
+}
+
+bool write_trades_csv(const std::string& path, const BacktestResult& bt, const PriceTable& clean_OS){
+    CsvWriter ft(path, {
+        {"entry_time", ColFmt::Text}, {"exit_time", ColFmt::Text},
+        {"z_entry"}, {"z_exit"}, {"x_entry"}, {"x_exit"},
+        {"f"}, {"costs"}, {"pnl"}, {"bars", ColFmt::Int}
+    });
+    if (!ft.is_open()) return false;
+    for (const auto& t : bt.trades){
+        ft.add(clean_OS[t.entry_idx].Time).add(clean_OS[t.exit_idx].Time)
+          .add(t.z_entry).add(t.z_exit)
+          .add(t.x_entry).add(t.x_exit)
+          .add(t.f).add(t.costs)
+          .add(t.pnl).add(t.bars);
+        ft.end_row();
+    }
+    return ft.close();
+}
+
+bool write_equity_csv(const std::string& path, const BacktestResult& bt, const PriceTable& clean_OS){
+    CsvWriter fe(path, {{"time", ColFmt::Text}, {"log_equity"}});
+    if (!fe.is_open()) return false;
+    // equity sparsa (un punto per trade): espansa sulle barre OS
+    const auto eq = dense_equity(bt, clean_OS.size());
+    for (size_t i=0; i<eq.size(); ++i){
+        fe.add(clean_OS[i].Time).add(eq[i]);
+        fe.end_row();
+    }
+    return fe.close();
+}
+
+} // namespace util
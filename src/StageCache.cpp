@@ -0,0 +1,264 @@
+#include "utilities/StageCache.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace util {
+
+namespace {
+
+constexpr char MAGIC[8] = {'A','R','B','C','A','C','H','E'};
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+// layout delle struct copiate byte per byte: se cambia, le voci vecchie non valgono più
+constexpr std::uint32_t LAYOUT = static_cast<std::uint32_t>(
+    sizeof(Trade) * 1000003u + sizeof(EquityPoint) * 10007u + sizeof(BacktestMetrics) * 101u +
+    sizeof(OptimalBandsResult) * 7u + sizeof(MetricCI));
+
+trace::Counter c_hits("cache_hits");
+trace::Counter c_misses("cache_misses");
+
+inline std::uint64_t mul_xs(std::uint64_t h, std::uint64_t w, std::uint64_t m){
+    h = (h ^ w) * m;
+    return h ^ (h >> 29);
+}
+
+inline std::uint64_t fmix(std::uint64_t z){
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t checksum(const std::string& s){
+    Hasher h;
+    h.add_bytes(s.data(), s.size());
+    return h.key().lo;
+}
+
+} // anon
+
+// ------------------------- hash -------------------------
+std::string CacheKey::hex() const {
+    char buf[33];
+    std::snprintf(buf, sizeof(buf), "%016llx%016llx",
+                  static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+    return buf;
+}
+
+void Hasher::mix(std::uint64_t w){
+    a_ = mul_xs(a_, w, 0x9E3779B97F4A7C15ULL);
+    b_ = mul_xs(b_, w + 0x632BE59BD9B4E019ULL, 0xD6E8FEB86659FD93ULL);
+}
+
+Hasher& Hasher::add_bytes(const void* p, size_t n){
+    const auto* c = static_cast<const unsigned char*>(p);
+    n_ += n;
+    // completa la coda
+    if (tail_n_){
+        const size_t take = std::min<size_t>(8 - tail_n_, n);
+        std::memcpy(tail_ + tail_n_, c, take);
+        tail_n_ += static_cast<unsigned>(take); c += take; n -= take;
+        if (tail_n_ < 8) return *this;
+        std::uint64_t w; std::memcpy(&w, tail_, 8);
+        mix(w);
+        tail_n_ = 0;
+    }
+    for (; n >= 8; c += 8, n -= 8){
+        std::uint64_t w; std::memcpy(&w, c, 8);
+        mix(w);
+    }
+    std::memcpy(tail_, c, n);
+    tail_n_ = static_cast<unsigned>(n);
+    return *this;
+}
+
+Hasher& Hasher::add(const PriceTable& t){
+    add(static_cast<std::uint64_t>(t.size()));
+    for (const auto& r : t){
+        add(r.Time);
+        const double v[7] = {r.Bid1, r.Ask1, r.Mid1, r.Bid2, r.Ask2, r.Mid2, r.Rt};
+        add_bytes(v, sizeof(v));
+    }
+    return *this;
+}
+
+Hasher& Hasher::add_file(const std::string& path){
+    std::ifstream f(path, std::ios::binary);
+    if (!f) throw std::runtime_error("StageCache: cannot hash " + path);
+    std::vector<char> buf(1 << 16);
+    std::uint64_t total = 0;
+    while (f){
+        f.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        const auto got = static_cast<size_t>(f.gcount());
+        add_bytes(buf.data(), got);
+        total += got;
+    }
+    return add(total);
+}
+
+CacheKey Hasher::key() const {
+    std::uint64_t a = a_, b = b_;
+    if (tail_n_){
+        std::uint64_t w = 0;
+        std::memcpy(&w, tail_, tail_n_);
+        a = mul_xs(a, w, 0x9E3779B97F4A7C15ULL);
+        b = mul_xs(b, w + 0x632BE59BD9B4E019ULL, 0xD6E8FEB86659FD93ULL);
+    }
+    return { fmix(a ^ n_), fmix(b + (a ^ (n_ << 1))) };
+}
+
+// ------------------------- serializzazione -------------------------
+void save(BinWriter& w, double v){ w.pod(v); }
+void load(BinReader& r, double& v){ r.pod(v); }
+
+void save(BinWriter& w, const PriceTable& t){
+    w.pod<std::uint64_t>(t.size());
+    for (const auto& x : t){
+        w.str(x.Time);
+        const double v[7] = {x.Bid1, x.Ask1, x.Mid1, x.Bid2, x.Ask2, x.Mid2, x.Rt};
+        w.bytes(v, sizeof(v));
+    }
+}
+
+void load(BinReader& r, PriceTable& t){
+    std::uint64_t n = 0;
+    r.pod(n);
+    t.clear();
+    t.reserve(static_cast<size_t>(std::min<std::uint64_t>(n, 1u << 24)));
+    for (std::uint64_t i=0; i<n; ++i){
+        PriceRow x;
+        r.str(x.Time);
+        double v[7];
+        r.bytes(v, sizeof(v));
+        x.Bid1 = v[0]; x.Ask1 = v[1]; x.Mid1 = v[2];
+        x.Bid2 = v[3]; x.Ask2 = v[4]; x.Mid2 = v[5]; x.Rt = v[6];
+        t.push_back(std::move(x));
+    }
+}
+
+void save(BinWriter& w, const OutlierResult& o){
+    save(w, o.clean);
+    std::vector<unsigned char> flags(o.is_outlier.begin(), o.is_outlier.end());
+    w.pod_vec(flags);
+    save(w, o.outliers);
+}
+
+void load(BinReader& r, OutlierResult& o){
+    load(r, o.clean);
+    std::vector<unsigned char> flags;
+    r.pod_vec(flags);
+    o.is_outlier.assign(flags.begin(), flags.end());
+    load(r, o.outliers);
+}
+
+void save(BinWriter& w, const stats::OUBootstrapResult& R){
+    w.pod(R.k); w.pod(R.eta); w.pod(R.sigma); w.pod(R.dt);
+    w.pod_vec(R.boot_k); w.pod_vec(R.boot_eta); w.pod_vec(R.boot_sigma);
+    w.pod(R.CI_k); w.pod(R.CI_eta); w.pod(R.CI_sigma);
+}
+
+void load(BinReader& r, stats::OUBootstrapResult& R){
+    r.pod(R.k); r.pod(R.eta); r.pod(R.sigma); r.pod(R.dt);
+    r.pod_vec(R.boot_k); r.pod_vec(R.boot_eta); r.pod_vec(R.boot_sigma);
+    r.pod(R.CI_k); r.pod(R.CI_eta); r.pod(R.CI_sigma);
+}
+
+void save(BinWriter& w, const OptimalBandsResult& b){ w.pod(b); }
+void load(BinReader& r, OptimalBandsResult& b){ r.pod(b); }
+
+void save(BinWriter& w, const BacktestResult& R){
+    w.pod(R.metrics);
+    w.pod_vec(R.trades);
+    w.pod_vec(R.equity);
+}
+
+void load(BinReader& r, BacktestResult& R){
+    r.pod(R.metrics);
+    r.pod_vec(R.trades);
+    r.pod_vec(R.equity);
+}
+
+void save(BinWriter& w, const TradeBootstrapResult& R){
+    w.pod(R.sharpe_bar); w.pod(R.hit_ratio); w.pod(R.avg_pnl); w.pod(R.sum_pnl); w.pod(R.max_dd);
+    w.pod_vec(R.samples);
+}
+
+void load(BinReader& r, TradeBootstrapResult& R){
+    r.pod(R.sharpe_bar); r.pod(R.hit_ratio); r.pod(R.avg_pnl); r.pod(R.sum_pnl); r.pod(R.max_dd);
+    r.pod_vec(R.samples);
+}
+
+// ------------------------- cache -------------------------
+StageCache::StageCache(std::string dir) : dir_(std::move(dir)) {
+    if (dir_.empty()) return;
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) throw std::runtime_error("StageCache: cannot create " + dir_ + ": " + ec.message());
+}
+
+StageCache StageCache::from_env(){
+    const char* v = std::getenv("ARBITRAGE_CACHE");
+    if (!v || !*v || std::string(v) == "0") return StageCache();
+    return StageCache(std::string(v) == "1" ? "outputs/cache" : std::string(v));
+}
+
+void StageCache::count_hit(){ hits_.fetch_add(1, std::memory_order_relaxed); c_hits.add(); }
+void StageCache::count_miss(){ misses_.fetch_add(1, std::memory_order_relaxed); c_misses.add(); }
+
+std::string StageCache::path_of(const char* stage, const CacheKey& k) const {
+    return dir_ + "/" + stage + "-" + k.hex() + ".bin";
+}
+
+// [magic 8][version u32][layout u32][key lo,hi][payload size u64][checksum u64][payload]
+bool StageCache::read_entry(const char* stage, const CacheKey& k, std::string& payload) const {
+    std::ifstream f(path_of(stage, k), std::ios::binary);
+    if (!f) return false;
+    char magic[8];
+    std::uint32_t ver = 0, layout = 0;
+    std::uint64_t lo = 0, hi = 0, n = 0, sum = 0;
+    f.read(magic, 8);
+    f.read(reinterpret_cast<char*>(&ver), 4);
+    f.read(reinterpret_cast<char*>(&layout), 4);
+    f.read(reinterpret_cast<char*>(&lo), 8);
+    f.read(reinterpret_cast<char*>(&hi), 8);
+    f.read(reinterpret_cast<char*>(&n), 8);
+    f.read(reinterpret_cast<char*>(&sum), 8);
+    if (!f || std::memcmp(magic, MAGIC, 8) != 0 || ver != FORMAT_VERSION || layout != LAYOUT ||
+        lo != k.lo || hi != k.hi || n > (std::uint64_t(1) << 40))
+        return false;
+    payload.resize(static_cast<size_t>(n));
+    f.read(payload.data(), static_cast<std::streamsize>(n));
+    return f && checksum(payload) == sum;
+}
+
+void StageCache::write_entry(const char* stage, const CacheKey& k, const std::string& payload) const {
+    static std::atomic<unsigned> seq{0};
+    const std::string final_path = path_of(stage, k);
+    const std::string tmp = final_path + ".tmp" +
+        std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()) % 100000) + "_" +
+        std::to_string(seq.fetch_add(1));
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return;                         // cache non scrivibile: si continua senza
+        const std::uint64_t n = payload.size(), sum = checksum(payload);
+        f.write(MAGIC, 8);
+        f.write(reinterpret_cast<const char*>(&FORMAT_VERSION), 4);
+        f.write(reinterpret_cast<const char*>(&LAYOUT), 4);
+        f.write(reinterpret_cast<const char*>(&k.lo), 8);
+        f.write(reinterpret_cast<const char*>(&k.hi), 8);
+        f.write(reinterpret_cast<const char*>(&n), 8);
+        f.write(reinterpret_cast<const char*>(&sum), 8);
+        f.write(payload.data(), static_cast<std::streamsize>(n));
+        if (!f) { f.close(); std::remove(tmp.c_str()); return; }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, final_path, ec);
+    if (ec) std::remove(tmp.c_str());
+}
+
+} // namespace util
@@ -1,59 +1,50 @@
 #include "utilities/StatisticalBootstrap.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/Trace.hpp"
+#include "utilities/Arena.hpp"
 #include <cmath>
 #include <random>
 #include <algorithm>
 #include <iostream>
+#include <memory_resource>
+#include <span>
 #include <vector>
 
 namespace {
 
+util::trace::Counter c_replicates("bootstrap_replicates");
+
 // MLE chiuso per OU su griglia equispaziata
-static void ou_mle(const std::vector<double>& x, double dt,
+static void ou_mle(std::span<const double> x, double dt,
                    double& k, double& eta, double& sigma)
 {
     const size_t Np1 = x.size();
     if (Np1 < 3) { k=eta=sigma=0.0; return; }
 
     const size_t N = Np1 - 1;
-    double sum_m=0, sum_p=0, sum_mm=0, sum_pp=0, sum_pm=0;
+    stats::OUSums S;
+    S.N = N;
     for (size_t i=0;i<N;i++){
         double xm = x[i], xp = x[i+1];
-        sum_m  += xm;
-        sum_p  += xp;
-        sum_mm += xm*xm;
-        sum_pp += xp*xp;
-        sum_pm += xm*xp;
+        S.sum_m  += xm;
+        S.sum_p  += xp;
+        S.sum_mm += xm*xm;
+        S.sum_pp += xp*xp;
+        S.sum_pm += xm*xp;
     }
-    double Y_m  = sum_m / N;
-    double Y_p  = sum_p / N;
-    double Y_mm = sum_mm / N;
-    double Y_pp = sum_pp / N;
-    double Y_pm = sum_pm / N;
-
-    double denom = (Y_mm - Y_m*Y_m);
-    double rho   = (denom != 0.0) ? (Y_pm - Y_m*Y_p)/denom : 0.0;
-    if (rho <= 0.0) rho = 1e-8; // evita log di <=0
-    if (rho >= 1.0) rho = 1.0 - 1e-8;
+    S.x_first = x.front();
+    S.x_last  = x.back();
 
-    k = -std::log(rho) / dt;
-
-    // stima semplice di eta (non essenziale per le bande)
-    eta = Y_p + ((x.back() - x.front())/static_cast<double>(N)) *
-                (Y_pm - Y_m*Y_p) /
-                std::max(1e-12, (Y_mm - Y_m*Y_m) - (Y_pm - Y_m*Y_p));
-
-    double sigma2 = Y_pp - Y_p*Y_p
-                  - ( (Y_pm - Y_m*Y_p)*(Y_pm - Y_m*Y_p) ) / std::max(1e-12, denom);
-    sigma2 = std::max(sigma2, 1e-12);
-    sigma  = std::sqrt( (2.0*k*sigma2) / (1.0 - std::exp(-2.0*k*dt)) );
+    const auto E = stats::ou_mle_from_sums(S, dt);
+    k = E.k; eta = E.eta; sigma = E.sigma;
 }
 
-// simulazione esatta 1-step OU
-static std::vector<double> ou_sim(double x0, double k, double eta, double sigma,
-                                  double dt, size_t N, std::mt19937_64& rng)
+// simulazione esatta 1-step OU in x (N+1 punti, buffer riusato tra le repliche)
+static void ou_sim(std::span<double> x, double x0, double k, double eta, double sigma,
+                   double dt, std::mt19937_64& rng)
 {
     std::normal_distribution<double> Z(0.0, 1.0);
-    std::vector<double> x(N+1);
+    const size_t N = x.size() - 1;
     x[0] = x0;
 
     const double a  = std::exp(-k*dt);
@@ -63,11 +54,13 @@ static std::vector<double> ou_sim(double x0, double k, double eta, double sigma,
     for (size_t i=0;i<N;i++){
         x[i+1] = a*x[i] + b + sd*Z(rng);
     }
-    return x;
 }
 
-static double percentile(std::vector<double> v, double p01_99){
-    if (v.empty()) return NAN;
+// copia ordinata sull'arena del thread (niente heap per chiamata)
+static double percentile(const std::vector<double>& src, double p01_99){
+    if (src.empty()) return NAN;
+    util::ScratchScope scratch;
+    std::pmr::vector<double> v(src.begin(), src.end(), scratch.resource());
     std::sort(v.begin(), v.end());
     double pos = (p01_99/100.0)*(v.size()-1);
     size_t i = static_cast<size_t>(std::floor(pos));
@@ -80,22 +73,44 @@ static double percentile(std::vector<double> v, double p01_99){
 
 namespace stats {
 
-OUBootstrapResult ou_bootstrap(const util::PriceTable& clean_data,
-                               int M, double alpha, std::uint64_t seed)
+OUEstimate ou_mle_from_sums(const OUSums& S, double dt)
 {
-    OUBootstrapResult R;
+    OUEstimate E;
+    if (S.N < 2) return E;
 
-    // estrai serie Rt e tempi per dt medio (anni)
-    if (clean_data.size() < 3) return R;
+    const double N = static_cast<double>(S.N);
+    double Y_m  = S.sum_m / N;
+    double Y_p  = S.sum_p / N;
+    double Y_mm = S.sum_mm / N;
+    double Y_pp = S.sum_pp / N;
+    double Y_pm = S.sum_pm / N;
 
-    std::vector<double> x;
-    x.reserve(clean_data.size());
-    for (const auto& r : clean_data) x.push_back(r.Rt);
+    double denom = (Y_mm - Y_m*Y_m);
+    double rho   = (denom != 0.0) ? (Y_pm - Y_m*Y_p)/denom : 0.0;
+    E.rho = rho;
+    if (rho <= 0.0) rho = 1e-8; // evita log di <=0
+    if (rho >= 1.0) rho = 1.0 - 1e-8;
 
-    // dt medio (approssimiamo a campionamento regolare sull’intervallo totale)
-    // NB: qui non parseiamo le date; assumiamo 30 min come nel tuo dataset: 0.5/24/365 anni
-    // Se vuoi preciso, calcola da stringhe.
-    const double dt = (0.5/24.0)/365.0;
+    E.k = -std::log(rho) / dt;
+
+    // stima semplice di eta (non essenziale per le bande)
+    E.eta = Y_p + ((S.x_last - S.x_first)/N) *
+                  (Y_pm - Y_m*Y_p) /
+                  std::max(1e-12, (Y_mm - Y_m*Y_m) - (Y_pm - Y_m*Y_p));
+
+    double sigma2 = Y_pp - Y_p*Y_p
+                  - ( (Y_pm - Y_m*Y_p)*(Y_pm - Y_m*Y_p) ) / std::max(1e-12, denom);
+    sigma2 = std::max(sigma2, 1e-12);
+    E.sigma = std::sqrt( (2.0*E.k*sigma2) / (1.0 - std::exp(-2.0*E.k*dt)) );
+    return E;
+}
+
+// MLE + bootstrap parametrico sulla serie x (già estratta, sull'arena del chiamante)
+static OUBootstrapResult bootstrap_series(std::span<const double> x, int M, double alpha,
+                                          std::uint64_t seed, double dt)
+{
+    OUBootstrapResult R;
+    R.dt = dt;
 
     // MLE sui dati reali
     ou_mle(x, dt, R.k, R.eta, R.sigma);
@@ -106,14 +121,17 @@ OUBootstrapResult ou_bootstrap(const util::PriceTable& clean_data,
     R.boot_eta.reserve(M);
     R.boot_sigma.reserve(M);
 
+    util::ScratchScope scratch;
+    std::pmr::vector<double> xs(x.size(), scratch.resource());
     for (int m=0; m<M; ++m){
-        auto xs = ou_sim(x.front(), R.k, R.eta, R.sigma, dt, x.size()-1, rng);
+        ou_sim(xs, x.front(), R.k, R.eta, R.sigma, dt, rng);
         double k, eta, sigma;
         ou_mle(xs, dt, k, eta, sigma);
         R.boot_k.push_back(k);
         R.boot_eta.push_back(eta);
         R.boot_sigma.push_back(sigma);
     }
+    c_replicates.add(static_cast<std::uint64_t>(std::max(M, 0)));
 
     double lowp  = alpha*50.0;
     double highp = 100.0 - alpha*50.0;
@@ -127,6 +145,30 @@ OUBootstrapResult ou_bootstrap(const util::PriceTable& clean_data,
     return R;
 }
 
+OUBootstrapResult ou_bootstrap(const util::PriceTable& clean_data,
+                               int M, double alpha, std::uint64_t seed, double dt)
+{
+    util::trace::Scope trace_scope("ou_bootstrap");
+    if (clean_data.size() < 3 || !(dt > 0.0)) { OUBootstrapResult R; R.dt = dt; return R; }
+
+    // estrai serie Rt
+    util::ScratchScope scratch;
+    std::pmr::vector<double> x(scratch.resource());
+    x.reserve(clean_data.size());
+    for (const auto& r : clean_data) x.push_back(r.Rt);
+    return bootstrap_series(x, M, alpha, seed, dt);
+}
+
+OUBootstrapResult ou_bootstrap(const util::CompactPriceTable& clean_data,
+                               int M, double alpha, std::uint64_t seed, double dt)
+{
+    util::trace::Scope trace_scope("ou_bootstrap");
+    if (clean_data.size() < 3 || !(dt > 0.0)) { OUBootstrapResult R; R.dt = dt; return R; }
+
+    // la colonna Rt è già double e contigua: niente copia
+    return bootstrap_series(clean_data.rt_column(), M, alpha, seed, dt);
+}
+
 void print_ou_estimates(const OUBootstrapResult& R){
     std::cout << "Ornstein-Uhlenbeck Parameter Estimates\n"
               << "---------------------------------------------\n";
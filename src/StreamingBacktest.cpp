@@ -0,0 +1,108 @@
+#include "utilities/StreamingBacktest.hpp"
+#include "utilities/Loaders.hpp"     // for PriceRow/PriceTable
+#include <cmath>
+
+namespace util {
+
+static inline double safe_log_ratio(double a, double b){
+    return (a>0.0 && b>0.0) ? std::log(a/b) : 0.0;
+}
+
+StreamingBacktester::StreamingBacktester(const BacktestConfig& cfg)
+    : cfg_(cfg),
+      sigma_stat_(cfg.sigma_hat / std::sqrt(2.0 * cfg.k_hat)),
+      f_abs_(std::isfinite(cfg.f) ? cfg.f : 1.0) // come backtest_os: NaN => f=1
+{}
+
+void StreamingBacktester::reset(){
+    st_ = State::Flat;
+    i_ = 0;
+    i_entry_ = 0;
+    x_entry_ = z_entry_ = f_used_ = costs_acc_ = 0.0;
+    entry_ts_ = 0;
+    acc_ = MetricsAccumulator{};
+}
+
+const Trade* StreamingBacktester::on_tick(std::int64_t time,
+                                          double bid1, double ask1,
+                                          double bid2, double ask2,
+                                          const std::array<double,2>& convs)
+{
+    // come il loader: prezzi convertiti per gamba, poi mid e Rt (il costo log(ask/bid) non cambia)
+    const double mid1 = 0.5 * (bid1 + ask1) * convs[0];
+    const double mid2 = 0.5 * (bid2 + ask2) * convs[1];
+    const double x = (mid1 > 0.0 && mid2 > 0.0) ? std::log(mid1 / mid2) : 0.0;
+    const double half_cost = 0.5 * (safe_log_ratio(ask1, bid1) + safe_log_ratio(ask2, bid2));
+    return step([time]{ return time; }, x, half_cost);
+}
+
+const Trade* StreamingBacktester::on_row(const PriceRow& r){
+    const double half_cost = 0.5 * (safe_log_ratio(r.Ask1, r.Bid1) + safe_log_ratio(r.Ask2, r.Bid2));
+    return step([&r]{ return iso_to_epoch_seconds(r.Time); }, r.Rt, half_cost);
+}
+
+const Trade* StreamingBacktester::on_quote(std::int64_t time, double x,
+                                           double bid1, double ask1,
+                                           double bid2, double ask2)
+{
+    const double half_cost = 0.5 * (safe_log_ratio(ask1, bid1) + safe_log_ratio(ask2, bid2));
+    return step([time]{ return time; }, x, half_cost);
+}
+
+const Trade* StreamingBacktester::on_bar(double x, double half_cost){
+    return step([]{ return std::int64_t{0}; }, x, half_cost);
+}
+
+template <class TimeFn>
+const Trade* StreamingBacktester::step(TimeFn&& time_of, double x, double half_cost){
+    const size_t i = i_++;
+    const double z = (x - cfg_.eta_hat) / sigma_stat_;
+    if (cfg_.cost == CostModel::Zero) half_cost = 0.0;
+
+    if (st_ == State::Flat){
+        int side = 0;
+        if (z <= cfg_.d)                          side = +1;
+        else if (cfg_.symmetric && z >= -cfg_.d)  side = -1;
+        if (side != 0){
+            st_        = (side > 0) ? State::Long : State::Short;
+            i_entry_   = i;
+            x_entry_   = x;
+            z_entry_   = z;
+            f_used_    = (side > 0) ? f_abs_ : -f_abs_;
+            costs_acc_ = std::abs(f_used_) * half_cost;   // entry cost
+            entry_ts_  = time_of();
+        }
+        return nullptr;
+    }
+
+    // long: TP z >= u, SL z <= l ; short (mirror): TP z <= -u, SL z >= -l
+    const bool exit_now = (st_ == State::Long)
+        ? (z >= cfg_.u  || z <= cfg_.l)
+        : (z <= -cfg_.u || z >= -cfg_.l);
+    if (!exit_now) return nullptr;
+
+    costs_acc_ += std::abs(f_used_) * half_cost;          // exit cost
+    const double gross = (x - x_entry_) * f_used_;        // log PnL (no cost)
+
+    last_.entry_idx = i_entry_;
+    last_.exit_idx  = i;
+    last_.entry_ts  = entry_ts_;
+    last_.exit_ts   = time_of();
+    last_.z_entry   = z_entry_;
+    last_.z_exit    = z;
+    last_.x_entry   = x_entry_;
+    last_.x_exit    = x;
+    last_.f         = f_used_;
+    last_.costs     = costs_acc_;
+    last_.pnl       = gross - costs_acc_;
+    last_.bars      = i - i_entry_;
+
+    acc_.on_close(last_.pnl);
+
+    st_ = State::Flat;
+    f_used_ = 0.0;
+    costs_acc_ = 0.0;
+    return &last_;
+}
+
+} // namespace util
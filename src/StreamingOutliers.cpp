@@ -0,0 +1,127 @@
+#include "utilities/StreamingOutliers.hpp"
+#include "utilities/Parallel.hpp"
+#include <algorithm>
+
+namespace util {
+
+OutlierFences OutlierFences::from(const KllSketch& s){
+    OutlierFences f;
+    if (s.count() == 0) return f;
+    f.q1  = s.quantile(0.25);
+    f.q3  = s.quantile(0.75);
+    f.iqr = f.q3 - f.q1;
+    f.lo  = f.q1 - 3.0 * f.iqr;
+    f.hi  = f.q3 + 3.0 * f.iqr;
+    return f;
+}
+
+StreamingOutlierFilter::StreamingOutlierFilter(const StreamingOutlierConfig& cfg)
+    : cfg_(cfg), sketch_(cfg.k, cfg.seed)
+{
+    if (cfg_.mode == FenceMode::Rolling)
+        rolling_ = std::make_unique<RollingQuantileSketch>(cfg_.window, cfg_.n_blocks, cfg_.k, cfg_.seed);
+    cfg_.refresh = std::max<size_t>(cfg_.refresh, 1);
+}
+
+StreamingOutlierFilter::~StreamingOutlierFilter() = default;
+
+void StreamingOutlierFilter::freeze(const OutlierFences& f){
+    cfg_.mode = FenceMode::Frozen;
+    rolling_.reset();
+    fences_ = f;
+}
+
+void StreamingOutlierFilter::observe(double x){
+    if (cfg_.mode == FenceMode::Frozen) return;
+    if (rolling_) rolling_->update(x);
+    else          sketch_.update(x);
+
+    // le query costano O(k log k): soglie ricalcolate ogni cfg.refresh barre
+    if (n_ < cfg_.warmup) return;
+    if (fences_.valid() && ++since_refresh_ < cfg_.refresh) return;
+    since_refresh_ = 0;
+    fences_ = rolling_ ? OutlierFences::from(rolling_->merged()) : OutlierFences::from(sketch_);
+}
+
+const StreamingOutlierFilter::Decision* StreamingOutlierFilter::push(const PriceRow& r){
+    const size_t idx = n_++;
+    const double x = r.Rt;
+    observe(x);
+
+    // step 1: log-spread
+    if (fences_.valid() && (x < fences_.lo || x > fences_.hi)){
+        out_.row = r; out_.index = idx;
+        out_.outlier = true; out_.antipersistent = false;
+        return &out_;
+    }
+
+    // step 2: il sopravvissuto in attesa si decide ora che c'è il successivo
+    const Decision* released = nullptr;
+    if (has_pending_){
+        const double xt = pending_.row.Rt;
+        bool anti = false;
+        if (has_prev_ && fences_.valid()){
+            anti = std::fabs(xt - prev_x_) > fences_.iqr &&
+                   std::fabs(x - xt) > 0.95 * fences_.iqr;
+        }
+        out_ = std::move(pending_);
+        out_.outlier = anti; out_.antipersistent = anti;
+        has_prev_ = true; prev_x_ = xt;
+        released = &out_;
+    }
+    pending_.row = r; pending_.index = idx;
+    pending_.outlier = false; pending_.antipersistent = false;
+    has_pending_ = true;
+    return released;
+}
+
+const StreamingOutlierFilter::Decision* StreamingOutlierFilter::finish(){
+    if (!has_pending_) return nullptr;
+    out_ = std::move(pending_);          // l'ultimo non ha successivo: mai antipersistente
+    out_.outlier = false; out_.antipersistent = false;
+    has_pending_ = false;
+    has_prev_ = true; prev_x_ = out_.row.Rt;
+    return &out_;
+}
+
+OutlierResult remove_outliers_streaming(const PriceTable& data,
+                                        StreamingOutlierConfig cfg,
+                                        unsigned n_threads)
+{
+    OutlierResult R;
+    R.is_outlier.assign(data.size(), false);
+    if (data.empty()) return R;
+
+    StreamingOutlierFilter flt(cfg);
+    if (cfg.mode == FenceMode::Frozen){
+        // sketch per blocco fisso (non per thread): il merge non dipende da n_threads
+        constexpr size_t CHUNK = 1 << 16;
+        const size_t n_chunks = (data.size() + CHUNK - 1) / CHUNK;
+        std::vector<KllSketch> parts;
+        parts.reserve(n_chunks);
+        for (size_t c=0; c<n_chunks; ++c) parts.emplace_back(cfg.k, stream_seed(cfg.seed, c));
+
+        parallel_for(n_chunks, n_threads, [&](size_t b, size_t e, unsigned){
+            for (size_t c=b; c<e; ++c){
+                const size_t end = std::min(data.size(), (c + 1) * CHUNK);
+                for (size_t i=c*CHUNK; i<end; ++i) parts[c].update(data[i].Rt);
+            }
+        });
+        for (size_t c=1; c<n_chunks; ++c) parts[0].merge(parts[c]);
+        flt.freeze(OutlierFences::from(parts[0]));
+    }
+
+    auto take = [&](const StreamingOutlierFilter::Decision* d){
+        if (d) R.is_outlier[d->index] = d->outlier;
+    };
+    for (const auto& r : data) take(flt.push(r));
+    take(flt.finish());
+
+    for (size_t i=0; i<data.size(); ++i){
+        if (R.is_outlier[i]) R.outliers.push_back(data[i]);
+        else                 R.clean.push_back(data[i]);
+    }
+    return R;
+}
+
+} // namespace util
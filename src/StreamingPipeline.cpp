@@ -0,0 +1,266 @@
+#include "utilities/StreamingPipeline.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/Loaders.hpp"
+#include "utilities/SpscRing.hpp"
+#include "utilities/StreamingBacktest.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace util {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ms_since(Clock::time_point t0){
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// righe valide in [0, n); le stringhe restano allocate tra un giro e l'altro
+struct Batch {
+    std::vector<PriceRow> rows;
+    size_t n = 0;
+    bool os = false;
+};
+
+using Ring = SpscRing<Batch*>;
+
+// batch di proprietà di uno stadio: pieni verso valle su `full`, di ritorno su `free`
+struct Link {
+    std::vector<Batch> pool;
+    Ring full, free;
+
+    Link(size_t ring_batches, size_t batch_rows)
+        : full(ring_batches), free(full.capacity() + 2) {
+        // capacity()+2: ring pieno + uno in riempimento a monte + uno in uso a valle
+        pool.resize(full.capacity() + 2);
+        for (auto& b : pool){
+            b.rows.resize(batch_rows);
+            Batch* p = &b;
+            free.try_push(p);
+        }
+    }
+    void cancel(){ full.cancel(); free.cancel(); }
+};
+
+// scritti dal cleaner prima del push del primo batch OS (o di close()):
+// il release del ring li rende visibili al consumer che fa pop di quel batch
+struct CleanerTotals {
+    double cost_sum = 0.0, cost_n = 0.0;
+    size_t IS_rows = 0, IS_clean = 0, OS_rows = 0, OS_clean = 0;
+    size_t out_of_order = 0;
+};
+
+} // anon
+
+StreamingPipelineResult run_streaming_pipeline(const RunSpec& spec,
+                                               const StreamingPipelineOptions& opt,
+                                               const TradeSink& on_trade){
+    trace::Scope trace_scope("stream_pipeline");
+    if (spec.bar_seconds > 0) throw std::runtime_error("bar resampling is not supported by --stream (use --batch)");
+    const auto t0 = Clock::now();
+    const size_t batch_rows = std::max<size_t>(opt.batch_rows, 1);
+
+    Link parsed(opt.ring_batches, batch_rows);     // parser  -> cleaner
+    Link cleaned(opt.ring_batches, batch_rows);    // cleaner -> consumer
+
+    std::mutex err_mu;
+    std::exception_ptr err;
+    auto fail = [&](std::exception_ptr e){
+        {
+            std::lock_guard<std::mutex> lk(err_mu);
+            if (!err) err = e;
+        }
+        parsed.cancel();
+        cleaned.cancel();
+    };
+
+    size_t rows_parsed = 0;
+    CleanerTotals T;
+
+    // ---- stadio 1: parsing CSV in batch ----
+    std::thread parser([&]{
+        try {
+            Batch* cur = nullptr;
+            auto flush = [&]{
+                Batch* b = cur;
+                cur = nullptr;
+                return parsed.full.push(b);
+            };
+            rows_parsed = stream_price_data_csv(
+                spec.csv_path, spec.time_col, spec.bid_ask_cols, spec.mid_cols, spec.ticks,
+                spec.convs, spec.start_date, spec.end_date,
+                [&](PriceRow& r){
+                    if (!cur){
+                        if (!parsed.free.pop(cur)) return false;   // cancellato
+                        cur->n = 0;
+                    }
+                    cur->rows[cur->n++] = std::move(r);
+                    return cur->n < batch_rows || flush();
+                });
+            if (cur && cur->n) flush();
+            parsed.full.close();
+        } catch (...) { fail(std::current_exception()); }
+    });
+
+    // ---- stadio 2: split IS/OS, finestre orarie, costo, outlier online ----
+    std::thread cleaner([&]{
+        try {
+            trace::Scope scope("stream_clean");
+            const auto& ISh = spec.IS_hours;
+            const auto& Ch  = spec.cost_hours;
+            const auto& OSx = spec.OS_exclude_hours;
+            auto in_window = [](double h, double a, double b){ return (h >= a) && (h <= b); };
+
+            StreamingOutlierFilter filt_IS(opt.outliers), filt_OS(opt.outliers);
+            std::string split_date, last_time;
+            bool started = false, in_OS = false;
+
+            Batch* cur = nullptr;
+            auto flush = [&]{
+                Batch* b = cur;
+                cur = nullptr;
+                return cleaned.full.push(b);
+            };
+            auto emit = [&](const StreamingOutlierFilter::Decision* d, bool os){
+                if (!d || d->outlier) return true;
+                if (!cur){
+                    if (!cleaned.free.pop(cur)) return false;
+                    cur->n = 0;
+                    cur->os = os;
+                }
+                cur->rows[cur->n++] = d->row;       // copia su stringhe già allocate
+                (os ? T.OS_clean : T.IS_clean)++;
+                return cur->n < batch_rows || flush();
+            };
+            // fine dell'IS: rilascia il sopravvissuto in attesa e chiude il batch IS,
+            // così il primo batch OS trova le somme IS complete
+            auto end_IS = [&]{
+                if (!emit(filt_IS.finish(), false)) return false;
+                in_OS = true;
+                return !cur || flush();
+            };
+
+            bool ok = true;
+            Batch* in = nullptr;
+            while (ok && parsed.full.pop(in)){
+                for (size_t i=0; ok && i<in->n; ++i){
+                    const PriceRow& r = in->rows[i];
+                    if (!started){
+                        split_date = add_months_iso(r.Time, spec.split_months);
+                        started = true;
+                    } else if (r.Time < last_time) ++T.out_of_order;
+                    last_time = r.Time;
+
+                    const double h = extract_decimal_hour(r.Time);
+                    if (!in_OS && r.Time < split_date){      // ISO: confronto lessicografico
+                        // costo medio sull'IS grezzo (finestra cost_hours), come main
+                        if (in_window(h, Ch[0], Ch[1])){
+                            const double ct = log_cost(r.Bid1, r.Ask1, r.Bid2, r.Ask2);
+                            if (std::isfinite(ct)) { T.cost_sum += ct; T.cost_n += 1.0; }
+                        }
+                        if (!in_window(h, ISh[0], ISh[1])) continue;
+                        ++T.IS_rows;
+                        ok = emit(filt_IS.push(r), false);
+                    } else {
+                        if (!in_OS && !(ok = end_IS())) break;
+                        // tieni solo FUORI dalla finestra esclusa
+                        if (!(h <= OSx[0] || h >= OSx[1])) continue;
+                        ++T.OS_rows;
+                        ok = emit(filt_OS.push(r), true);
+                    }
+                }
+                if (ok) ok = parsed.free.push(in);
+            }
+            if (ok && !parsed.full.cancelled()){
+                if (!in_OS) ok = end_IS();
+                if (ok) ok = emit(filt_OS.finish(), true);
+                if (ok && cur) flush();
+            }
+            cleaned.full.close();
+        } catch (...) { fail(std::current_exception()); }
+    });
+
+    // ---- stadio 3 (thread chiamante): somme OU su IS, poi bande + backtest su OS ----
+    StreamingPipelineResult R;
+    try {
+        trace::Scope scope("stream_backtest");
+        stats::OUSums S;
+        bool has_prev = false;
+        double prev = 0.0;
+        std::optional<StreamingBacktester> bt;
+
+        auto calibrate = [&]{
+            R.ou = stats::ou_mle_from_sums(S, opt.dt);
+            if (!(R.ou.k > 0.0) || !std::isfinite(R.ou.sigma))
+                throw std::runtime_error("OU calibration failed");
+            R.C = T.cost_n > 0.0 ? T.cost_sum / T.cost_n : 0.0;
+            R.bands = optimal_trading_bands(spec.M_opt, spec.l_bt, spec.f_bt, R.ou.k, R.ou.sigma,
+                                            R.C, spec.alpha, spec.grid);
+            BacktestConfig cfg;
+            cfg.k_hat     = R.ou.k;
+            cfg.eta_hat   = R.ou.eta;
+            cfg.sigma_hat = R.ou.sigma;
+            cfg.d = -std::abs(R.bands.d_estimated);
+            cfg.u =  std::abs(R.bands.u_estimated);
+            cfg.l = spec.l_bt;
+            cfg.f = spec.f_bt;
+            cfg.symmetric = spec.symmetric;
+            bt.emplace(cfg);
+        };
+
+        Batch* b = nullptr;
+        while (cleaned.full.pop(b)){
+            if (!b->os){
+                // stesse coppie (x_i, x_{i+1}) di ou_mle
+                for (size_t i=0; i<b->n; ++i){
+                    const double x = b->rows[i].Rt;
+                    if (!has_prev) S.x_first = x;
+                    else {
+                        ++S.N;
+                        S.sum_m += prev;     S.sum_p += x;
+                        S.sum_mm += prev*prev; S.sum_pp += x*x; S.sum_pm += prev*x;
+                    }
+                    S.x_last = x;
+                    prev = x;
+                    has_prev = true;
+                }
+            } else {
+                if (!bt) calibrate();
+                for (size_t i=0; i<b->n; ++i){
+                    const Trade* t = bt->on_row(b->rows[i]);
+                    if (t && on_trade) on_trade(*t);
+                }
+                if (R.first_os_ms == 0.0) R.first_os_ms = ms_since(t0);
+            }
+            if (!cleaned.free.push(b)) break;
+        }
+        if (!cleaned.full.cancelled() && !bt) calibrate();   // nessuna riga OS: solo calibrazione
+        if (bt) R.metrics = bt->metrics();
+    } catch (...) { fail(std::current_exception()); }
+
+    parser.join();
+    cleaner.join();
+    if (err) std::rethrow_exception(err);
+
+    R.rows_parsed  = rows_parsed;
+    R.IS_rows      = T.IS_rows;
+    R.IS_clean     = T.IS_clean;
+    R.OS_rows      = T.OS_rows;
+    R.OS_clean     = T.OS_clean;
+    R.out_of_order = T.out_of_order;
+    R.parser_stalls  = parsed.full.stalls();
+    R.cleaner_stalls = cleaned.full.stalls();
+    R.rows_in_flight = (parsed.pool.size() + cleaned.pool.size()) * batch_rows;
+    R.wall_ms = ms_since(t0);
+    return R;
+}
+
+} // namespace util
@@ -0,0 +1,133 @@
+#include "utilities/TaskGraph.hpp"
+#include "utilities/Parallel.hpp"
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace util {
+
+TaskGraph::NodeId TaskGraph::add(const char* name, std::function<void()> fn,
+                                 std::initializer_list<NodeId> deps)
+{
+    return add(name, std::move(fn), std::vector<NodeId>(deps));
+}
+
+TaskGraph::NodeId TaskGraph::add(const char* name, std::function<void()> fn,
+                                 const std::vector<NodeId>& deps)
+{
+    const NodeId id = nodes_.size();
+    for (NodeId d : deps)
+        if (d >= id) throw std::invalid_argument(std::string("TaskGraph: node '") + name +
+                                                 "' depends on a node not added yet.");
+    Node n;
+    n.name = name;
+    n.fn   = std::move(fn);
+    n.deps = deps;
+    std::sort(n.deps.begin(), n.deps.end());
+    n.deps.erase(std::unique(n.deps.begin(), n.deps.end()), n.deps.end());
+    for (NodeId d : n.deps) nodes_[d].dependents.push_back(id);
+    nodes_.push_back(std::move(n));
+    return id;
+}
+
+bool TaskGraph::execute(NodeId i, bool skip, std::exception_ptr& err){
+    Node& n = nodes_[i];
+    n.ms = 0.0;
+    if (skip) return false;
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+        trace::Scope trace_scope(n.name, "task");
+        n.fn();
+    } catch (...) {
+        err = std::current_exception();
+    }
+    n.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return !err;
+}
+
+void TaskGraph::run_serial(){
+    const size_t N = nodes_.size();
+    std::vector<char> ok(N, 0);
+    std::vector<std::exception_ptr> errs(N);
+    for (NodeId i=0; i<N; ++i){
+        bool skip = false;
+        for (NodeId d : nodes_[i].deps) if (!ok[d]) { skip = true; break; }
+        ok[i] = execute(i, skip, errs[i]);
+    }
+    for (auto& e : errs) if (e) std::rethrow_exception(e);
+}
+
+void TaskGraph::run(unsigned n_threads){
+    if (resolve_threads(n_threads) == 1 || nodes_.size() < 2) { run_serial(); return; }
+    ThreadPool pool(n_threads);
+    run(pool);
+}
+
+void TaskGraph::run(ThreadPool& pool){
+    const size_t N = nodes_.size();
+    if (N == 0) return;
+
+    // stato di una esecuzione (condiviso dai task finché l'ultimo non ha finito)
+    struct RunState {
+        std::unique_ptr<std::atomic<size_t>[]> pending;     // dipendenze non ancora concluse
+        std::unique_ptr<std::atomic<bool>[]>   failed;      // fallito o saltato
+        std::vector<std::exception_ptr> errs;
+        std::mutex m;
+        std::condition_variable cv;
+        size_t done = 0;
+    };
+    auto st = std::make_shared<RunState>();
+    st->pending.reset(new std::atomic<size_t>[N]);
+    st->failed.reset(new std::atomic<bool>[N]);
+    st->errs.resize(N);
+    for (NodeId i=0; i<N; ++i){
+        st->pending[i].store(nodes_[i].deps.size(), std::memory_order_relaxed);
+        st->failed[i].store(false, std::memory_order_relaxed);
+    }
+
+    std::function<void(NodeId)> launch = [this, st, &pool, &launch](NodeId i){
+        pool.submit([this, st, &launch, i]{
+            bool skip = false;
+            for (NodeId d : nodes_[i].deps)
+                if (st->failed[d].load(std::memory_order_relaxed)) { skip = true; break; }
+            if (!execute(i, skip, st->errs[i])) st->failed[i].store(true, std::memory_order_relaxed);
+
+            // il fetch_sub acq_rel rende visibili ai dipendenti i risultati (e failed) di questo nodo
+            for (NodeId j : nodes_[i].dependents)
+                if (st->pending[j].fetch_sub(1, std::memory_order_acq_rel) == 1) launch(j);
+
+            std::lock_guard<std::mutex> lk(st->m);
+            if (++st->done == nodes_.size()) st->cv.notify_all();
+        });
+    };
+
+    for (NodeId i=0; i<N; ++i)
+        if (nodes_[i].deps.empty()) launch(i);
+
+    {
+        std::unique_lock<std::mutex> lk(st->m);
+        st->cv.wait(lk, [&]{ return st->done == N; });
+    }
+    for (auto& e : st->errs) if (e) std::rethrow_exception(e);
+}
+
+double TaskGraph::critical_path_ms() const {
+    // ordine d'inserimento = ordine topologico
+    std::vector<double> finish(nodes_.size(), 0.0);
+    double best = 0.0;
+    for (NodeId i=0; i<nodes_.size(); ++i){
+        double start = 0.0;
+        for (NodeId d : nodes_[i].deps) start = std::max(start, finish[d]);
+        finish[i] = start + nodes_[i].ms;
+        best = std::max(best, finish[i]);
+    }
+    return best;
+}
+
+} // namespace util
@@ -0,0 +1,102 @@
+#include "utilities/ThreadPool.hpp"
+#include "utilities/Parallel.hpp"
+
+namespace util {
+
+// pool e indice del worker corrente (nullptr fuori dal pool)
+static thread_local const ThreadPool* tl_pool = nullptr;
+static thread_local unsigned tl_index = 0;
+
+ThreadPool::ThreadPool(unsigned n_threads){
+    const unsigned T = resolve_threads(n_threads);
+    queues_.reserve(T);
+    for (unsigned t=0; t<T; ++t) queues_.push_back(std::make_unique<Queue>());
+    workers_.reserve(T);
+    for (unsigned t=0; t<T; ++t) workers_.emplace_back([this, t]{ worker_loop(t); });
+}
+
+ThreadPool::~ThreadPool(){
+    wait_idle();
+    {
+        std::lock_guard<std::mutex> lk(idle_m_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+    for (auto& th : workers_) th.join();
+}
+
+void ThreadPool::push(std::function<void()> job){
+    const unsigned T = static_cast<unsigned>(queues_.size());
+    const unsigned target = (tl_pool == this) ? tl_index
+                                              : next_.fetch_add(1, std::memory_order_relaxed) % T;
+    pending_.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard<std::mutex> lk(queues_[target]->m);
+        queues_[target]->q.push_back(std::move(job));
+    }
+    {
+        // sincronizza con il controllo "nessun lavoro" del worker prima di dormire
+        std::lock_guard<std::mutex> lk(idle_m_);
+    }
+    wake_cv_.notify_one();
+}
+
+bool ThreadPool::try_pop(unsigned self, std::function<void()>& job){
+    // propria coda: dal fondo
+    {
+        auto& Q = *queues_[self];
+        std::lock_guard<std::mutex> lk(Q.m);
+        if (!Q.q.empty()){
+            job = std::move(Q.q.back());
+            Q.q.pop_back();
+            return true;
+        }
+    }
+    // furto: dalla testa delle altre code
+    const unsigned T = static_cast<unsigned>(queues_.size());
+    for (unsigned k=1; k<T; ++k){
+        auto& Q = *queues_[(self + k) % T];
+        std::lock_guard<std::mutex> lk(Q.m);
+        if (!Q.q.empty()){
+            job = std::move(Q.q.front());
+            Q.q.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(unsigned self){
+    tl_pool  = this;
+    tl_index = self;
+
+    std::function<void()> job;
+    for (;;){
+        if (try_pop(self, job)){
+            job();
+            job = nullptr;
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                std::lock_guard<std::mutex> lk(idle_m_);
+                idle_cv_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(idle_m_);
+        if (stop_) return;
+        // ricontrolla sotto lock: push() prende idle_m_ dopo aver accodato
+        bool any = false;
+        for (auto& Q : queues_){
+            std::lock_guard<std::mutex> qlk(Q->m);
+            if (!Q->q.empty()) { any = true; break; }
+        }
+        if (!any) wake_cv_.wait(lk);
+    }
+}
+
+void ThreadPool::wait_idle(){
+    std::unique_lock<std::mutex> lk(idle_m_);
+    idle_cv_.wait(lk, [this]{ return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+} // namespace util
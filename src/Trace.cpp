@@ -0,0 +1,288 @@
+#include "utilities/Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <unordered_map>
+
+#include <sys/resource.h>
+
+namespace util::trace {
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* cat;
+    std::int64_t t0_ns, dur_ns;
+    std::uint64_t allocs, bytes;
+};
+
+// un buffer per thread, posseduto dal registro (sopravvive alla fine del thread)
+struct ThreadLog {
+    std::uint32_t tid = 0;
+    std::vector<Event> events;
+};
+
+struct Registry {
+    std::mutex m;
+    std::vector<std::unique_ptr<ThreadLog>> logs;
+    std::vector<std::pair<const char*, std::atomic<std::uint64_t>*>> counters;
+    std::int64_t origin_ns = 0;
+};
+
+Registry& reg(){
+    static Registry r;
+    return r;
+}
+
+ThreadLog& this_thread_log(){
+    thread_local ThreadLog* log = nullptr;
+    if (!log){
+        auto& R = reg();
+        std::lock_guard<std::mutex> lk(R.m);
+        R.logs.push_back(std::make_unique<ThreadLog>());
+        log = R.logs.back().get();
+        log->tid = static_cast<std::uint32_t>(R.logs.size());
+        log->events.reserve(256);
+    }
+    return *log;
+}
+
+// contatori di allocazione: POD thread_local (nessuna init dinamica dentro operator new)
+thread_local std::uint64_t t_allocs = 0, t_bytes = 0;
+std::atomic<std::uint64_t> g_allocs{0}, g_bytes{0};
+std::atomic<bool> g_count_allocs{false};
+
+#if defined(ARBITRAGE_TRACE_ALLOCS) && ARBITRAGE_TRACE_ALLOCS
+constexpr bool alloc_hook = true;
+#else
+constexpr bool alloc_hook = false;     // nessun operator new sostituito: niente da contare
+#endif
+
+std::string json_str(const char* s){
+    std::string o;
+    for (; *s; ++s){
+        if (*s == '"' || *s == '\\') { o += '\\'; o += *s; }
+        else if (static_cast<unsigned char>(*s) >= 0x20) o += *s;
+    }
+    return o;
+}
+
+} // anon
+
+// ------------------------- detail -------------------------
+namespace detail {
+
+std::int64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::uint64_t thread_allocs(){ return t_allocs; }
+std::uint64_t thread_alloc_bytes(){ return t_bytes; }
+
+void scope_end(const char* name, const char* cat, std::int64_t t0_ns,
+               std::uint64_t allocs0, std::uint64_t bytes0)
+{
+    const std::int64_t t1 = now_ns();
+    auto& log = this_thread_log();
+    log.events.push_back({name, cat, t0_ns, t1 - t0_ns, t_allocs - allocs0, t_bytes - bytes0});
+}
+
+void register_counter(const char* name, std::atomic<std::uint64_t>* v){
+    auto& R = reg();
+    std::lock_guard<std::mutex> lk(R.m);
+    R.counters.emplace_back(name, v);
+}
+
+} // namespace detail
+
+// ------------------------- controllo -------------------------
+void enable(bool on, bool count_allocs){
+    if (on && reg().origin_ns == 0) reg().origin_ns = detail::now_ns();
+    g_count_allocs.store(on && count_allocs && alloc_hook, std::memory_order_relaxed);
+    detail::on.store(on, std::memory_order_relaxed);
+}
+
+std::string enable_from_env(){
+    const char* v = std::getenv("ARBITRAGE_TRACE");
+    if (!v || !*v || std::string(v) == "0") return "";
+    const char* a = std::getenv("ARBITRAGE_TRACE_ALLOCS");
+    enable(true, a && std::string(a) == "1");
+    return std::string(v) == "1" ? "outputs/trace.json" : std::string(v);
+}
+
+std::uint64_t total_allocs(){ return g_allocs.load(std::memory_order_relaxed); }
+std::uint64_t total_alloc_bytes(){ return g_bytes.load(std::memory_order_relaxed); }
+
+long peak_rss_kb(){
+    rusage ru{};
+    if (::getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+#if defined(__APPLE__)
+    return static_cast<long>(ru.ru_maxrss / 1024);     // byte su macOS
+#else
+    return static_cast<long>(ru.ru_maxrss);            // KiB su Linux
+#endif
+}
+
+void reset(){
+    auto& R = reg();
+    std::lock_guard<std::mutex> lk(R.m);
+    for (auto& l : R.logs) l->events.clear();
+    for (auto& c : R.counters) c.second->store(0, std::memory_order_relaxed);
+    g_allocs.store(0); g_bytes.store(0);
+    R.origin_ns = detail::now_ns();
+}
+
+// ------------------------- report -------------------------
+std::vector<StageStats> stage_summary(){
+    auto& R = reg();
+    std::lock_guard<std::mutex> lk(R.m);
+
+    struct Acc { StageStats s; std::int64_t first = 0; };
+    std::unordered_map<std::string, Acc> by_name;
+    for (const auto& l : R.logs)
+        for (const auto& e : l->events){
+            auto [it, fresh] = by_name.try_emplace(e.name);
+            Acc& a = it->second;
+            const double ms = e.dur_ns * 1e-6;
+            if (fresh){ a.s.name = e.name; a.first = e.t0_ns; a.s.min_ms = a.s.max_ms = ms; }
+            a.first = std::min(a.first, e.t0_ns);
+            ++a.s.calls;
+            a.s.total_ms += ms;
+            a.s.min_ms = std::min(a.s.min_ms, ms);
+            a.s.max_ms = std::max(a.s.max_ms, ms);
+            a.s.allocs += e.allocs;
+            a.s.alloc_bytes += e.bytes;
+        }
+
+    std::vector<Acc> v;
+    for (auto& kv : by_name) v.push_back(std::move(kv.second));
+    std::sort(v.begin(), v.end(), [](const Acc& a, const Acc& b){ return a.first < b.first; });
+    std::vector<StageStats> out;
+    for (auto& a : v) out.push_back(std::move(a.s));
+    return out;
+}
+
+std::vector<std::pair<std::string, std::uint64_t>> counter_values(){
+    auto& R = reg();
+    std::lock_guard<std::mutex> lk(R.m);
+    std::vector<std::pair<std::string, std::uint64_t>> out;
+    for (const auto& c : R.counters) out.emplace_back(c.first, c.second->load(std::memory_order_relaxed));
+    return out;
+}
+
+void write_summary(std::ostream& os){
+#if !ARBITRAGE_TRACE
+    os << "[trace] instrumentation compiled out (ARBITRAGE_TRACE=0)\n";
+    return;
+#endif
+    const auto stages = stage_summary();
+    const bool allocs = g_count_allocs.load(std::memory_order_relaxed);
+
+    os << "\n=== Stage timing ===\n" << std::left << std::setw(26) << "stage"
+       << std::right << std::setw(7) << "calls" << std::setw(12) << "total ms"
+       << std::setw(11) << "mean ms" << std::setw(11) << "max ms";
+    if (allocs) os << std::setw(12) << "allocs" << std::setw(12) << "MB alloc";
+    os << "\n";
+    for (const auto& s : stages){
+        os << std::left << std::setw(26) << s.name << std::right << std::setw(7) << s.calls
+           << std::fixed << std::setprecision(2)
+           << std::setw(12) << s.total_ms << std::setw(11) << s.total_ms / s.calls
+           << std::setw(11) << s.max_ms;
+        if (allocs) os << std::setw(12) << s.allocs
+                       << std::setw(12) << s.alloc_bytes / 1e6;
+        os << "\n";
+    }
+    os << std::defaultfloat;
+
+    const auto counters = counter_values();
+    if (!counters.empty()){
+        os << "--- counters ---\n";
+        for (const auto& [n, v] : counters) os << std::left << std::setw(26) << n << v << "\n";
+    }
+    if (allocs)
+        os << std::left << std::setw(26) << "allocations" << total_allocs()
+           << std::fixed << std::setprecision(1) << " (" << total_alloc_bytes() / 1e6 << " MB)\n"
+           << std::defaultfloat;
+    os << std::left << std::setw(26) << "peak RSS (KiB)" << peak_rss_kb() << "\n";
+}
+
+bool write_chrome_trace(const std::string& path){
+    std::ofstream f(path, std::ios::trunc);
+    if (!f) return false;
+    auto& R = reg();
+
+    std::vector<std::pair<const ThreadLog*, size_t>> logs;
+    {
+        std::lock_guard<std::mutex> lk(R.m);
+        for (const auto& l : R.logs) logs.emplace_back(l.get(), l->events.size());
+    }
+    const std::int64_t origin = R.origin_ns;
+    std::int64_t t_end = 0;
+
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Arbitrage_cpp\"}}";
+    f << std::fixed << std::setprecision(3);
+    for (const auto& [l, n] : logs){
+        f << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << l->tid
+          << ",\"args\":{\"name\":\"thread " << l->tid << "\"}}";
+        for (size_t i=0; i<n; ++i){
+            const Event& e = l->events[i];
+            t_end = std::max(t_end, e.t0_ns + e.dur_ns);
+            f << ",\n{\"name\":\"" << json_str(e.name) << "\",\"cat\":\"" << json_str(e.cat)
+              << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << l->tid
+              << ",\"ts\":" << (e.t0_ns - origin) * 1e-3 << ",\"dur\":" << e.dur_ns * 1e-3;
+            if (e.allocs) f << ",\"args\":{\"allocs\":" << e.allocs << ",\"bytes\":" << e.bytes << "}";
+            f << "}";
+        }
+    }
+    // contatori come un unico evento "C" alla fine della traccia
+    const auto counters = counter_values();
+    if (!counters.empty()){
+        f << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":"
+          << (std::max(t_end, origin) - origin) * 1e-3 << ",\"args\":{";
+        for (size_t i=0; i<counters.size(); ++i)
+            f << (i ? "," : "") << "\"" << json_str(counters[i].first.c_str()) << "\":" << counters[i].second;
+        f << "}}";
+    }
+    f << "\n]}\n";
+    return static_cast<bool>(f);
+}
+
+} // namespace util::trace
+
+// ------------------------- conteggio allocazioni (opzionale) -------------------------
+#if defined(ARBITRAGE_TRACE_ALLOCS) && ARBITRAGE_TRACE_ALLOCS
+namespace {
+void* traced_alloc(std::size_t n){
+    if (util::trace::g_count_allocs.load(std::memory_order_relaxed)){
+        ++util::trace::t_allocs;
+        util::trace::t_bytes += n;
+        util::trace::g_allocs.fetch_add(1, std::memory_order_relaxed);
+        util::trace::g_bytes.fetch_add(n, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+} // anon
+
+void* operator new(std::size_t n)   { return traced_alloc(n); }
+void* operator new[](std::size_t n) { return traced_alloc(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+    try { return traced_alloc(n); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+    try { return traced_alloc(n); } catch (...) { return nullptr; }
+}
+void  operator delete(void* p) noexcept                { std::free(p); }
+void  operator delete[](void* p) noexcept              { std::free(p); }
+void  operator delete(void* p, std::size_t) noexcept   { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
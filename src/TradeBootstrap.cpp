@@ -0,0 +1,156 @@
+#include "utilities/TradeBootstrap.hpp"
+#include "utilities/Parallel.hpp"
+#include "utilities/Trace.hpp"
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+namespace util {
+
+namespace {
+
+// 64 bit alti di a*b: __int128 dove il compilatore lo offre (GCC/Clang), altrimenti
+// prodotto a mezze parole da 32 bit (stesso risultato, bit per bit)
+inline std::uint64_t mul_hi64(std::uint64_t a, std::uint64_t b){
+#ifdef __SIZEOF_INT128__
+    return static_cast<std::uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+#else
+    const std::uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+    const std::uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+    const std::uint64_t lo_lo = a_lo * b_lo;
+    const std::uint64_t hi_lo = a_hi * b_lo;
+    const std::uint64_t lo_hi = a_lo * b_hi;
+    const std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+    return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+// generatore leggero: il seeding costa O(1) (mt19937_64 costerebbe ~300 parole per replica)
+struct SplitMix64 {
+    std::uint64_t s;
+    std::uint64_t next(){
+        std::uint64_t z = (s += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    // uniforme in [0, n) (moltiplicazione di Lemire, niente modulo)
+    size_t below(size_t n){
+        return static_cast<size_t>(mul_hi64(next(), static_cast<std::uint64_t>(n)));
+    }
+};
+
+BacktestMetrics one_replicate(const std::vector<double>& pnls,
+                              const TradeBootstrapConfig& cfg,
+                              std::uint64_t r)
+{
+    SplitMix64 rng{stream_seed(cfg.seed, r)};
+    const size_t n = pnls.size();
+    MetricsAccumulator acc;
+
+    if (cfg.scheme == ResampleScheme::IID){
+        for (size_t k=0; k<n; ++k) acc.on_close(pnls[rng.below(n)]);
+    } else {
+        const size_t L = std::clamp<size_t>(cfg.block_len, 1, n);
+        size_t k = 0;
+        while (k < n){
+            size_t idx = rng.below(n);
+            for (size_t j=0; j<L && k<n; ++j, ++k){
+                acc.on_close(pnls[idx]);
+                if (++idx == n) idx = 0;   // blocchi circolari
+            }
+        }
+    }
+    return acc.finish();
+}
+
+// percentile (p in [0,1]) con interpolazione lineare; riordina v parzialmente
+double percentile_inplace(std::vector<double>& v, double p){
+    if (v.empty()) return NAN;
+    const double idx = p * (v.size()-1);
+    const size_t i = static_cast<size_t>(std::floor(idx));
+    const double w = idx - i;
+    std::nth_element(v.begin(), v.begin()+i, v.end());
+    const double vi = v[i];
+    if (w == 0.0 || i+1 >= v.size()) return vi;
+    const double vj = *std::min_element(v.begin()+i+1, v.end());
+    return (1.0 - w)*vi + w*vj;
+}
+
+TradeBootstrapResult run_config(const std::vector<double>& pnls,
+                                const TradeBootstrapConfig& cfg,
+                                unsigned n_threads)
+{
+    TradeBootstrapResult R;
+
+    MetricsAccumulator point;
+    for (double p : pnls) point.on_close(p);
+    const BacktestMetrics m0 = point.finish();
+    R.sharpe_bar.point = m0.sharpe_bar;
+    R.hit_ratio.point  = m0.hit_ratio;
+    R.avg_pnl.point    = m0.avg_pnl;
+    R.sum_pnl.point    = m0.sum_pnl;
+    R.max_dd.point     = m0.max_dd;
+
+    if (pnls.empty() || cfg.n_resamples == 0) return R;
+
+    const size_t B = cfg.n_resamples;
+    std::vector<double> sharpe(B), hit(B), avg(B), sum(B), dd(B);
+    if (cfg.keep_samples) R.samples.resize(B);
+
+    parallel_for(B, n_threads, [&](size_t b, size_t e, unsigned){
+        for (size_t r=b; r<e; ++r){
+            const BacktestMetrics m = one_replicate(pnls, cfg, r);
+            sharpe[r] = m.sharpe_bar;
+            hit[r]    = m.hit_ratio;
+            avg[r]    = m.avg_pnl;
+            sum[r]    = m.sum_pnl;
+            dd[r]     = m.max_dd;
+            if (cfg.keep_samples) R.samples[r] = m;
+        }
+    });
+
+    const double lo = 0.5*cfg.alpha, hi = 1.0 - 0.5*cfg.alpha;
+    auto ci = [&](std::vector<double>& col, MetricCI& out){
+        out.lo = percentile_inplace(col, lo);
+        out.hi = percentile_inplace(col, hi);
+    };
+    ci(sharpe, R.sharpe_bar);
+    ci(hit,    R.hit_ratio);
+    ci(avg,    R.avg_pnl);
+    ci(sum,    R.sum_pnl);
+    ci(dd,     R.max_dd);
+    return R;
+}
+
+} // anon
+
+TradeBootstrapResult bootstrap_trade_metrics(const std::vector<double>& pnls,
+                                             const TradeBootstrapConfig& cfg)
+{
+    trace::Scope trace_scope("trade_bootstrap");
+    return run_config(pnls, cfg, cfg.n_threads);
+}
+
+TradeBootstrapResult bootstrap_trade_metrics(const BacktestResult& bt,
+                                             const TradeBootstrapConfig& cfg)
+{
+    trace::Scope trace_scope("trade_bootstrap");
+    std::vector<double> pnls;
+    pnls.reserve(bt.trades.size());
+    for (const auto& t : bt.trades) pnls.push_back(t.pnl);
+    return run_config(pnls, cfg, cfg.n_threads);
+}
+
+std::vector<TradeBootstrapResult> bootstrap_trade_metrics_batch(
+    const std::vector<std::vector<double>>& pnls_per_config,
+    const TradeBootstrapConfig& cfg)
+{
+    std::vector<TradeBootstrapResult> out(pnls_per_config.size());
+    parallel_for(out.size(), cfg.n_threads, [&](size_t b, size_t e, unsigned){
+        for (size_t j=b; j<e; ++j) out[j] = run_config(pnls_per_config[j], cfg, 1);
+    });
+    return out;
+}
+
+} // namespace util
@@ -0,0 +1,404 @@
+#include "utilities/XlsxReader.hpp"
+#include "utilities/DataOrdering.hpp"
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace util {
+
+namespace {
+
+constexpr size_t IN_CHUNK  = 64 * 1024;    // byte compressi letti per volta
+constexpr size_t OUT_CHUNK = 256 * 1024;   // byte XML prodotti per refill
+
+std::uint16_t rd16(const unsigned char* p){ return std::uint16_t(p[0] | (p[1] << 8)); }
+std::uint32_t rd32(const unsigned char* p){ return std::uint32_t(rd16(p)) | (std::uint32_t(rd16(p+2)) << 16); }
+std::uint64_t rd64(const unsigned char* p){ return std::uint64_t(rd32(p)) | (std::uint64_t(rd32(p+4)) << 32); }
+
+// --------------------- zip ---------------------
+struct ZipEntry {
+    std::string name;
+    std::uint16_t method = 0;       // 0 stored, 8 deflate
+    std::uint64_t comp_size = 0;
+    std::uint64_t local_offset = 0;
+};
+
+std::vector<ZipEntry> read_central_directory(std::ifstream& f, const std::string& path)
+{
+    f.seekg(0, std::ios::end);
+    const std::uint64_t fsize = static_cast<std::uint64_t>(f.tellg());
+    const std::uint64_t tail  = std::min<std::uint64_t>(fsize, 22 + 65535);
+    std::vector<unsigned char> buf(tail);
+    f.seekg(static_cast<std::streamoff>(fsize - tail));
+    f.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(tail));
+
+    // End Of Central Directory: cercato a ritroso (può seguire un commento)
+    size_t eocd = std::string::npos;
+    for (size_t i = tail >= 22 ? tail - 22 + 1 : 0; i-- > 0; )
+        if (rd32(&buf[i]) == 0x06054b50u) { eocd = i; break; }
+    if (eocd == std::string::npos) throw std::runtime_error("XLSX is not a zip archive: " + path);
+
+    std::uint64_t n_entries = rd16(&buf[eocd + 10]);
+    std::uint64_t cd_size   = rd32(&buf[eocd + 12]);
+    std::uint64_t cd_offset = rd32(&buf[eocd + 16]);
+
+    // zip64: locator subito prima dell'EOCD
+    if ((cd_offset == 0xFFFFFFFFu || n_entries == 0xFFFFu) && eocd >= 20 &&
+        rd32(&buf[eocd - 20]) == 0x07064b50u)
+    {
+        const std::uint64_t eocd64 = rd64(&buf[eocd - 20 + 8]);
+        unsigned char h[56];
+        f.seekg(static_cast<std::streamoff>(eocd64));
+        f.read(reinterpret_cast<char*>(h), sizeof(h));
+        if (!f || rd32(h) != 0x06064b50u) throw std::runtime_error("XLSX: bad zip64 record: " + path);
+        n_entries = rd64(h + 32);
+        cd_size   = rd64(h + 40);
+        cd_offset = rd64(h + 48);
+    }
+
+    std::vector<unsigned char> cd(cd_size);
+    f.seekg(static_cast<std::streamoff>(cd_offset));
+    f.read(reinterpret_cast<char*>(cd.data()), static_cast<std::streamsize>(cd_size));
+    if (!f) throw std::runtime_error("XLSX: truncated central directory: " + path);
+
+    std::vector<ZipEntry> out;
+    out.reserve(n_entries);
+    size_t p = 0;
+    for (std::uint64_t k=0; k<n_entries; ++k){
+        if (p + 46 > cd.size() || rd32(&cd[p]) != 0x02014b50u)
+            throw std::runtime_error("XLSX: corrupt central directory: " + path);
+        ZipEntry e;
+        e.method       = rd16(&cd[p + 10]);
+        e.comp_size    = rd32(&cd[p + 20]);
+        std::uint64_t usize = rd32(&cd[p + 24]);
+        const size_t n_len = rd16(&cd[p + 28]);
+        const size_t x_len = rd16(&cd[p + 30]);
+        const size_t c_len = rd16(&cd[p + 32]);
+        e.local_offset = rd32(&cd[p + 42]);
+        e.name.assign(reinterpret_cast<const char*>(&cd[p + 46]), n_len);
+
+        // campo extra zip64 (0x0001): solo i valori saturati, in ordine fisso
+        for (size_t x = p + 46 + n_len; x + 4 <= p + 46 + n_len + x_len; ){
+            const std::uint16_t id = rd16(&cd[x]), sz = rd16(&cd[x + 2]);
+            if (id == 0x0001){
+                size_t q = x + 4;
+                if (usize == 0xFFFFFFFFu)          { usize = rd64(&cd[q]); q += 8; }
+                if (e.comp_size == 0xFFFFFFFFu)    { e.comp_size = rd64(&cd[q]); q += 8; }
+                if (e.local_offset == 0xFFFFFFFFu) { e.local_offset = rd64(&cd[q]); }
+            }
+            x += 4 + sz;
+        }
+        out.push_back(std::move(e));
+        p += 46 + n_len + x_len + c_len;
+    }
+    return out;
+}
+
+// Decompressione a blocchi di una singola entry
+class EntryStream {
+public:
+    EntryStream(const std::string& path, const ZipEntry& e)
+        : f_(path, std::ios::binary), method_(e.method), remaining_(e.comp_size)
+    {
+        if (!f_.is_open()) throw std::runtime_error("Cannot open XLSX: " + path);
+        if (method_ != 0 && method_ != 8)
+            throw std::runtime_error("XLSX: unsupported zip method for " + e.name);
+
+        unsigned char h[30];
+        f_.seekg(static_cast<std::streamoff>(e.local_offset));
+        f_.read(reinterpret_cast<char*>(h), sizeof(h));
+        if (!f_ || rd32(h) != 0x04034b50u) throw std::runtime_error("XLSX: bad local header for " + e.name);
+        f_.seekg(static_cast<std::streamoff>(e.local_offset + 30 + rd16(h + 26) + rd16(h + 28)));
+
+        if (method_ == 8){
+            std::memset(&zs_, 0, sizeof(zs_));
+            if (inflateInit2(&zs_, -MAX_WBITS) != Z_OK)   // raw deflate, senza header zlib
+                throw std::runtime_error("XLSX: inflateInit2 failed");
+            z_open_ = true;
+        }
+        in_.resize(IN_CHUNK);
+    }
+    ~EntryStream(){ if (z_open_) inflateEnd(&zs_); }
+
+    // appende fino a 'cap' byte decompressi a out; false a fine entry
+    bool read_into(std::string& out, size_t cap){
+        if (done_) return false;
+        const size_t base = out.size();
+        out.resize(base + cap);
+        char* dst = out.data() + base;
+        size_t produced = 0;
+
+        if (method_ == 0){
+            const size_t n = static_cast<size_t>(std::min<std::uint64_t>(cap, remaining_));
+            f_.read(dst, static_cast<std::streamsize>(n));
+            produced = static_cast<size_t>(f_.gcount());
+            remaining_ -= produced;
+            if (produced == 0 || remaining_ == 0) done_ = true;
+        } else {
+            zs_.next_out  = reinterpret_cast<Bytef*>(dst);
+            zs_.avail_out = static_cast<uInt>(cap);
+            while (zs_.avail_out > 0){
+                if (zs_.avail_in == 0 && remaining_ > 0){
+                    const size_t n = static_cast<size_t>(std::min<std::uint64_t>(in_.size(), remaining_));
+                    f_.read(reinterpret_cast<char*>(in_.data()), static_cast<std::streamsize>(n));
+                    const size_t got = static_cast<size_t>(f_.gcount());
+                    if (got == 0) throw std::runtime_error("XLSX: truncated entry");
+                    remaining_ -= got;
+                    zs_.next_in  = in_.data();
+                    zs_.avail_in = static_cast<uInt>(got);
+                }
+                const int rc = inflate(&zs_, Z_NO_FLUSH);
+                if (rc == Z_STREAM_END) { done_ = true; break; }
+                if (rc != Z_OK && rc != Z_BUF_ERROR) throw std::runtime_error("XLSX: inflate error");
+                if (rc == Z_BUF_ERROR && zs_.avail_in == 0 && remaining_ == 0)
+                    throw std::runtime_error("XLSX: truncated deflate stream");
+            }
+            produced = cap - zs_.avail_out;
+        }
+        out.resize(base + produced);
+        return produced > 0 || !done_;
+    }
+
+private:
+    std::ifstream f_;
+    std::uint16_t method_;
+    std::uint64_t remaining_;
+    z_stream zs_{};
+    bool z_open_ = false;
+    bool done_ = false;
+    std::vector<unsigned char> in_;
+};
+
+// --------------------- XML pull scanner ---------------------
+enum class Ev { Open, Close, Empty, Text, End };
+
+// Tokenizza tag e testo; le string_view valgono fino alla next() successiva
+class XmlScanner {
+public:
+    explicit XmlScanner(EntryStream& s) : src_(s) {}
+
+    Ev next(std::string_view& name, std::string_view& body){
+        for (;;){
+            if (pos_ >= buf_.size() && !refill()) return Ev::End;
+
+            if (buf_[pos_] != '<'){
+                size_t lt = buf_.find('<', pos_);
+                while (lt == std::string::npos && refill()) lt = buf_.find('<', pos_);
+                if (lt == std::string::npos) lt = buf_.size();
+                body = std::string_view(buf_).substr(pos_, lt - pos_);
+                pos_ = lt;
+                return Ev::Text;
+            }
+
+            size_t gt = buf_.find('>', pos_);
+            while (gt == std::string::npos && refill()) gt = buf_.find('>', pos_);
+            if (gt == std::string::npos) return Ev::End;     // tag troncato a fine file
+
+            std::string_view tag = std::string_view(buf_).substr(pos_ + 1, gt - pos_ - 1);
+            pos_ = gt + 1;
+            if (tag.empty() || tag[0] == '?' || tag[0] == '!') continue;   // prolog, commenti
+
+            Ev ev = Ev::Open;
+            if (tag[0] == '/') { ev = Ev::Close; tag.remove_prefix(1); }
+            else if (tag.back() == '/') { ev = Ev::Empty; tag.remove_suffix(1); }
+
+            size_t sp = 0;
+            while (sp < tag.size() && !is_ws(tag[sp])) ++sp;
+            name = tag.substr(0, sp);
+            if (const size_t colon = name.find(':'); colon != std::string_view::npos)
+                name.remove_prefix(colon + 1);                  // prefisso di namespace
+            body = tag.substr(sp);
+            return ev;
+        }
+    }
+
+private:
+    static bool is_ws(char c){ return c==' ' || c=='\t' || c=='\n' || c=='\r'; }
+
+    bool refill(){
+        buf_.erase(0, pos_);   // scarta il consumato: la memoria resta ~ OUT_CHUNK
+        pos_ = 0;
+        return src_.read_into(buf_, OUT_CHUNK);
+    }
+
+    EntryStream& src_;
+    std::string buf_;
+    size_t pos_ = 0;
+};
+
+// valore dell'attributo 'key' nel corpo del tag (vuoto se assente)
+std::string_view attr(std::string_view body, std::string_view key){
+    size_t p = 0;
+    while ((p = body.find(key, p)) != std::string_view::npos){
+        const size_t e = p + key.size();
+        const bool start_ok = (p == 0 || body[p-1] == ' ' || body[p-1] == '\t' ||
+                               body[p-1] == '\n' || body[p-1] == '\r');
+        if (start_ok && e + 1 < body.size() && body[e] == '=' && (body[e+1] == '"' || body[e+1] == '\'')){
+            const char q = body[e+1];
+            const size_t close = body.find(q, e + 2);
+            if (close == std::string_view::npos) return {};
+            return body.substr(e + 2, close - e - 2);
+        }
+        p = e;
+    }
+    return {};
+}
+
+void append_utf8(std::string& out, unsigned long cp){
+    if (cp < 0x80) out.push_back(char(cp));
+    else if (cp < 0x800) { out.push_back(char(0xC0 | (cp >> 6))); out.push_back(char(0x80 | (cp & 0x3F))); }
+    else if (cp < 0x10000) {
+        out.push_back(char(0xE0 | (cp >> 12)));
+        out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(char(0xF0 | (cp >> 18)));
+        out.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(char(0x80 | (cp & 0x3F)));
+    }
+}
+
+// testo XML -> out, con le entità predefinite e quelle numeriche
+void append_text(std::string& out, std::string_view s){
+    for (size_t i=0; i<s.size(); ++i){
+        if (s[i] != '&') { out.push_back(s[i]); continue; }
+        const size_t semi = s.find(';', i);
+        if (semi == std::string_view::npos) { out.append(s.substr(i)); return; }
+        const std::string_view ent = s.substr(i + 1, semi - i - 1);
+        if      (ent == "amp")  out.push_back('&');
+        else if (ent == "lt")   out.push_back('<');
+        else if (ent == "gt")   out.push_back('>');
+        else if (ent == "quot") out.push_back('"');
+        else if (ent == "apos") out.push_back('\'');
+        else if (!ent.empty() && ent[0] == '#'){
+            const bool hex = ent.size() > 1 && (ent[1] == 'x' || ent[1] == 'X');
+            append_utf8(out, std::strtoul(std::string(ent.substr(hex ? 2 : 1)).c_str(), nullptr, hex ? 16 : 10));
+        }
+        else out.append(s.substr(i, semi - i + 1));
+        i = semi;
+    }
+}
+
+// "BC12" -> 54 (0-based); npos se non c'è riferimento
+size_t column_of(std::string_view ref){
+    size_t col = 0, k = 0;
+    for (; k < ref.size() && ref[k] >= 'A' && ref[k] <= 'Z'; ++k)
+        col = col * 26 + size_t(ref[k] - 'A' + 1);
+    return k ? col - 1 : std::string::npos;
+}
+
+const ZipEntry* find_entry(const std::vector<ZipEntry>& dir, const std::string& name){
+    for (const auto& e : dir) if (e.name == name) return &e;
+    return nullptr;
+}
+
+} // anon
+
+// --------------------- reader ---------------------
+struct XlsxSheetReader::Impl {
+    std::vector<std::string> shared;
+    std::unique_ptr<EntryStream> stream;
+    std::unique_ptr<XmlScanner> xml;
+};
+
+XlsxSheetReader::XlsxSheetReader(const std::string& path, int sheet)
+    : p_(std::make_unique<Impl>())
+{
+    std::vector<ZipEntry> dir;
+    {
+        std::ifstream f(path, std::ios::binary);
+        if (!f.is_open()) throw std::runtime_error("Cannot open XLSX: " + path);
+        dir = read_central_directory(f, path);
+    }
+
+    // shared strings: <si> = <t> diretto oppure più run <r><t>; <rPh> (fonetica) esclusa
+    if (const ZipEntry* ss = find_entry(dir, "xl/sharedStrings.xml")){
+        EntryStream es(path, *ss);
+        XmlScanner x(es);
+        std::string cur;
+        bool in_t = false, in_rph = false;
+        std::string_view name, body;
+        for (Ev ev; (ev = x.next(name, body)) != Ev::End; ){
+            if (ev == Ev::Text) { if (in_t && !in_rph) append_text(cur, body); continue; }
+            if (name == "sst" && ev == Ev::Open){
+                const auto uc = attr(body, "uniqueCount");
+                if (!uc.empty()) p_->shared.reserve(std::strtoull(std::string(uc).c_str(), nullptr, 10));
+            }
+            else if (name == "si"){
+                if (ev == Ev::Open) cur.clear();
+                else { p_->shared.push_back(std::move(cur)); cur.clear(); }
+            }
+            else if (name == "t")   in_t   = (ev == Ev::Open);
+            else if (name == "rPh") in_rph = (ev == Ev::Open);
+        }
+    }
+
+    const std::string sheet_name = "xl/worksheets/sheet" + std::to_string(sheet) + ".xml";
+    const ZipEntry* se = find_entry(dir, sheet_name);
+    if (!se) throw std::runtime_error("XLSX: missing " + sheet_name + " in " + path);
+    p_->stream = std::make_unique<EntryStream>(path, *se);
+    p_->xml    = std::make_unique<XmlScanner>(*p_->stream);
+}
+
+XlsxSheetReader::~XlsxSheetReader() = default;
+
+const std::vector<std::string>& XlsxSheetReader::shared_strings() const { return p_->shared; }
+
+bool XlsxSheetReader::next_row(std::vector<std::string>& cells)
+{
+    cells.clear();
+    size_t col = 0;
+    std::string type, value;
+    bool in_cell = false, in_val = false, in_rph = false, any = false;
+
+    std::string_view name, body;
+    for (Ev ev; (ev = p_->xml->next(name, body)) != Ev::End; ){
+        if (ev == Ev::Text) { if (in_val && !in_rph) append_text(value, body); continue; }
+
+        if (name == "row"){
+            if (ev == Ev::Open) { cells.clear(); col = 0; any = false; }
+            else if (ev == Ev::Close && any) return true;      // righe vuote saltate
+        }
+        else if (name == "c"){
+            if (ev == Ev::Close){
+                if (type == "s" && !value.empty()){
+                    const size_t k = std::strtoull(value.c_str(), nullptr, 10);
+                    if (k >= p_->shared.size()) throw std::runtime_error("XLSX: shared string index out of range");
+                    value = p_->shared[k];
+                }
+                if (cells.size() <= col) cells.resize(col + 1);
+                if (!value.empty()) any = true;
+                cells[col] = std::move(value);
+                value.clear();
+                ++col; in_cell = false;
+                continue;
+            }
+            const size_t c = column_of(attr(body, "r"));
+            if (c != std::string::npos) col = c;
+            if (ev == Ev::Empty) { ++col; continue; }   // <c r="B2"/>: cella senza valore
+            type.assign(attr(body, "t"));
+            value.clear();
+            in_cell = true;
+        }
+        else if (name == "v" || name == "t"){
+            in_val = in_cell && (ev == Ev::Open);
+        }
+        else if (name == "rPh"){
+            in_rph = (ev == Ev::Open);
+        }
+    }
+    return any;
+}
+
+std::string excel_serial_to_iso(double serial){
+    // 25569 = 1970-01-01 nel sistema 1900; arrotondato al secondo
+    const auto secs = static_cast<std::int64_t>(std::llround((serial - 25569.0) * 86400.0));
+    return epoch_seconds_to_iso(secs);
+}
+
+} // namespace util
@@ -9,17 +9,359 @@
 #include <iomanip>
 #include <string>
 #include <sstream>
+#include <cstdlib>
+#include <tuple>
+#include <thread>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
 
 #include "utilities/DataOrdering.hpp"
 #include "utilities/Loaders.hpp"
 #include "utilities/StatisticalBootstrap.hpp"
 #include "utilities/OptimalBands.hpp"
 #include "utilities/Backtest.hpp"
+#include "utilities/TradeBootstrap.hpp"
+#include "utilities/ResultWriter.hpp"
+#include "utilities/RunOutputs.hpp"
+#include "utilities/TaskGraph.hpp"
+#include "utilities/StageCache.hpp"
+#include "utilities/BatchRunner.hpp"
+#include "utilities/StreamingPipeline.hpp"
+#include "utilities/MarketFeed.hpp"
+#include "utilities/OutOfCore.hpp"
+#include "utilities/CompactPrices.hpp"
+#include "utilities/Trace.hpp"
+
+// opzione "--nome [valore]" dei modi a job file (argv[3..])
+struct CliOption {
+    const char* name;
+    bool has_value;
+    std::function<void(const char*)> apply;     // valore, nullptr se has_value == false
+};
+
+// false (con messaggio) su opzione sconosciuta o senza il suo valore
+static bool parse_options(int argc, char** argv, std::initializer_list<CliOption> opts){
+    for (int i=3; i<argc; ++i){
+        const std::string a = argv[i];
+        const CliOption* o = nullptr;
+        for (const auto& c : opts) if (a == c.name) { o = &c; break; }
+        if (!o || (o->has_value && i+1 >= argc)){
+            std::cerr << "[Errore] opzione sconosciuta: " << a << "\n";
+            return false;
+        }
+        o->apply(o->has_value ? argv[++i] : nullptr);
+    }
+    return true;
+}
+
+// ARBITRAGE_TRACE attivo: tempi per stadio su stderr + traccia JSON (Chrome)
+static void finish_trace(const std::string& trace_path){
+    if (trace_path.empty()) return;
+    util::trace::write_summary(std::cerr);
+    if (util::trace::write_chrome_trace(trace_path)) std::cerr << "[trace] " << trace_path << "\n";
+    else std::cerr << "[Warn] cannot write " << trace_path << "\n";
+}
+
+// Arbitrage_cpp --batch jobs.ini [--threads N] [--max-live N] [--summary file.csv]
+static int batch_main(int argc, char** argv){
+    using namespace util;
+
+    const std::string trace_path = trace::enable_from_env();
+    StageCache cache = StageCache::from_env();
+
+    BatchOptions opt;
+    opt.cache = &cache;
+    if (const char* env = std::getenv("ARBITRAGE_THREADS"))
+        opt.n_threads = static_cast<unsigned>(std::strtoul(env, nullptr, 10));
+    std::string summary = "outputs/batch/summary.csv";
+    if (!parse_options(argc, argv, {
+            {"--threads",  true, [&](const char* v){ opt.n_threads = static_cast<unsigned>(std::strtoul(v, nullptr, 10)); }},
+            {"--max-live", true, [&](const char* v){ opt.max_live_inputs = std::strtoul(v, nullptr, 10); }},
+            {"--summary",  true, [&](const char* v){ summary = v; }}}))
+        return 1;
+
+    const auto specs = parse_job_file(argv[2]);
+    std::cout << "=== Arbitrage C++ Batch === " << specs.size() << " run da " << argv[2] << "\n";
+
+    const auto R = run_batch(specs, opt);
+
+    std::cout << std::left << std::setw(40) << "run" << std::right
+              << std::setw(8) << "trades" << std::setw(12) << "sum pnl"
+              << std::setw(12) << "sharpe" << "  stato\n";
+    for (const auto& o : R.runs){
+        std::cout << std::left << std::setw(40) << o.name << std::right;
+        if (o.ok) std::cout << std::setw(8) << o.metrics.n_trades << std::setw(12) << o.metrics.sum_pnl
+                            << std::setw(12) << o.metrics.sharpe_bar << "  ok\n";
+        else      std::cout << std::setw(32) << "" << "  ERRORE: " << o.error << "\n";
+    }
+    std::cout << "\n[Batch] " << specs.size() << " run (" << R.n_failed << " fallite) in " << R.wall_s << " s"
+              << " -> " << R.runs_per_hour << " run/ora | stadi eseguiti " << R.stages_executed
+              << " su " << R.stages_requested << " richiesti\n";
+    if (cache.enabled())
+        std::cerr << "[cache] " << cache.dir() << ": " << cache.hits() << " hit, "
+                  << cache.misses() << " miss\n";
+
+    if (write_batch_summary(summary, R)) std::cout << "[Info] Salvato: " << summary << "\n";
+    else std::cerr << "[Warn] cannot write " << summary << "\n";
+
+    finish_trace(trace_path);
+    return R.n_failed ? 2 : 0;
+}
+
+// Arbitrage_cpp --stream jobs.ini [--batch-rows N] [--ring N]
+// ogni run del job file come pipeline concorrente parse -> clean -> backtest
+static int stream_main(int argc, char** argv){
+    using namespace util;
+
+    const std::string trace_path = trace::enable_from_env();
 
-int main() {
+    StreamingPipelineOptions opt;
+    if (!parse_options(argc, argv, {
+            {"--batch-rows", true, [&](const char* v){ opt.batch_rows   = std::strtoul(v, nullptr, 10); }},
+            {"--ring",       true, [&](const char* v){ opt.ring_batches = std::strtoul(v, nullptr, 10); }}}))
+        return 1;
+
+    const auto specs = parse_job_file(argv[2]);
+    std::cout << "=== Arbitrage C++ Stream === " << specs.size() << " run da " << argv[2] << "\n";
+    std::cout << std::left << std::setw(40) << "run" << std::right
+              << std::setw(8) << "trades" << std::setw(12) << "sum pnl"
+              << std::setw(12) << "sharpe" << std::setw(12) << "1a OS ms"
+              << std::setw(10) << "wall ms" << std::setw(9) << "stalli" << "  stato\n";
+
+    size_t n_failed = 0;
+    for (const auto& s : specs){
+        try {
+            const auto R = run_streaming_pipeline(s, opt);
+            std::cout << std::left << std::setw(40) << s.name << std::right
+                      << std::setw(8) << R.metrics.n_trades << std::setw(12) << R.metrics.sum_pnl
+                      << std::setw(12) << R.metrics.sharpe_bar
+                      << std::setw(12) << std::fixed << std::setprecision(1) << R.first_os_ms
+                      << std::setw(10) << R.wall_ms << std::defaultfloat << std::setprecision(6)
+                      << std::setw(9) << (R.parser_stalls + R.cleaner_stalls) << "  ok";
+            if (R.out_of_order) std::cout << " (" << R.out_of_order << " righe fuori ordine)";
+            std::cout << "\n";
+        } catch (const std::exception& ex) {
+            ++n_failed;
+            std::cout << std::left << std::setw(40) << s.name << std::right
+                      << std::setw(63) << "" << "  ERRORE: " << ex.what() << "\n";
+        }
+    }
+
+    finish_trace(trace_path);
+    return n_failed ? 2 : 0;
+}
+
+// Arbitrage_cpp --replay jobs.ini [--role both|serve|consume] [--udp] [--speed S]
+//                                [--host H] [--port P]
+// prima run del job file: OS pulito in replay su socket locale, consumer epoll che
+// fa girare il backtest tick per tick e misura la latenza tick -> decisione
+static int replay_main(int argc, char** argv){
+    using namespace util;
+
+    const std::string trace_path = trace::enable_from_env();
+
+    std::string role = "both";
+    ReplayConfig rc;
+    FeedConsumerConfig cc;
+    if (!parse_options(argc, argv, {
+            {"--udp",   false, [&](const char*){ rc.transport = cc.transport = FeedTransport::Udp; }},
+            {"--role",  true,  [&](const char* v){ role = v; }},
+            {"--speed", true,  [&](const char* v){ rc.speed = std::strtod(v, nullptr); }},
+            {"--host",  true,  [&](const char* v){ rc.host = cc.host = v; }},
+            {"--port",  true,  [&](const char* v){ rc.port = cc.port = static_cast<std::uint16_t>(std::strtoul(v, nullptr, 10)); }}}))
+        return 1;
+    if (role != "both" && role != "serve" && role != "consume"){
+        std::cerr << "[Errore] --role: both, serve o consume\n";
+        return 1;
+    }
+
+    const auto specs = parse_job_file(argv[2]);
+    if (specs.empty()) { std::cerr << "[Errore] nessuna run in " << argv[2] << "\n"; return 1; }
+    const RunSpec& s = specs.front();
+
+    // stessi stadi di run_batch: load, split, pulizia, OU, costo, bande
+    const RunCalibration K = calibrate_run(s);
+    const PriceTable& clean_OS = K.clean_OS;
+    const BacktestConfig& cfg = K.cfg;
+    const char* transport = rc.transport == FeedTransport::Tcp ? "tcp" : "udp";
+    std::cout << "=== Arbitrage C++ Replay === run " << s.name << ": " << clean_OS.size()
+              << " tick OS, " << transport << ", speed " << (rc.speed > 0.0 ? std::to_string(rc.speed) : "max") << "\n";
+
+    std::optional<ReplayServer> server;
+    std::optional<FeedConsumer> consumer;
+    if (role != "consume" && rc.transport == FeedTransport::Tcp) { server.emplace(rc); cc.port = server->port(); }
+    if (role != "serve"){
+        consumer.emplace(cc);
+        if (rc.transport == FeedTransport::Udp) rc.port = consumer->port();
+    }
+    if (role != "consume" && !server) server.emplace(rc);
+    if (role == "serve") std::cout << "[Info] server su " << rc.host << ":" << server->port() << "\n";
+
+    // server su un thread (role both), consumer su questo
+    ReplayStats sent;
+    std::exception_ptr server_err;
+    std::thread server_thread;
+    if (server && consumer){
+        server_thread = std::thread([&]{
+            try { sent = server->run(clean_OS); }
+            catch (...) { server_err = std::current_exception(); }
+        });
+    } else if (server) sent = server->run(clean_OS);
+
+    int rc_exit = 0;
+    if (consumer){
+        StreamingBacktester bt(cfg);
+        FeedConsumerStats got;
+        try { got = consumer->run(bt); }
+        catch (...) {
+            consumer.reset();               // socket chiuso: il send del server fallisce ed esce
+            if (server_thread.joinable()) server_thread.join();
+            throw;
+        }
+        if (server_thread.joinable()) server_thread.join();
+        if (server_err) std::rethrow_exception(server_err);
+
+        std::cout << "[Feed] " << got.messages << " tick ricevuti, " << got.lost << " persi, "
+                  << got.reordered << " fuori ordine scartati, "
+                  << got.wakeups << " risvegli epoll" << (got.got_end ? "" : " (senza End: timeout)") << "\n";
+        std::cout << "[Latenza] " << got.latency.summary() << "\n";
+        std::cout << "[Backtest] trades " << got.metrics.n_trades << " | sum pnl " << got.metrics.sum_pnl
+                  << " | sharpe " << got.metrics.sharpe_bar << "\n";
+
+        // nessun tick perso => stesso risultato di backtest_os sulla tabella
+        if (got.lost == 0 && got.reordered == 0 && got.messages == clean_OS.size()){
+            const auto ref = backtest_os(clean_OS, cfg).metrics;
+            const bool same = ref.n_trades == got.metrics.n_trades && ref.sum_pnl == got.metrics.sum_pnl;
+            std::cout << "[Check] backtest_os: " << (same ? "identico" : "DIVERSO") << "\n";
+            if (!same) rc_exit = 2;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories("outputs/replay", ec);
+        const std::string path = std::string("outputs/replay/latency_") + transport + ".csv";
+        if (got.latency.write_percentiles_csv(path)) std::cout << "[Info] Salvato: " << path << "\n";
+        else std::cerr << "[Warn] cannot write " << path << "\n";
+    }
+    if (server) std::cout << "[Server] " << sent.messages << " tick in " << sent.wall_s << " s ("
+                          << sent.msgs_per_s << " msg/s)\n";
+
+    finish_trace(trace_path);
+    return rc_exit;
+}
+
+// Arbitrage_cpp --ooc jobs.ini [--mem MiB] [--chunk-rows N] [--keep]
+// run su storici più grandi della RAM: sort esterno su file colonnari a chunk
+static int ooc_main(int argc, char** argv){
+    using namespace util;
+
+    const std::string trace_path = trace::enable_from_env();
+
+    OutOfCoreConfig cfg;
+    if (!parse_options(argc, argv, {
+            {"--mem",        true,  [&](const char* v){ cfg.memory_limit = std::strtoull(v, nullptr, 10) << 20; }},
+            {"--chunk-rows", true,  [&](const char* v){ cfg.chunk_rows = std::strtoull(v, nullptr, 10); }},
+            {"--keep",       false, [&](const char*){ cfg.keep_sorted = true; }}}))
+        return 1;
+
+    const auto specs = parse_job_file(argv[2]);
+    std::cout << "=== Arbitrage C++ Out-of-core === " << specs.size() << " run da " << argv[2]
+              << " (limite " << (cfg.memory_limit >> 20) << " MiB)\n";
+    std::cout << std::left << std::setw(40) << "run" << std::right
+              << std::setw(10) << "righe" << std::setw(6) << "run" << std::setw(7) << "merge"
+              << std::setw(8) << "trades" << std::setw(12) << "sum pnl"
+              << std::setw(12) << "sharpe" << std::setw(10) << "wall ms" << "  stato\n";
+
+    size_t n_failed = 0;
+    for (const auto& s : specs){
+        try {
+            const auto R = run_out_of_core(s, cfg);
+            std::cout << std::left << std::setw(40) << s.name << std::right
+                      << std::setw(10) << R.import.rows << std::setw(6) << R.import.runs
+                      << std::setw(7) << R.import.merge_passes
+                      << std::setw(8) << R.metrics.n_trades << std::setw(12) << R.metrics.sum_pnl
+                      << std::setw(12) << R.metrics.sharpe_bar
+                      << std::setw(10) << std::fixed << std::setprecision(1) << R.wall_ms
+                      << std::defaultfloat << std::setprecision(6) << "  ok";
+            if (R.import.bad_time) std::cout << " (" << R.import.bad_time << " righe con Time non valido)";
+            std::cout << "\n";
+        } catch (const std::exception& ex) {
+            ++n_failed;
+            std::cout << std::left << std::setw(40) << s.name << std::right
+                      << std::setw(75) << "" << "  ERRORE: " << ex.what() << "\n";
+        }
+    }
+
+    finish_trace(trace_path);
+    return n_failed ? 2 : 0;
+}
+
+// Arbitrage_cpp --compact jobs.ini [--storage f32|ticks]
+// prezzi a 32 bit (float o mezzi tick), Rt, costi e stime in double
+static int compact_main(int argc, char** argv){
+    using namespace util;
+
+    const std::string trace_path = trace::enable_from_env();
+
+    PriceStorage mode = PriceStorage::Float32;
+    if (!parse_options(argc, argv, {
+            {"--storage", true, [&](const char* v){ mode = parse_price_storage(v); }}}))
+        return 1;
+
+    const auto specs = parse_job_file(argv[2]);
+    std::cout << "=== Arbitrage C++ Compact === " << specs.size() << " run da " << argv[2]
+              << " (prezzi " << price_storage_name(mode) << ", " << CompactPriceTable::ROW_BYTES
+              << " byte/riga)\n";
+    std::cout << std::left << std::setw(40) << "run" << std::right
+              << std::setw(10) << "righe" << std::setw(10) << "MiB"
+              << std::setw(8) << "trades" << std::setw(12) << "sum pnl"
+              << std::setw(12) << "sharpe" << std::setw(10) << "wall ms" << "  stato\n";
+
+    size_t n_failed = 0;
+    for (const auto& s : specs){
+        try {
+            const auto R = run_compact(s, mode);
+            std::cout << std::left << std::setw(40) << s.name << std::right
+                      << std::setw(10) << R.rows
+                      << std::setw(10) << std::fixed << std::setprecision(1) << double(R.table_bytes) / (1 << 20)
+                      << std::defaultfloat << std::setprecision(6)
+                      << std::setw(8) << R.metrics.n_trades << std::setw(12) << R.metrics.sum_pnl
+                      << std::setw(12) << R.metrics.sharpe_bar
+                      << std::setw(10) << std::fixed << std::setprecision(1) << R.wall_ms
+                      << std::defaultfloat << std::setprecision(6) << "  ok";
+            if (R.bad_time) std::cout << " (" << R.bad_time << " righe con Time non valido)";
+            std::cout << "\n";
+        } catch (const std::exception& ex) {
+            ++n_failed;
+            std::cout << std::left << std::setw(40) << s.name << std::right
+                      << std::setw(62) << "" << "  ERRORE: " << ex.what() << "\n";
+        }
+    }
+
+    finish_trace(trace_path);
+    return n_failed ? 2 : 0;
+}
+
+int main(int argc, char** argv) {
     using namespace util;
 
     try {
+        // --batch: molte run descritte da un job file, senza ricompilare
+        if (argc >= 3 && std::string(argv[1]) == "--batch") return batch_main(argc, argv);
+        // --stream: stesse run, stadi concorrenti su ring SPSC (primo risultato prima della fine del file)
+        if (argc >= 3 && std::string(argv[1]) == "--stream") return stream_main(argc, argv);
+        // --replay: feed locale su socket + consumer epoll, latenza tick -> decisione
+        if (argc >= 3 && std::string(argv[1]) == "--replay") return replay_main(argc, argv);
+        // --ooc: storici oltre la RAM, sort esterno e passate a chunk con tetto di memoria
+        if (argc >= 3 && std::string(argv[1]) == "--ooc") return ooc_main(argc, argv);
+        // --compact: prezzi a 32 bit in memoria, accumulazioni in double
+        if (argc >= 3 && std::string(argv[1]) == "--compact") return compact_main(argc, argv);
+
+        // ARBITRAGE_TRACE=1 (o un percorso): tempi per stadio su stderr + traccia JSON
+        const std::string trace_path = trace::enable_from_env();
+        // ARBITRAGE_CACHE=1 (o una cartella): output degli stadi su disco, chiave = hash degli input
+        StageCache cache = StageCache::from_env();
+
         std::cout << "=== Arbitrage C++ Pipeline ===\n";
 
         /// LOAD
@@ -44,9 +386,16 @@ int main() {
         const std::optional<std::string> start_date = "2015-04-22";
         const std::optional<std::string> end_date   = "2016-04-22";
 
-        auto tbl = load_and_process_price_data_csv(
-            csv_path, time_col, bid_ask_cols, mid_cols, ticks, convs, start_date, end_date
-        );
+        auto tbl = cache.get_or_compute<PriceTable>("load",
+            [&](Hasher& h){
+                h.add_file(csv_path).add(time_col).add(bid_ask_cols).add(mid_cols)
+                 .add(ticks).add(convs).add(start_date).add(end_date);
+            },
+            [&]{
+                return load_and_process_price_data_csv(
+                    csv_path, time_col, bid_ask_cols, mid_cols, ticks, convs, start_date, end_date
+                );
+            });
 
         std::cout << "Righe caricate: " << tbl.size() << "\n";
         for (size_t i=0; i<std::min<size_t>(5, tbl.size()); ++i){
@@ -61,20 +410,168 @@ int main() {
             return 1;
         }
 
-        /// TRIM & SPLIT
+        /// PARAMETRI
+
+        const std::vector<double> l_list = {-1.282, -1.645, -1.96, -2.326};
+
+        struct FCase { std::string label; double value; };
+        const std::vector<FCase> f_list = {
+            {"1",   1.0},
+            {"2",   2.0},
+            {"5",   5.0},
+            {"opt", std::numeric_limits<double>::quiet_NaN()} // NaN => calcola f*
+        };
+
+        const double   alphaCI = 0.05;   // 95% CI
+        const uint64_t seed    = 42;
+
+        int    M_opt  = 100000;
+        double alpha  = 0.05;
+        int    grid   = 100;
+
+        // setup del backtest (esempio: l = -1.96, f = 1)
+        double l_bt = -1.96;
+        double f_bt = 1.0;
+
+        /// PIPELINE come DAG: stadi indipendenti in parallelo, stampe dopo nell'ordine originale
+        // ARBITRAGE_THREADS=1 => esecuzione seriale deterministica (debug); 0/assente => tutti i core
+
+        PriceTable data_IS_8_16, data_OS, data_IS_9_16;
+        OutlierResult out_IS_8_16, out_IS_9_16, out_OS;
+        stats::OUBootstrapResult R_8_16, R_9_16;
+        double C = 0.0;
+        size_t C_count = 0;
+        std::vector<OptimalBandsResult> bands(l_list.size() * f_list.size());
+        OptimalBandsResult bands_bt;
+        BacktestResult BT;
+        util::TradeBootstrapConfig tb;
+        tb.n_resamples = 10000;
+        tb.scheme      = util::ResampleScheme::IID;
+        tb.alpha       = 0.05;
+        util::TradeBootstrapResult BT_CI;
+
+        TaskGraph g;
+        // ogni nodo passa dalla cache: la chiave include il *contenuto* degli output a monte
+        const CacheKey tbl_key = cache.enabled() ? Hasher().add(tbl).key() : CacheKey{};
 
-        auto [data_IS_8_16, data_OS] = trim_and_split_price_table(
-            tbl, /*IS 8-16*/ 8, 16, /*OS exclude 17-20*/ 17, 20, /*split months*/ 9
-        );
-        auto [data_IS_9_16, _trash] = trim_and_split_price_table(
-            tbl, /*IS 9-16*/ 9, 16, /*OS exclude 17-20*/ 17, 20, /*split months*/ 9
-        );
+        /// TRIM & SPLIT
+        const auto split_8_16 = g.add("split_IS_8_16", [&]{
+            std::tie(data_IS_8_16, data_OS) = cache.get_or_compute<std::pair<PriceTable, PriceTable>>(
+                "split_IS_8_16",
+                [&](Hasher& h){ h.add(tbl_key).add(8.0).add(16.0).add(17.0).add(20.0).add(9); },
+                [&]{
+                    return trim_and_split_price_table(
+                        tbl, /*IS 8-16*/ 8, 16, /*OS exclude 17-20*/ 17, 20, /*split months*/ 9
+                    );
+                });
+        });
+        const auto split_9_16 = g.add("split_IS_9_16", [&]{
+            data_IS_9_16 = cache.get_or_compute<PriceTable>("split_IS_9_16",
+                [&](Hasher& h){ h.add(tbl_key).add(9.0).add(16.0).add(17.0).add(20.0).add(9); },
+                [&]{
+                    return trim_and_split_price_table(
+                        tbl, /*IS 9-16*/ 9, 16, /*OS exclude 17-20*/ 17, 20, /*split months*/ 9
+                    ).first;
+                });
+        });
 
         /// OUTLIERS
+        auto cached_outliers = [&](const char* stage, const PriceTable& in){
+            return cache.get_or_compute<OutlierResult>(stage,
+                [&](Hasher& h){ h.add(in); }, [&]{ return remove_outliers(in); });
+        };
+        const auto clean_8_16 = g.add("clean_IS_8_16", [&]{ out_IS_8_16 = cached_outliers("clean_IS_8_16", data_IS_8_16); }, {split_8_16});
+        const auto clean_9_16 = g.add("clean_IS_9_16", [&]{ out_IS_9_16 = cached_outliers("clean_IS_9_16", data_IS_9_16); }, {split_9_16});
+        const auto clean_os   = g.add("clean_OS",      [&]{ out_OS      = cached_outliers("clean_OS", data_OS);           }, {split_8_16});
+
+        /// BOOTSTRAP OU
+        auto cached_boot = [&](const char* stage, const PriceTable& in, int M_boot){
+            return cache.get_or_compute<stats::OUBootstrapResult>(stage,
+                [&](Hasher& h){ h.add(in).add(M_boot).add(alphaCI).add(seed); },
+                [&]{ return stats::ou_bootstrap(in, M_boot, alphaCI, seed); });
+        };
+        // IS 8-16: M=1000 (stessa stima usata per bande e backtest: calcolata una volta)
+        const auto boot_8_16 = g.add("ou_boot_IS_8_16", [&]{
+            R_8_16 = cached_boot("ou_boot_IS_8_16", out_IS_8_16.clean, 1000);
+        }, {clean_8_16});
+        // IS 9-16: M=10000
+        g.add("ou_boot_IS_9_16", [&]{
+            R_9_16 = cached_boot("ou_boot_IS_9_16", out_IS_9_16.clean, 10000);
+        }, {clean_9_16});
+
+        /// COSTO DI TRANSAZIONE MEDIO (su IS 9-16)
+        const auto cost = g.add("transaction_cost", [&]{
+            // (C, n): come nel Python, dataset grezzo IS 9–16
+            const auto sc = cache.get_or_compute<std::pair<double, double>>("transaction_cost_v2",
+                [&](Hasher& h){ h.add(data_IS_9_16); },
+                [&]{
+                    size_t n = 0;
+                    const double avg = avg_log_cost(data_IS_9_16, &n);
+                    return std::pair<double, double>(avg, static_cast<double>(n));
+                });
+            C = sc.first;
+            C_count = static_cast<size_t>(sc.second);
+        }, {split_9_16});
+
+        auto cached_bands = [&](double l, double f, int M, double a, int gr){
+            return cache.get_or_compute<OptimalBandsResult>("optimal_bands",
+                [&](Hasher& h){ h.add(M).add(l).add(f).add(R_8_16.k).add(R_8_16.sigma).add(C).add(a).add(gr); },
+                [&]{ return util::optimal_trading_bands(M, l, f, R_8_16.k, R_8_16.sigma, C, a, gr); });
+        };
 
-        auto out_IS_8_16 = remove_outliers(data_IS_8_16);
-        auto out_IS_9_16 = remove_outliers(data_IS_9_16);
-        auto out_OS      = remove_outliers(data_OS);
+        /// OPTIMAL BANDS sweep su l e f: una cella per nodo
+        for (size_t il=0; il<l_list.size(); ++il)
+            for (size_t jf=0; jf<f_list.size(); ++jf)
+                g.add("bands_cell", [&, il, jf]{
+                    bands[il * f_list.size() + jf] =
+                        cached_bands(l_list[il], f_list[jf].value, M_opt, alpha, grid);
+                }, {boot_8_16, cost});
+
+        /// BACKTEST OS
+        const auto bands_for_bt = g.add("bands_backtest", [&]{
+            bands_bt = cached_bands(l_bt, f_bt, /*M=*/100000, /*alpha=*/0.05, /*grid=*/100);
+        }, {boot_8_16, cost});
+
+        const auto backtest = g.add("backtest", [&]{
+            util::BacktestConfig cfg;
+            cfg.k_hat     = R_8_16.k;
+            cfg.eta_hat   = R_8_16.eta;
+            cfg.sigma_hat = R_8_16.sigma;
+            cfg.d = -std::abs(bands_bt.d_estimated);  // per sicurezza negativo
+            cfg.u =  std::abs(bands_bt.u_estimated);
+            cfg.l = l_bt;
+            cfg.f = f_bt;
+            cfg.symmetric = true; // attiva lato short
+            BT = cache.get_or_compute<BacktestResult>("backtest",
+                [&](Hasher& h){
+                    h.add(out_OS.clean).add(cfg.k_hat).add(cfg.eta_hat).add(cfg.sigma_hat)
+                     .add(cfg.d).add(cfg.u).add(cfg.l).add(cfg.f)
+                     .add(cfg.symmetric).add(cfg.cost).add(cfg.record);
+                },
+                [&]{ return util::backtest_os(out_OS.clean, cfg); });
+        }, {bands_for_bt, clean_os});
+
+        // ---- CI delle metriche (bootstrap sui PnL dei trade) ----
+        g.add("trade_boot", [&]{
+            BT_CI = cache.get_or_compute<util::TradeBootstrapResult>("trade_bootstrap",
+                [&](Hasher& h){
+                    h.add(BT.trades.size());
+                    for (const auto& t : BT.trades) h.add(t.pnl);
+                    h.add(tb.n_resamples).add(tb.scheme).add(tb.block_len).add(tb.alpha)
+                     .add(tb.seed).add(tb.keep_samples);
+                },
+                [&]{ return util::bootstrap_trade_metrics(BT, tb); });
+        }, {backtest});
+
+        {
+            const char* env = std::getenv("ARBITRAGE_THREADS");
+            g.run(env ? static_cast<unsigned>(std::strtoul(env, nullptr, 10)) : 0u);
+        }
+        if (trace::enabled())
+            std::cerr << "[trace] critical path: " << g.critical_path_ms() << " ms\n";
+        if (cache.enabled())
+            std::cerr << "[cache] " << cache.dir() << ": " << cache.hits() << " hit, "
+                      << cache.misses() << " miss\n";
 
         const auto& clean_IS_8_16 = out_IS_8_16.clean;
         const auto& clean_IS_9_16 = out_IS_9_16.clean;
@@ -90,137 +587,24 @@ int main() {
                   << " -> clean: " << clean_OS.size()
                   << " | outliers: " << out_OS.outliers.size() << "\n";
 
-        /// BOOTSTRAP OU
+        std::cout << "\nEstimates for IS dataset (8-16):\n";
+        stats::print_ou_estimates(R_8_16);
 
-        // IS 8-16: M=1000
-        {
-            int    M_boot  = 1000;
-            double alphaCI = 0.05;   // 95% CI
-            uint64_t seed  = 42;
+        std::cout << "\nEstimates for IS dataset (9-16):\n";
+        stats::print_ou_estimates(R_9_16);
 
-            auto R = stats::ou_bootstrap(clean_IS_8_16, M_boot, alphaCI, seed);
-            std::cout << "\nEstimates for IS dataset (8-16):\n";
-            stats::print_ou_estimates(R);
-        }
+        if (C_count == 0)
+            std::cerr << "[Warn] Nessuna osservazione valida per il costo C; metto C=0.\n";
+        std::cout << "\n[Info] C (avg log-transaction cost) = " << C << " (n=" << C_count << ")\n";
 
-        // IS 9-16: M=10000
-        stats::OUBootstrapResult R_9_16;
-        {
-            int    M_boot  = 10000;
-            double alphaCI = 0.05;   // 95% CI
-            uint64_t seed  = 42;
+        std::cout << "\nEstimates for IS dataset (8-16):\n";
+        stats::print_ou_estimates(R_8_16);
 
-            R_9_16 = stats::ou_bootstrap(clean_IS_9_16, M_boot, alphaCI, seed);
-            std::cout << "\nEstimates for IS dataset (9-16):\n";
-            stats::print_ou_estimates(R_9_16);
-        }
-
-        /// COSTO DI TRANSAZIONE MEDIO (su IS 9-16)
-
-        double C = 0.0;
-        {
-            double sum = 0.0;
-            size_t count = 0;
-            for (const auto& r : data_IS_9_16) { // come nel Python: dataset grezzo IS 9–16
-                if (r.Bid1 > 0.0 && r.Ask1 > 0.0 && r.Bid2 > 0.0 && r.Ask2 > 0.0) {
-                    double ct = std::log(r.Ask1 / r.Bid1) + std::log(r.Ask2 / r.Bid2);
-                    if (std::isfinite(ct)) { sum += ct; ++count; }
-                }
-            }
-            if (count == 0) {
-                std::cerr << "[Warn] Nessuna osservazione valida per il costo C; metto C=0.\n";
-                C = 0.0;
-            } else {
-                C = sum / static_cast<double>(count);
-            }
-            std::cout << "\n[Info] C (avg log-transaction cost) = " << C << " (n=" << count << ")\n";
-        }
-
-        /// OPTIMAL BANDS sweep su l e f
-
-        const std::vector<double> l_list = {-1.282, -1.645, -1.96, -2.326};
-
-        struct FCase { std::string label; double value; };
-        const std::vector<FCase> f_list = {
-            {"1",   1.0},
-            {"2",   2.0},
-            {"5",   5.0},
-            {"opt", std::numeric_limits<double>::quiet_NaN()} // NaN => calcola f*
-        };
-
-        // Prendi i point estimates OU dal bootstrap IS 8–1
-
-        ///  4) BOOTSTRAP OU
-
-        // IS 8-16: M=1000
-        stats::OUBootstrapResult R_8_16;
-        {
-            int    M_boot  = 1000;
-            double alphaCI = 0.05;   // 95% CI
-            uint64_t seed  = 42;
-
-            R_8_16 = stats::ou_bootstrap(clean_IS_8_16, M_boot, alphaCI, seed);
-            std::cout << "\nEstimates for IS dataset (8-16):\n";
-            stats::print_ou_estimates(R_8_16);
-        }
-        double k_hat     = R_8_16.k;
-        double sigma_hat = R_8_16.sigma;
-
-        int    M_opt  = 100000;
-        double alpha  = 0.05;
-        int    grid   = 100;
-
-        auto fmt6 = [](double x)->std::string{
-            std::ostringstream oss;
-            if (std::isfinite(x)) { oss << std::fixed << std::setprecision(6) << x; }
-            return oss.str();
-        };
-
-        struct Row {
-            double l;
-            std::string f_label;
-            double d_star, d_low, d_high;
-            double u_star, u_low, u_high;
-            double mu, mu_low, mu_high;
-            std::string f_star_str;
-            std::string f_low_str, f_high_str;
-        };
-        std::vector<Row> results;
-
-        for (double l : l_list) {
-            for (const auto& fcase : f_list) {
-                auto Rbands = util::optimal_trading_bands(
-                    M_opt, l, fcase.value,
-                    k_hat, sigma_hat,
-                    C, alpha, grid
-                );
-
-                Row row;
-                row.l       = l;
-                row.f_label = fcase.label;
-                row.d_star  = Rbands.d_estimated;
-                row.d_low   = Rbands.d_CI[0];
-                row.d_high  = Rbands.d_CI[1];
-                row.u_star  = Rbands.u_estimated;
-                row.u_low   = Rbands.u_CI[0];
-                row.u_high  = Rbands.u_CI[1];
-                row.mu      = Rbands.mu_estimated;
-                row.mu_low  = Rbands.mu_CI[0];
-                row.mu_high = Rbands.mu_CI[1];
-
-                if (fcase.label == "opt") {
-                    row.f_star_str = std::isfinite(Rbands.f_estimated) ? fmt6(Rbands.f_estimated) : "";
-                    row.f_low_str  = std::isfinite(Rbands.f_opt_CI[0]) ? fmt6(Rbands.f_opt_CI[0]) : "";
-                    row.f_high_str = std::isfinite(Rbands.f_opt_CI[1]) ? fmt6(Rbands.f_opt_CI[1]) : "";
-                } else {
-                    row.f_star_str = "";
-                    row.f_low_str  = "";
-                    row.f_high_str = "";
-                }
-
-                results.push_back(std::move(row));
-            }
-        }
+        std::vector<BandsRow> results;
+        results.reserve(bands.size());
+        for (size_t il=0; il<l_list.size(); ++il)
+            for (size_t jf=0; jf<f_list.size(); ++jf)
+                results.push_back({l_list[il], f_list[jf].label, bands[il * f_list.size() + jf]});
 
         // Stampa tabella risultati
 
@@ -242,85 +626,40 @@ int main() {
                   << std::setw(12) << "f_CI_high"
                   << "\n";
 
-        auto fmt = [&](double x){ return fmt6(x); };
-
         for (const auto& r : results) {
+            const auto& B = r.bands;
+            const bool opt = (r.f_label == "opt");
             std::cout << std::left
-                      << std::setw(10) << fmt(r.l)
+                      << std::setw(10) << fmt6(r.l)
                       << std::setw(10) << r.f_label
-                      << std::setw(12) << fmt(r.d_star)
-                      << std::setw(12) << fmt(r.d_low)
-                      << std::setw(12) << fmt(r.d_high)
-                      << std::setw(12) << fmt(r.u_star)
-                      << std::setw(12) << fmt(r.u_low)
-                      << std::setw(12) << fmt(r.u_high)
-                      << std::setw(12) << fmt(r.mu)
-                      << std::setw(12) << fmt(r.mu_low)
-                      << std::setw(12) << fmt(r.mu_high)
-                      << std::setw(10) << r.f_star_str
-                      << std::setw(12) << r.f_low_str
-                      << std::setw(12) << r.f_high_str
+                      << std::setw(12) << fmt6(B.d_estimated)
+                      << std::setw(12) << fmt6(B.d_CI[0])
+                      << std::setw(12) << fmt6(B.d_CI[1])
+                      << std::setw(12) << fmt6(B.u_estimated)
+                      << std::setw(12) << fmt6(B.u_CI[0])
+                      << std::setw(12) << fmt6(B.u_CI[1])
+                      << std::setw(12) << fmt6(B.mu_estimated)
+                      << std::setw(12) << fmt6(B.mu_CI[0])
+                      << std::setw(12) << fmt6(B.mu_CI[1])
+                      << std::setw(10) << (opt ? fmt6(B.f_estimated) : "")
+                      << std::setw(12) << (opt ? fmt6(B.f_opt_CI[0]) : "")
+                      << std::setw(12) << (opt ? fmt6(B.f_opt_CI[1]) : "")
                       << "\n";
         }
 
         // Salva CSV risultati
 
-        {
-            std::ofstream fout("outputs/optimal_bands_results.csv");
-            if (!fout.is_open()) {
-                std::cerr << "[Warn] impossibile aprire outputs/optimal_bands_results.csv per scrivere.\n";
-            } else {
-                fout << "Stop-loss,Leverage,d*,d_CI_low,d_CI_high,u*,u_CI_low,u_CI_high,mu,mu_CI_low,mu_CI_high,f*,f_CI_low,f_CI_high\n";
-                for (const auto& r : results) {
-                    fout << fmt(r.l) << ","
-                         << r.f_label << ","
-                         << fmt(r.d_star) << ","
-                         << fmt(r.d_low)  << ","
-                         << fmt(r.d_high) << ","
-                         << fmt(r.u_star) << ","
-                         << fmt(r.u_low)  << ","
-                         << fmt(r.u_high) << ","
-                         << fmt(r.mu)     << ","
-                         << fmt(r.mu_low) << ","
-                         << fmt(r.mu_high)<< ","
-                         << r.f_star_str  << ","
-                         << r.f_low_str   << ","
-                         << r.f_high_str  << "\n";
-                }
-                std::cout << "\n[Info] Salvato: outputs/optimal_bands_results.csv\n";
-            }
-        }
+        if (write_bands_csv("outputs/optimal_bands_results.csv", results))
+            std::cout << "\n[Info] Salvato: outputs/optimal_bands_results.csv\n";
+        else
+            std::cerr << "[Warn] cannot write outputs/optimal_bands_results.csv\n";
 
         std::cout << "\n[OK] Fine pipeline.\n";
 
-        // ---- scegli un setup (esempio: l = -1.96, f = 1) e calcola d*, u* ----
-    double l_bt = -1.96;
-    double f_bt = 1.0;
-
-    auto bands_bt = util::optimal_trading_bands(
-        /*M=*/100000, l_bt, f_bt,
-        /*k_hat*/ R_8_16.k, /*sigma_hat*/ R_8_16.sigma,
-        /*C=*/ C, /*alpha=*/0.05, /*grid=*/100
-    );
-
     std::cout << "\n[Backtest] Using bands: d*=" << bands_bt.d_estimated
               << ", u*=" << bands_bt.u_estimated
               << " (l=" << l_bt << ", f=" << f_bt << ")\n";
 
-    // ---- prepara config ----
-    util::BacktestConfig cfg;
-    cfg.k_hat     = R_8_16.k;
-    cfg.eta_hat   = R_8_16.eta;
-    cfg.sigma_hat = R_8_16.sigma;
-    cfg.d = -std::abs(bands_bt.d_estimated);  // per sicurezza negativo
-    cfg.u =  std::abs(bands_bt.u_estimated);
-    cfg.l = l_bt;
-    cfg.f = f_bt;
-    cfg.symmetric = true; // attiva lato short
-
-    // ---- esegui su OS pulito ----
-    auto BT = util::backtest_os(clean_OS, cfg);
-
     // ---- stampa metriche ----
     std::cout << "\n=== OS Backtest Summary ===\n";
     std::cout << "Trades: "     << BT.metrics.n_trades
@@ -332,34 +671,31 @@ int main() {
               << " | Equity end (log): "<< BT.metrics.equity_end
               << "\n";
 
-    // ---- salva CSV trades & equity ----
+    // ---- CI delle metriche (bootstrap sui PnL dei trade) ----
     {
-        std::ofstream ft("outputs/os_trades.csv");
-        if (ft.is_open()){
-            ft << "entry_time,exit_time,z_entry,z_exit,x_entry,x_exit,f,costs,pnl,bars\n";
-            for (const auto& t : BT.trades){
-                ft << t.entry_time << "," << t.exit_time << ","
-                   << t.z_entry << "," << t.z_exit << ","
-                   << t.x_entry << "," << t.x_exit << ","
-                   << t.f << "," << t.costs << ","
-                   << t.pnl << "," << t.bars << "\n";
-            }
-            std::cout << "[Info] Saved trades -> outputs/os_trades.csv\n";
-        } else {
-            std::cerr << "[Warn] cannot write outputs/os_trades.csv\n";
-        }
-    }
-    {
-        std::ofstream fe("outputs/os_equity.csv");
-        if (fe.is_open()){
-            fe << "time,log_equity\n";
-            for (size_t i=0;i<BT.equity_path.size();++i)
-                fe << BT.equity_time[i] << "," << BT.equity_path[i] << "\n";
-            std::cout << "[Info] Saved equity -> outputs/os_equity.csv\n";
-        } else {
-            std::cerr << "[Warn] cannot write outputs/os_equity.csv\n";
-        }
+        const auto& CI = BT_CI;
+
+        auto line = [](const char* name, const util::MetricCI& m){
+            std::cout << std::left << std::setw(12) << name
+                      << m.point << "  95% CI = [" << m.lo << ", " << m.hi << "]\n";
+        };
+        std::cout << "\n=== OS Trade Bootstrap (iid, " << tb.n_resamples << " resamples) ===\n";
+        line("Sharpe",    CI.sharpe_bar);
+        line("Hit ratio", CI.hit_ratio);
+        line("Avg pnl",   CI.avg_pnl);
+        line("Max DD",    CI.max_dd);
     }
+
+    // ---- salva CSV trades & equity ----
+    if (util::write_trades_csv("outputs/os_trades.csv", BT, clean_OS))
+        std::cout << "[Info] Saved trades -> outputs/os_trades.csv\n";
+    else
+        std::cerr << "[Warn] cannot write outputs/os_trades.csv\n";
+    if (util::write_equity_csv("outputs/os_equity.csv", BT, clean_OS))
+        std::cout << "[Info] Saved equity -> outputs/os_equity.csv\n";
+    else
+        std::cerr << "[Warn] cannot write outputs/os_equity.csv\n";
+        finish_trace(trace_path);
         return 0;
 
     } catch (const std::exception& ex) {